@@ -3,10 +3,18 @@
 #include <kiwi/kiwi.h>
 
 #include <algorithm>
+#include <chrono>
 #include <climits>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <limits>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #if defined(__GNUC__) && !defined(LJKIWI_NO_BUILTIN)
    #define lk_likely(x) (__builtin_expect(((x) != 0), 1))
@@ -51,33 +59,59 @@ static const constexpr KiwiErr kKiwiErrNullObjectArg1 {
     "null object passed as argument #1."
 };
 
+static const constexpr KiwiErr kKiwiErrNullObjectArg2 {
+    KiwiErrNullObject,
+    "null object passed as argument #2."
+};
+
+const KiwiErr* status_err(SolverStatus status) {
+   switch (status) {
+      case SolverStatus::Ok:
+         return nullptr;
+      case SolverStatus::UnsatisfiableConstraint: {
+         static const constexpr KiwiErr err {KiwiErrUnsatisfiableConstraint};
+         return &err;
+      }
+      case SolverStatus::UnknownConstraint: {
+         static const constexpr KiwiErr err {KiwiErrUnknownConstraint};
+         return &err;
+      }
+      case SolverStatus::DuplicateConstraint: {
+         static const constexpr KiwiErr err {KiwiErrDuplicateConstraint};
+         return &err;
+      }
+      case SolverStatus::UnknownEditVariable: {
+         static const constexpr KiwiErr err {KiwiErrUnknownEditVar};
+         return &err;
+      }
+      case SolverStatus::DuplicateEditVariable: {
+         static const constexpr KiwiErr err {KiwiErrDuplicateEditVar};
+         return &err;
+      }
+      case SolverStatus::BadRequiredStrength: {
+         static const constexpr KiwiErr err {KiwiErrBadRequiredStrength};
+         return &err;
+      }
+   }
+   return &kKiwiErrUnhandledCxxException;
+}
+
 template<typename F>
 const KiwiErr* wrap_err(F&& f) {
    try {
       f();
    } catch (const UnsatisfiableConstraint& ex) {
-      static const constexpr KiwiErr err {KiwiErrUnsatisfiableConstraint};
-      return &err;
+      return status_err(SolverStatus::UnsatisfiableConstraint);
    } catch (const UnknownConstraint& ex) {
-      static const constexpr KiwiErr err {KiwiErrUnknownConstraint};
-      return &err;
-
+      return status_err(SolverStatus::UnknownConstraint);
    } catch (const DuplicateConstraint& ex) {
-      static const constexpr KiwiErr err {KiwiErrDuplicateConstraint};
-      return &err;
-
+      return status_err(SolverStatus::DuplicateConstraint);
    } catch (const UnknownEditVariable& ex) {
-      static const constexpr KiwiErr err {KiwiErrUnknownEditVar};
-      return &err;
-
+      return status_err(SolverStatus::UnknownEditVariable);
    } catch (const DuplicateEditVariable& ex) {
-      static const constexpr KiwiErr err {KiwiErrDuplicateEditVar};
-      return &err;
-
+      return status_err(SolverStatus::DuplicateEditVariable);
    } catch (const BadRequiredStrength& ex) {
-      static const constexpr KiwiErr err {KiwiErrBadRequiredStrength};
-      return &err;
-
+      return status_err(SolverStatus::BadRequiredStrength);
    } catch (const InternalSolverError& ex) {
       static const constexpr KiwiErr base {
           KiwiErrInternalSolverError,
@@ -113,6 +147,20 @@ const KiwiErr* wrap_err(P* self, R* item, F&& f) {
    return wrap_err([&]() { f(self->solver, item); });
 }
 
+// Like wrap_err, but for the non-throwing solver methods returning a
+// SolverStatus. Only unexpected failures go through the exception path.
+template<typename P, typename R, typename F>
+const KiwiErr* wrap_status(P* self, R* item, F&& f) {
+   if (lk_unlikely(!self)) {
+      return &kKiwiErrNullObjectArg0;
+   } else if (lk_unlikely(!item)) {
+      return &kKiwiErrNullObjectArg1;
+   }
+   auto status = SolverStatus::Ok;
+   const KiwiErr* err = wrap_err([&]() { status = f(self->solver, item); });
+   return err ? err : status_err(status);
+}
+
 template<typename T, typename... Args>
 T* make_unmanaged(Args... args) {
    auto* o = new T(std::forward<Args>(args)...);
@@ -146,6 +194,238 @@ void var_release(KiwiVar* var) {
       var->release();
 }
 
+enum ArenaKind : unsigned char { ARENA_EXPRESSION, ARENA_TERM, ARENA_CONSTRAINT };
+
+// Every object tracked by an arena is preceded by a node, the nodes form a
+// list which is walked to release the objects.
+struct ArenaNode {
+   ArenaNode* next;
+   void* obj;
+   ArenaKind kind;
+};
+
+struct ArenaBlock {
+   ArenaBlock* next;
+   std::size_t size;
+   std::size_t used;
+
+   unsigned char* data() { return reinterpret_cast<unsigned char*>(this) + header_size(); }
+   const unsigned char* data() const {
+      return reinterpret_cast<const unsigned char*>(this) + header_size();
+   }
+
+   static constexpr std::size_t align_up(std::size_t n) {
+      return (n + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+   }
+   static constexpr std::size_t header_size() { return align_up(sizeof(ArenaBlock)); }
+};
+
+constexpr std::size_t ARENA_BLOCK_SIZE = 16384;
+
+// A mutation queued for the worker of an async solver. The constraint and
+// variable are retained until the worker has applied it.
+struct AsyncOp {
+   enum Kind : unsigned char {
+      ADD_CONSTRAINT,
+      REMOVE_CONSTRAINT,
+      ADD_EDIT_VAR,
+      REMOVE_EDIT_VAR,
+      SUGGEST_VALUE,
+      SET_VAR_SLOT,
+   };
+
+   Kind kind;
+   int slot;
+   double value;
+   KiwiConstraint* constraint;
+   KiwiVar* var;
+};
+
+}  // namespace
+
+// The solver lives on a worker thread which applies queued mutations in
+// batches. After each batch the values of the slotted variables are written
+// to whichever of the two buffers the reader has not pinned, and marked ready
+// for the next poll. The mutex only guards the queue and the buffer hand-off,
+// it is never held while the solver runs. The worker never writes the
+// variables themselves, and solvers claim the lookup slots of shared objects
+// atomically, so variables and constraints may also be used by solvers on
+// other threads. That needs atomic reference counts, without them no async
+// solver is created.
+struct KiwiAsyncSolver {
+   explicit KiwiAsyncSolver(std::size_t slot_count) :
+       slots(slot_count, nullptr),
+       error(nullptr),
+       submitted(0),
+       published(0),
+       pinned(0),
+       ready(false),
+       stop(false) {
+      buffers[0].assign(slot_count, std::numeric_limits<double>::quiet_NaN());
+      buffers[1].assign(slot_count, std::numeric_limits<double>::quiet_NaN());
+      worker = std::thread([this]() { run(); });
+   }
+
+   ~KiwiAsyncSolver() {
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         stop = true;
+      }
+      work.notify_one();
+      worker.join();
+      for (const auto& op : queue)
+         release(op);
+      for (auto* var : slots)
+         var_release(var);
+      kiwi_err_release(error);
+   }
+
+   const KiwiErr* push(const AsyncOp& op) {
+      retain_unmanaged(op.constraint);
+      var_retain(op.var);
+      const KiwiErr* err = wrap_err([&]() {
+         std::lock_guard<std::mutex> lock(mutex);
+         queue.push_back(op);
+         ++submitted;
+      });
+      if (err) {
+         release(op);
+         return err;
+      }
+      work.notify_one();
+      return nullptr;
+   }
+
+   Solver solver;
+   std::vector<KiwiVar*> slots;
+   std::vector<double> buffers[2];
+
+   std::mutex mutex;
+   std::condition_variable work;
+   std::condition_variable idle;
+   std::vector<AsyncOp> queue;
+   const KiwiErr* error;
+   std::uint64_t submitted;
+   std::uint64_t published;
+   int pinned;
+   bool ready;
+   bool stop;
+
+   std::thread worker;
+
+private:
+   static void release(const AsyncOp& op) {
+      release_unmanaged(op.constraint);
+      var_release(op.var);
+   }
+
+   void run() {
+      std::vector<AsyncOp> batch;
+      for (;;) {
+         std::uint64_t target;
+         {
+            std::unique_lock<std::mutex> lock(mutex);
+            work.wait(lock, [this]() { return stop || !queue.empty(); });
+            if (stop)
+               return;
+            batch.swap(queue);
+            target = submitted;
+         }
+         for (const auto& op : batch) {
+            record(apply(op));
+            release(op);
+         }
+         batch.clear();
+         publish(target);
+      }
+   }
+
+   const KiwiErr* apply(const AsyncOp& op) {
+      SolverStatus status = SolverStatus::Ok;
+      const KiwiErr* err = wrap_err([&]() {
+         switch (op.kind) {
+            case AsyncOp::ADD_CONSTRAINT:
+               status = solver.tryAddConstraint(Constraint(op.constraint));
+               break;
+            case AsyncOp::REMOVE_CONSTRAINT:
+               status = solver.tryRemoveConstraint(Constraint(op.constraint));
+               break;
+            case AsyncOp::ADD_EDIT_VAR:
+               status = solver.tryAddEditVariable(Variable(op.var), op.value);
+               break;
+            case AsyncOp::REMOVE_EDIT_VAR:
+               status = solver.tryRemoveEditVariable(Variable(op.var));
+               break;
+            case AsyncOp::SUGGEST_VALUE:
+               status = solver.trySuggestValue(Variable(op.var), op.value);
+               break;
+            case AsyncOp::SET_VAR_SLOT:
+               assign_slot(op.var, op.slot);
+               break;
+         }
+      });
+      return err ? err : status_err(status);
+   }
+
+   void assign_slot(KiwiVar* var, int slot) {
+      for (auto*& held : slots) {
+         if (held == var) {
+            var_release(held);
+            held = nullptr;
+         }
+      }
+      if (slot < 0 || static_cast<std::size_t>(slot) >= slots.size())
+         return;
+      auto*& held = slots[static_cast<std::size_t>(slot)];
+      var_release(held);
+      held = var_retain(var);
+      // Registering the variable keeps its value in the solver, the reader
+      // may be writing the variable itself.
+      solver.setVariableSlot(Variable(var), static_cast<std::size_t>(slot));
+   }
+
+   void publish(std::uint64_t target) {
+      std::size_t back;
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         ready = false;
+         back = static_cast<std::size_t>(1 - pinned);
+      }
+      record(wrap_err([&]() {
+         solver.getValues(slots.size(), [this](std::size_t i) { return slots[i]; }, buffers[back].data());
+      }));
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         ready = true;
+         published = target;
+      }
+      idle.notify_all();
+   }
+
+   // Keep the first failure until it is taken, later ones are dropped.
+   void record(const KiwiErr* err) {
+      if (!err)
+         return;
+      std::lock_guard<std::mutex> lock(mutex);
+      if (error)
+         kiwi_err_release(err);
+      else
+         error = err;
+   }
+};
+
+namespace {
+
+template<typename R>
+const KiwiErr* async_push(KiwiAsyncSolver* s, R* item, const AsyncOp& op) {
+   if (lk_unlikely(!s)) {
+      return &kKiwiErrNullObjectArg0;
+   } else if (lk_unlikely(!item)) {
+      return &kKiwiErrNullObjectArg1;
+   }
+   return s->push(op);
+}
+
 }  // namespace
 
 extern "C" {
@@ -164,12 +444,42 @@ KiwiVar* kiwi_var_new(const char* name) {
    return VariableData::alloc(name);
 }
 
+int kiwi_var_new_array(int n, const char* const* names, KiwiVar** out) {
+   if (lk_unlikely(n <= 0 || !out))
+      return 0;
+
+   try {
+      auto* vars = VariableData::allocArray(static_cast<std::size_t>(n), names);
+      for (int i = 0; i < n; ++i)
+         out[i] = &vars[i];
+   } catch (...) {
+      return 0;
+   }
+   return n;
+}
+
 void kiwi_var_free(KiwiVar* var) {
    if (lk_likely(var)) {
       var->free();
    }
 }
 
+void kiwi_var_retain(KiwiVar* var) {
+   var_retain(var);
+}
+
+void kiwi_var_release(KiwiVar* var) {
+   var_release(var);
+}
+
+bool kiwi_atomic_refcount(void) {
+#ifdef KIWI_ATOMIC_REFCOUNT
+   return true;
+#else
+   return false;
+#endif
+}
+
 const char* kiwi_var_name(const KiwiVar* var) {
    return lk_likely(var) ? var->name() : "(<null>)";
 }
@@ -180,12 +490,12 @@ void kiwi_var_set_name(KiwiVar* var, const char* name) {
 }
 
 double kiwi_var_value(const KiwiVar* var) {
-   return lk_likely(var) ? var->value_ : std::numeric_limits<double>::quiet_NaN();
+   return lk_likely(var) ? var->value() : std::numeric_limits<double>::quiet_NaN();
 }
 
 void kiwi_var_set_value(KiwiVar* var, double value) {
    if (lk_likely(var))
-      var->value_ = value;
+      var->setValue(value);
 }
 
 void kiwi_expression_retain(KiwiExpression* expr) {
@@ -265,32 +575,17 @@ KiwiConstraint* kiwi_constraint_new(
       strength = kiwi::strength::required;
    }
 
-   std::vector<Term> terms;
-   terms.reserve(static_cast<decltype(terms)::size_type>(
-       (lhs && lhs->term_count > 0 ? lhs->term_count : 0)
-       + (rhs && rhs->term_count > 0 ? rhs->term_count : 0)
-   ));
-
-   if (lhs) {
-      for (int i = 0; i < lhs->term_count; ++i) {
-         const auto& t = lhs->terms_[i];
-         if (t.var)
-            terms.emplace_back(Variable(t.var), t.coefficient);
-      }
-   }
-   if (rhs) {
-      for (int i = 0; i < rhs->term_count; ++i) {
-         const auto& t = rhs->terms_[i];
-         if (t.var)
-            terms.emplace_back(Variable(t.var), -t.coefficient);
-      }
-   }
-
-   return make_unmanaged<ConstraintData>(
-       Expression(std::move(terms), (lhs ? lhs->constant : 0.0) - (rhs ? rhs->constant : 0.0)),
+   auto* c = ConstraintData::alloc(
+       lhs ? lhs->terms_ : nullptr,
+       lhs ? lhs->term_count : 0,
+       rhs ? rhs->terms_ : nullptr,
+       rhs ? rhs->term_count : 0,
+       (lhs ? lhs->constant : 0.0) - (rhs ? rhs->constant : 0.0),
        static_cast<RelationalOperator>(op),
        strength
    );
+   c->m_refcount = 1;
+   return c;
 }
 
 void kiwi_constraint_release(KiwiConstraint* c) {
@@ -317,8 +612,7 @@ int kiwi_constraint_expression(KiwiConstraint* c, KiwiExpression* out, int out_s
    if (lk_unlikely(!c))
       return 0;
 
-   const auto& expr = c->expression();
-   const auto& terms = expr.terms();
+   const auto terms = c->terms();
    int n = terms.size() < INT_MAX ? static_cast<int>(terms.size()) : INT_MAX;
    if (!out || out_size < n)
       return n;
@@ -328,13 +622,134 @@ int kiwi_constraint_expression(KiwiConstraint* c, KiwiExpression* out, int out_s
       out->terms_[i].var = const_cast<Variable&>(t.variable()).ptr();
       out->terms_[i].coefficient = t.coefficient();
    }
-   out->constant = expr.constant();
+   out->constant = c->constant();
    out->term_count = n;
    out->owner = retain_unmanaged(c);
 
    return n;
 }
 
+struct KiwiArena {
+   ArenaBlock* blocks;  // the block being filled comes first
+   ArenaNode* objects;
+
+   void* alloc(std::size_t n) {
+      n = ArenaBlock::align_up(n);
+      if (!blocks || blocks->size - blocks->used < n) {
+         std::size_t size = n > ARENA_BLOCK_SIZE ? n : ARENA_BLOCK_SIZE;
+         auto* block = static_cast<ArenaBlock*>(std::malloc(ArenaBlock::header_size() + size));
+         if (!block)
+            return nullptr;
+         *block = ArenaBlock {blocks, size, 0};
+         blocks = block;
+      }
+      void* p = blocks->data() + blocks->used;
+      blocks->used += n;
+      return p;
+   }
+
+   // Allocate a zeroed object of `size` bytes released according to `kind`.
+   void* track(ArenaKind kind, std::size_t size) {
+      const auto node_size = ArenaBlock::align_up(sizeof(ArenaNode));
+      auto* mem = static_cast<unsigned char*>(alloc(node_size + size));
+      if (!mem)
+         return nullptr;
+      void* obj = std::memset(mem + node_size, 0, size);
+      objects = new (mem) ArenaNode {objects, obj, kind};
+      return obj;
+   }
+
+   // Release every tracked object. The memory is retained for reuse, merged
+   // into a single block when it had to grow.
+   void release() {
+      for (auto* node = objects; node; node = node->next) {
+         switch (node->kind) {
+            case ARENA_EXPRESSION:
+               kiwi_expression_destroy(static_cast<KiwiExpression*>(node->obj));
+               break;
+            case ARENA_TERM:
+               var_release(static_cast<KiwiTerm*>(node->obj)->var);
+               break;
+            case ARENA_CONSTRAINT:
+               release_unmanaged(static_cast<KiwiConstraint*>(node->obj));
+               break;
+         }
+      }
+      objects = nullptr;
+
+      if (blocks && blocks->next) {
+         std::size_t total = 0;
+         while (blocks) {
+            auto* next = blocks->next;
+            total += blocks->size;
+            std::free(blocks);
+            blocks = next;
+         }
+         if (auto* block = static_cast<ArenaBlock*>(std::malloc(ArenaBlock::header_size() + total)))
+            blocks = new (block) ArenaBlock {nullptr, total, 0};
+      } else if (blocks) {
+         blocks->used = 0;
+      }
+   }
+
+   bool contains(const void* p) const {
+      const auto* cp = static_cast<const unsigned char*>(p);
+      for (const auto* b = blocks; b; b = b->next) {
+         if (cp >= b->data() && cp < b->data() + b->used)
+            return true;
+      }
+      return false;
+   }
+};
+
+KiwiArena* kiwi_arena_new() {
+   return new (std::nothrow) KiwiArena {nullptr, nullptr};
+}
+
+void kiwi_arena_free(KiwiArena* a) {
+   if (lk_unlikely(!a))
+      return;
+   a->release();
+   std::free(a->blocks);
+   delete a;
+}
+
+void kiwi_arena_release(KiwiArena* a) {
+   if (lk_likely(a))
+      a->release();
+}
+
+KiwiExpression* kiwi_arena_expression(KiwiArena* a, int term_count) {
+   if (lk_unlikely(!a || term_count < 0))
+      return nullptr;
+   return static_cast<KiwiExpression*>(a->track(
+       ARENA_EXPRESSION,
+       sizeof(KiwiExpression) + sizeof(KiwiTerm) * static_cast<std::size_t>(term_count)
+   ));
+}
+
+KiwiTerm* kiwi_arena_term(KiwiArena* a) {
+   if (lk_unlikely(!a))
+      return nullptr;
+   return static_cast<KiwiTerm*>(a->track(ARENA_TERM, sizeof(KiwiTerm)));
+}
+
+bool kiwi_arena_own_constraint(KiwiArena* a, KiwiConstraint* c) {
+   if (lk_unlikely(!a || !c))
+      return false;
+   void* mem = a->alloc(sizeof(ArenaNode));
+   if (!mem) {
+      release_unmanaged(c);
+      return false;
+   }
+   a->objects = new (mem) ArenaNode {a->objects, c, ARENA_CONSTRAINT};
+   return true;
+}
+
+bool kiwi_arena_contains(const KiwiArena* a, const void* p) {
+   return lk_likely(a && p) ? a->contains(p) : false;
+}
+
 struct KiwiSolver {
    unsigned error_mask;
    Solver solver;
@@ -373,11 +788,49 @@ void kiwi_solver_set_error_mask(KiwiSolver* s, unsigned mask) {
 }
 
 const KiwiErr* kiwi_solver_add_constraint(KiwiSolver* s, KiwiConstraint* constraint) {
-   return wrap_err(s, constraint, [](auto&& s, auto&& c) { s.addConstraint(Constraint(c)); });
+   return wrap_status(s, constraint, [](auto&& s, auto&& c) {
+      return s.tryAddConstraint(Constraint(c));
+   });
+}
+
+const KiwiErr* kiwi_solver_add_constraints(
+    KiwiSolver* s,
+    KiwiConstraint* const* constraints,
+    int n,
+    int* added
+) {
+   if (added)
+      *added = 0;
+   if (lk_unlikely(!s)) {
+      return &kKiwiErrNullObjectArg0;
+   } else if (n <= 0) {
+      return nullptr;
+   } else if (lk_unlikely(!constraints)) {
+      return &kKiwiErrNullObjectArg1;
+   }
+   for (int i = 0; i < n; ++i) {
+      if (lk_unlikely(!constraints[i]))
+         return &kKiwiErrNullObjectArg1;
+   }
+
+   auto status = SolverStatus::Ok;
+   std::size_t count = 0;
+   const KiwiErr* err = wrap_err([&]() {
+      status = s->solver.tryAddConstraints(
+          static_cast<std::size_t>(n),
+          [constraints](std::size_t i) { return Constraint(constraints[i]); },
+          count
+      );
+   });
+   if (added)
+      *added = static_cast<int>(count);
+   return err ? err : status_err(status);
 }
 
 const KiwiErr* kiwi_solver_remove_constraint(KiwiSolver* s, KiwiConstraint* constraint) {
-   return wrap_err(s, constraint, [](auto&& s, auto&& c) { s.removeConstraint(Constraint(c)); });
+   return wrap_status(s, constraint, [](auto&& s, auto&& c) {
+      return s.tryRemoveConstraint(Constraint(c));
+   });
 }
 
 bool kiwi_solver_has_constraint(const KiwiSolver* s, KiwiConstraint* constraint) {
@@ -386,14 +839,107 @@ bool kiwi_solver_has_constraint(const KiwiSolver* s, KiwiConstraint* constraint)
    return s->solver.hasConstraint(Constraint(constraint));
 }
 
+const KiwiErr*
+kiwi_solver_set_constraint_enabled(KiwiSolver* s, KiwiConstraint* constraint, bool enabled) {
+   return wrap_status(s, constraint, [enabled](auto&& s, auto&& c) {
+      return s.trySetConstraintEnabled(Constraint(c), enabled);
+   });
+}
+
+bool kiwi_solver_constraint_enabled(const KiwiSolver* s, KiwiConstraint* constraint) {
+   if (lk_unlikely(!s || !constraint))
+      return 0;
+   return s->solver.constraintEnabled(Constraint(constraint));
+}
+
+const KiwiErr*
+kiwi_solver_set_strength(KiwiSolver* s, KiwiConstraint* constraint, double strength) {
+   return wrap_status(s, constraint, [strength](auto&& s, auto&& c) {
+      return s.trySetStrength(Constraint(c), strength);
+   });
+}
+
+double kiwi_solver_constraint_strength(const KiwiSolver* s, KiwiConstraint* constraint) {
+   if (lk_unlikely(!s || !constraint))
+      return -1.0;
+   return s->solver.constraintStrength(Constraint(constraint));
+}
+
+const KiwiErr*
+kiwi_solver_set_constant(KiwiSolver* s, KiwiConstraint* constraint, double constant) {
+   return wrap_status(s, constraint, [constant](auto&& s, auto&& c) {
+      return s.trySetConstant(Constraint(c), constant);
+   });
+}
+
+const KiwiErr* kiwi_solver_set_constants(
+    KiwiSolver* s,
+    KiwiConstraint* const* constraints,
+    const double* constants,
+    int n
+) {
+   if (lk_unlikely(!s)) {
+      return &kKiwiErrNullObjectArg0;
+   } else if (n <= 0) {
+      return nullptr;
+   } else if (lk_unlikely(!constraints || !constants)) {
+      return &kKiwiErrNullObjectArg1;
+   }
+   for (int i = 0; i < n; ++i) {
+      if (lk_unlikely(!constraints[i]))
+         return &kKiwiErrNullObjectArg1;
+   }
+
+   auto status = SolverStatus::Ok;
+   const KiwiErr* err = wrap_err([&]() {
+      status = s->solver.trySetConstants(
+          static_cast<std::size_t>(n),
+          [constraints](std::size_t i) { return Constraint(constraints[i]); },
+          constants
+      );
+   });
+   return err ? err : status_err(status);
+}
+
+double kiwi_solver_constraint_constant(const KiwiSolver* s, KiwiConstraint* constraint) {
+   if (lk_unlikely(!s || !constraint))
+      return 0.0;
+   return s->solver.constraintConstant(Constraint(constraint));
+}
+
+const KiwiErr* kiwi_solver_set_coefficient(
+    KiwiSolver* s,
+    KiwiConstraint* constraint,
+    KiwiVar* var,
+    double coefficient
+) {
+   if (lk_unlikely(s && constraint && !var))
+      return &kKiwiErrNullObjectArg2;
+   return wrap_status(s, constraint, [var, coefficient](auto&& s, auto&& c) {
+      return s.trySetCoefficient(Constraint(c), Variable(var), coefficient);
+   });
+}
+
+double kiwi_solver_constraint_coefficient(
+    const KiwiSolver* s,
+    KiwiConstraint* constraint,
+    KiwiVar* var
+) {
+   if (lk_unlikely(!s || !constraint || !var))
+      return 0.0;
+   return s->solver.constraintCoefficient(Constraint(constraint), Variable(var));
+}
+
 const KiwiErr* kiwi_solver_add_edit_var(KiwiSolver* s, KiwiVar* var, double strength) {
-   return wrap_err(s, var, [strength](auto&& s, auto&& v) {
-      s.addEditVariable(Variable(v), strength);
+   return wrap_status(s, var, [strength](auto&& s, auto&& v) {
+      return s.tryAddEditVariable(Variable(v), strength);
    });
 }
 
 const KiwiErr* kiwi_solver_remove_edit_var(KiwiSolver* s, KiwiVar* var) {
-   return wrap_err(s, var, [](auto&& s, auto&& v) { s.removeEditVariable(Variable(v)); });
+   return wrap_status(s, var, [](auto&& s, auto&& v) {
+      return s.tryRemoveEditVariable(Variable(v));
+   });
 }
 
 bool kiwi_solver_has_edit_var(const KiwiSolver* s, KiwiVar* var) {
@@ -402,8 +948,16 @@ bool kiwi_solver_has_edit_var(const KiwiSolver* s, KiwiVar* var) {
    return s->solver.hasEditVariable(Variable(var));
 }
 
+const KiwiErr* kiwi_solver_set_edit_strength(KiwiSolver* s, KiwiVar* var, double strength) {
+   return wrap_status(s, var, [strength](auto&& s, auto&& v) {
+      return s.trySetEditStrength(Variable(v), strength);
+   });
+}
+
 const KiwiErr* kiwi_solver_suggest_value(KiwiSolver* s, KiwiVar* var, double value) {
-   return wrap_err(s, var, [value](auto&& s, auto&& v) { s.suggestValue(Variable(v), value); });
+   return wrap_status(s, var, [value](auto&& s, auto&& v) {
+      return s.trySuggestValue(Variable(v), value);
+   });
 }
 
 void kiwi_solver_update_vars(KiwiSolver* s) {
@@ -411,6 +965,142 @@ void kiwi_solver_update_vars(KiwiSolver* s) {
       s->solver.updateVariables();
 }
 
+int kiwi_solver_update_vars_changed(KiwiSolver* s, double tolerance, KiwiVar** out, int cap) {
+   if (lk_unlikely(!s))
+      return 0;
+
+   int n = 0;
+   s->solver.updateVariables(tolerance, [&n, out, cap](const Variable& var) {
+      if (out && n < cap)
+         out[n] = const_cast<Variable&>(var).ptr();
+      if (n < INT_MAX)
+         ++n;
+   });
+   return n;
+}
+
+int kiwi_solver_var_count(const KiwiSolver* s) {
+   if (lk_unlikely(!s))
+      return 0;
+   const auto n = s->solver.variableCount();
+   return n < INT_MAX ? static_cast<int>(n) : INT_MAX;
+}
+
+void kiwi_solver_get_values(const KiwiSolver* s, KiwiVar* const* vars, double* out, int n) {
+   if (lk_unlikely(!s || !vars || !out || n <= 0))
+      return;
+
+   try {
+      s->solver.getValues(static_cast<std::size_t>(n), [vars](std::size_t i) { return vars[i]; }, out);
+   } catch (...) {
+      std::fill(out, out + n, std::numeric_limits<double>::quiet_NaN());
+   }
+}
+
+void kiwi_solver_bind_values(KiwiSolver* s, double* values, size_t n) {
+   if (lk_likely(s))
+      s->solver.bindValues(values, n);
+}
+
+const KiwiErr* kiwi_solver_set_var_slot(KiwiSolver* s, KiwiVar* var, int slot) {
+   return wrap_err(s, var, [slot](auto&& s, auto&& v) {
+      if (slot < 0)
+         s.clearVariableSlot(Variable(v));
+      else
+         s.setVariableSlot(Variable(v), static_cast<std::size_t>(slot));
+   });
+}
+
+void kiwi_solver_set_lazy(KiwiSolver* s, bool enabled) {
+   if (lk_likely(s))
+      s->solver.setLazyUpdates(enabled);
+}
+
+void kiwi_solver_set_dedup(KiwiSolver* s, bool enabled) {
+   if (lk_likely(s))
+      s->solver.setDeduplication(enabled);
+}
+
+void kiwi_solver_set_presolve(KiwiSolver* s, bool enabled) {
+   if (lk_likely(s))
+      s->solver.setPresolve(enabled);
+}
+
+const KiwiErr* kiwi_solver_set_parallel(KiwiSolver* s, int threads, int min_rows) {
+   if (lk_unlikely(!s))
+      return &kKiwiErrNullObjectArg0;
+
+   return wrap_err([=]() {
+      s->solver.setParallel(
+          threads > 0 ? static_cast<std::size_t>(threads) : 0,
+          min_rows >= 0 ? static_cast<std::size_t>(min_rows) : impl::SolverImpl::DefaultParallelRows
+      );
+   });
+}
+
+void kiwi_solver_bind_snapshot(KiwiSolver* s, KiwiSnapshot* snapshot) {
+   if (lk_likely(s))
+      s->solver.bindSnapshot(snapshot);
+}
+
+void kiwi_solver_set_deferred(KiwiSolver* s, bool enabled) {
+   if (lk_likely(s))
+      s->solver.setDeferredOptimize(enabled);
+}
+
+bool kiwi_solver_optimized(const KiwiSolver* s) {
+   return lk_likely(s) ? s->solver.optimized() : true;
+}
+
+const KiwiErr* kiwi_solver_step(KiwiSolver* s, double seconds, int max_pivots, bool* done) {
+   if (done)
+      *done = false;
+   if (lk_unlikely(!s))
+      return &kKiwiErrNullObjectArg0;
+
+   return wrap_err([=]() {
+      using Clock = std::chrono::steady_clock;
+      const auto pivots = max_pivots >= 0 ? static_cast<std::size_t>(max_pivots)
+                                          : std::numeric_limits<std::size_t>::max();
+      const auto deadline = seconds >= 0.0 && seconds < 1.0e9
+          ? Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds))
+          : Clock::time_point::max();
+      const bool finished = s->solver.optimizeFor(deadline, pivots);
+      if (done)
+         *done = finished;
+   });
+}
+
+KiwiSnapshot* kiwi_snapshot_new(int size) {
+   try {
+      return new ValueSnapshot(size > 0 ? static_cast<std::size_t>(size) : 0);
+   } catch (...) {
+      return nullptr;
+   }
+}
+
+void kiwi_snapshot_free(KiwiSnapshot* snapshot) {
+   delete snapshot;
+}
+
+int kiwi_snapshot_size(const KiwiSnapshot* snapshot) {
+   return lk_likely(snapshot) ? static_cast<int>(snapshot->size()) : 0;
+}
+
+uint64_t kiwi_snapshot_version(const KiwiSnapshot* snapshot) {
+   return lk_likely(snapshot) ? snapshot->version() : 0;
+}
+
+uint64_t kiwi_snapshot_read(const KiwiSnapshot* snapshot, int first, int count, double* out) {
+   if (lk_unlikely(!snapshot || !out || first < 0 || count <= 0))
+      return 0;
+
+   const auto size = snapshot->size();
+   auto begin = std::min(static_cast<std::size_t>(first), size);
+   auto n = std::min(static_cast<std::size_t>(count), size - begin);
+   return snapshot->read(begin, n, out);
+}
+
 void kiwi_solver_reset(KiwiSolver* s) {
    if (lk_likely(s))
       s->solver.reset();
@@ -434,4 +1124,89 @@ char* kiwi_solver_dumps(const KiwiSolver* s) {
    return buf;
 }
 
+KiwiAsyncSolver* kiwi_async_solver_new(int slot_count) {
+#ifndef KIWI_ATOMIC_REFCOUNT
+   (void)slot_count;
+   return nullptr;
+#else
+   try {
+      return new KiwiAsyncSolver(slot_count > 0 ? static_cast<std::size_t>(slot_count) : 0);
+   } catch (...) {
+      return nullptr;
+   }
+#endif
+}
+
+void kiwi_async_solver_free(KiwiAsyncSolver* s) {
+   if (lk_likely(s))
+      delete s;
+}
+
+const KiwiErr* kiwi_async_solver_add_constraint(KiwiAsyncSolver* s, KiwiConstraint* constraint) {
+   return async_push(s, constraint, AsyncOp {AsyncOp::ADD_CONSTRAINT, 0, 0.0, constraint, nullptr});
+}
+
+const KiwiErr*
+kiwi_async_solver_remove_constraint(KiwiAsyncSolver* s, KiwiConstraint* constraint) {
+   return async_push(s, constraint, AsyncOp {AsyncOp::REMOVE_CONSTRAINT, 0, 0.0, constraint, nullptr});
+}
+
+const KiwiErr* kiwi_async_solver_add_edit_var(KiwiAsyncSolver* s, KiwiVar* var, double strength) {
+   return async_push(s, var, AsyncOp {AsyncOp::ADD_EDIT_VAR, 0, strength, nullptr, var});
+}
+
+const KiwiErr* kiwi_async_solver_remove_edit_var(KiwiAsyncSolver* s, KiwiVar* var) {
+   return async_push(s, var, AsyncOp {AsyncOp::REMOVE_EDIT_VAR, 0, 0.0, nullptr, var});
+}
+
+const KiwiErr* kiwi_async_solver_suggest_value(KiwiAsyncSolver* s, KiwiVar* var, double value) {
+   return async_push(s, var, AsyncOp {AsyncOp::SUGGEST_VALUE, 0, value, nullptr, var});
+}
+
+const KiwiErr* kiwi_async_solver_set_var_slot(KiwiAsyncSolver* s, KiwiVar* var, int slot) {
+   return async_push(s, var, AsyncOp {AsyncOp::SET_VAR_SLOT, slot, 0.0, nullptr, var});
+}
+
+bool kiwi_async_solver_poll(KiwiAsyncSolver* s, const double** values) {
+   if (lk_unlikely(!s)) {
+      if (values)
+         *values = nullptr;
+      return false;
+   }
+
+   std::lock_guard<std::mutex> lock(s->mutex);
+   const bool changed = s->ready;
+   if (changed) {
+      s->pinned = 1 - s->pinned;
+      s->ready = false;
+   }
+   if (values)
+      *values = s->buffers[s->pinned].data();
+   return changed;
+}
+
+bool kiwi_async_solver_wait(KiwiAsyncSolver* s, double timeout) {
+   if (lk_unlikely(!s))
+      return true;
+
+   std::unique_lock<std::mutex> lock(s->mutex);
+   const auto target = s->submitted;
+   const auto done = [s, target]() { return s->published >= target; };
+   if (timeout < 0.0) {
+      s->idle.wait(lock, done);
+      return true;
+   }
+   return s->idle.wait_for(lock, std::chrono::duration<double>(timeout), done);
+}
+
+const KiwiErr* kiwi_async_solver_error(KiwiAsyncSolver* s) {
+   if (lk_unlikely(!s))
+      return nullptr;
+
+   std::lock_guard<std::mutex> lock(s->mutex);
+   const KiwiErr* err = s->error;
+   s->error = nullptr;
+   return err;
+}
+
 }  // extern "C"
@@ -1,6 +1,9 @@
 #ifndef LJKIWI_CKIWI_H_
 #define LJKIWI_CKIWI_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #if !defined(_MSC_VER) || _MSC_VER >= 1900
    #undef LJKIWI_USE_FAM_1
 #else
@@ -12,16 +15,19 @@
 namespace kiwi {
 class VariableData;
 class ConstraintData;
+class ValueSnapshot;
 }  // namespace kiwi
 
 typedef kiwi::VariableData KiwiVar;
 typedef kiwi::ConstraintData KiwiConstraint;
+typedef kiwi::ValueSnapshot KiwiSnapshot;
 
 extern "C" {
 
 #else
 typedef struct KiwiVar KiwiVar;
 typedef struct KiwiConstraint KiwiConstraint;
+typedef struct KiwiSnapshot KiwiSnapshot;
 
 #endif
 
@@ -74,6 +80,8 @@ typedef struct KiwiErr {
    bool must_release;
 } KiwiErr;
 
+typedef struct KiwiArena KiwiArena;
+typedef struct KiwiAsyncSolver KiwiAsyncSolver;
 struct KiwiSolver;
 LJKIWI_EXP void kiwi_solver_type_layout(unsigned sz_align[2]);
 
@@ -81,7 +89,11 @@ LJKIWI_EXP void kiwi_str_release(char* str);
 LJKIWI_EXP void kiwi_err_release(const KiwiErr* err);
 
 LJKIWI_EXP KiwiVar* kiwi_var_new(const char* name);
+LJKIWI_EXP int kiwi_var_new_array(int n, const char* const* names, KiwiVar** out);
 LJKIWI_EXP void kiwi_var_free(KiwiVar* var);
+LJKIWI_EXP void kiwi_var_retain(KiwiVar* var);
+LJKIWI_EXP void kiwi_var_release(KiwiVar* var);
+LJKIWI_EXP bool kiwi_atomic_refcount(void);
 
 LJKIWI_EXP const char* kiwi_var_name(const KiwiVar* var);
 LJKIWI_EXP void kiwi_var_set_name(KiwiVar* var, const char* name);
@@ -113,6 +125,14 @@ LJKIWI_EXP enum KiwiRelOp kiwi_constraint_op(const KiwiConstraint* c);
 LJKIWI_EXP bool kiwi_constraint_violated(const KiwiConstraint* c);
 LJKIWI_EXP int kiwi_constraint_expression(KiwiConstraint* c, KiwiExpression* out, int out_size);
 
+LJKIWI_EXP KiwiArena* kiwi_arena_new(void);
+LJKIWI_EXP void kiwi_arena_free(KiwiArena* a);
+LJKIWI_EXP void kiwi_arena_release(KiwiArena* a);
+LJKIWI_EXP KiwiExpression* kiwi_arena_expression(KiwiArena* a, int term_count);
+LJKIWI_EXP KiwiTerm* kiwi_arena_term(KiwiArena* a);
+LJKIWI_EXP bool kiwi_arena_own_constraint(KiwiArena* a, KiwiConstraint* c);
+LJKIWI_EXP bool kiwi_arena_contains(const KiwiArena* a, const void* p);
+
 LJKIWI_EXP KiwiSolver* kiwi_solver_new(unsigned error_mask);
 LJKIWI_EXP void kiwi_solver_free(KiwiSolver* s);
 LJKIWI_EXP void kiwi_solver_init(KiwiSolver* s, unsigned error_mask);
@@ -121,17 +141,91 @@ LJKIWI_EXP unsigned kiwi_solver_get_error_mask(const KiwiSolver* s);
 LJKIWI_EXP void kiwi_solver_set_error_mask(KiwiSolver* s, unsigned mask);
 
 LJKIWI_EXP const KiwiErr* kiwi_solver_add_constraint(KiwiSolver* s, KiwiConstraint* constraint);
+LJKIWI_EXP const KiwiErr* kiwi_solver_add_constraints(
+    KiwiSolver* s,
+    KiwiConstraint* const* constraints,
+    int n,
+    int* added
+);
 LJKIWI_EXP const KiwiErr*
 kiwi_solver_remove_constraint(KiwiSolver* s, KiwiConstraint* constraint);
 LJKIWI_EXP bool kiwi_solver_has_constraint(const KiwiSolver* s, KiwiConstraint* constraint);
+LJKIWI_EXP const KiwiErr*
+kiwi_solver_set_constraint_enabled(KiwiSolver* s, KiwiConstraint* constraint, bool enabled);
+LJKIWI_EXP bool kiwi_solver_constraint_enabled(const KiwiSolver* s, KiwiConstraint* constraint);
+LJKIWI_EXP const KiwiErr*
+kiwi_solver_set_strength(KiwiSolver* s, KiwiConstraint* constraint, double strength);
+LJKIWI_EXP double kiwi_solver_constraint_strength(const KiwiSolver* s, KiwiConstraint* constraint);
+LJKIWI_EXP const KiwiErr*
+kiwi_solver_set_constant(KiwiSolver* s, KiwiConstraint* constraint, double constant);
+LJKIWI_EXP const KiwiErr* kiwi_solver_set_constants(
+    KiwiSolver* s,
+    KiwiConstraint* const* constraints,
+    const double* constants,
+    int n
+);
+LJKIWI_EXP double kiwi_solver_constraint_constant(const KiwiSolver* s, KiwiConstraint* constraint);
+LJKIWI_EXP const KiwiErr* kiwi_solver_set_coefficient(
+    KiwiSolver* s,
+    KiwiConstraint* constraint,
+    KiwiVar* var,
+    double coefficient
+);
+LJKIWI_EXP double
+kiwi_solver_constraint_coefficient(const KiwiSolver* s, KiwiConstraint* constraint, KiwiVar* var);
 LJKIWI_EXP const KiwiErr* kiwi_solver_add_edit_var(KiwiSolver* s, KiwiVar* var, double strength);
 LJKIWI_EXP const KiwiErr* kiwi_solver_remove_edit_var(KiwiSolver* s, KiwiVar* var);
 LJKIWI_EXP bool kiwi_solver_has_edit_var(const KiwiSolver* s, KiwiVar* var);
+LJKIWI_EXP const KiwiErr*
+kiwi_solver_set_edit_strength(KiwiSolver* s, KiwiVar* var, double strength);
 LJKIWI_EXP const KiwiErr* kiwi_solver_suggest_value(KiwiSolver* s, KiwiVar* var, double value);
 LJKIWI_EXP void kiwi_solver_update_vars(KiwiSolver* sp);
+LJKIWI_EXP int
+kiwi_solver_update_vars_changed(KiwiSolver* s, double tolerance, KiwiVar** out, int cap);
+LJKIWI_EXP int kiwi_solver_var_count(const KiwiSolver* s);
+LJKIWI_EXP void kiwi_solver_get_values(
+    const KiwiSolver* s,
+    KiwiVar* const* vars,
+    double* out,
+    int n
+);
+LJKIWI_EXP void kiwi_solver_bind_values(KiwiSolver* s, double* values, size_t n);
+LJKIWI_EXP const KiwiErr* kiwi_solver_set_var_slot(KiwiSolver* s, KiwiVar* var, int slot);
+LJKIWI_EXP void kiwi_solver_set_lazy(KiwiSolver* s, bool enabled);
+LJKIWI_EXP void kiwi_solver_set_dedup(KiwiSolver* s, bool enabled);
+LJKIWI_EXP void kiwi_solver_set_presolve(KiwiSolver* s, bool enabled);
+LJKIWI_EXP const KiwiErr* kiwi_solver_set_parallel(KiwiSolver* s, int threads, int min_rows);
+LJKIWI_EXP void kiwi_solver_bind_snapshot(KiwiSolver* s, KiwiSnapshot* snapshot);
+LJKIWI_EXP void kiwi_solver_set_deferred(KiwiSolver* s, bool enabled);
+LJKIWI_EXP bool kiwi_solver_optimized(const KiwiSolver* s);
+LJKIWI_EXP const KiwiErr*
+kiwi_solver_step(KiwiSolver* s, double seconds, int max_pivots, bool* done);
+
+LJKIWI_EXP KiwiSnapshot* kiwi_snapshot_new(int size);
+LJKIWI_EXP void kiwi_snapshot_free(KiwiSnapshot* snapshot);
+LJKIWI_EXP int kiwi_snapshot_size(const KiwiSnapshot* snapshot);
+LJKIWI_EXP uint64_t kiwi_snapshot_version(const KiwiSnapshot* snapshot);
+LJKIWI_EXP uint64_t
+kiwi_snapshot_read(const KiwiSnapshot* snapshot, int first, int count, double* out);
 LJKIWI_EXP void kiwi_solver_reset(KiwiSolver* sp);
 LJKIWI_EXP void kiwi_solver_dump(const KiwiSolver* sp);
 LJKIWI_EXP char* kiwi_solver_dumps(const KiwiSolver* sp);
+
+LJKIWI_EXP KiwiAsyncSolver* kiwi_async_solver_new(int slot_count);
+LJKIWI_EXP void kiwi_async_solver_free(KiwiAsyncSolver* s);
+LJKIWI_EXP const KiwiErr*
+kiwi_async_solver_add_constraint(KiwiAsyncSolver* s, KiwiConstraint* constraint);
+LJKIWI_EXP const KiwiErr*
+kiwi_async_solver_remove_constraint(KiwiAsyncSolver* s, KiwiConstraint* constraint);
+LJKIWI_EXP const KiwiErr*
+kiwi_async_solver_add_edit_var(KiwiAsyncSolver* s, KiwiVar* var, double strength);
+LJKIWI_EXP const KiwiErr* kiwi_async_solver_remove_edit_var(KiwiAsyncSolver* s, KiwiVar* var);
+LJKIWI_EXP const KiwiErr*
+kiwi_async_solver_suggest_value(KiwiAsyncSolver* s, KiwiVar* var, double value);
+LJKIWI_EXP const KiwiErr* kiwi_async_solver_set_var_slot(KiwiAsyncSolver* s, KiwiVar* var, int slot);
+LJKIWI_EXP bool kiwi_async_solver_poll(KiwiAsyncSolver* s, const double** values);
+LJKIWI_EXP bool kiwi_async_solver_wait(KiwiAsyncSolver* s, double timeout);
+LJKIWI_EXP const KiwiErr* kiwi_async_solver_error(KiwiAsyncSolver* s);
 // LuaJIT end
 
 #ifdef __cplusplus
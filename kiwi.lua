@@ -56,12 +56,6 @@ struct KiwiSmallStr {
    };
 };
 
-struct KiwiVar {
-   size_t ref_count_;
-   double value_;
-   struct KiwiSmallStr name_;
-};
-
 KiwiVar* kiwi_var_new(const char* name);
 void kiwi_var_free(KiwiVar* var);
 const char* kiwi_var_name(const KiwiVar* var);
@@ -87,6 +81,43 @@ void kiwi_expression_add_term(const KiwiExpression* expr, KiwiVar* var, double c
 void kiwi_expression_set_constant(const KiwiExpression* expr, double constant, KiwiExpression* out);
 ]])
 
+if RUST then
+   ffi.cdef([[
+struct KiwiVar {
+   size_t ref_count_;
+   double value_;
+   struct KiwiSmallStr name_;
+};
+]])
+else
+   ffi.cdef([[
+struct KiwiLazySource {
+   uint32_t generation;
+};
+
+struct KiwiSolverSlot {
+   const void* owner;
+   size_t index;
+};
+
+struct KiwiVar {
+   size_t ref_count_;
+   double value_;
+   struct KiwiSmallStr name_;
+   void* slab_;
+   const struct KiwiLazySource* lazy_;
+   uint32_t lazy_gen_;
+   struct KiwiSolverSlot var_slot_;
+   struct KiwiSolverSlot edit_slot_;
+};
+
+double kiwi_var_value(const KiwiVar* var);
+void kiwi_var_retain(KiwiVar* var);
+void kiwi_var_release(KiwiVar* var);
+bool kiwi_atomic_refcount(void);
+]])
+end
+
 if RUST then
    ffi.cdef([[
 typedef struct KiwiConstraint {
@@ -122,6 +153,8 @@ KiwiConstraint* kiwi_constraint_new(
 void kiwi_constraint_release(KiwiConstraint* c);
 void kiwi_constraint_retain(KiwiConstraint* c);
 
+int kiwi_var_new_array(int n, const char* const* names, KiwiVar** out);
+
 double kiwi_constraint_strength(const KiwiConstraint* c);
 enum KiwiRelOp kiwi_constraint_op(const KiwiConstraint* c);
 ]])
@@ -174,9 +207,82 @@ void kiwi_solver_dump(const KiwiSolver* sp);
 char* kiwi_solver_dumps(const KiwiSolver* sp);
 ]])
 
+if not RUST then
+   ffi.cdef([[
+int kiwi_solver_update_vars_changed(KiwiSolver* s, double tolerance, KiwiVar** out, int cap);
+int kiwi_solver_var_count(const KiwiSolver* s);
+void kiwi_solver_get_values(const KiwiSolver* s, KiwiVar* const* vars, double* out, int n);
+void kiwi_solver_bind_values(KiwiSolver* s, double* values, size_t n);
+const KiwiErr* kiwi_solver_set_var_slot(KiwiSolver* s, KiwiVar* var, int slot);
+void kiwi_solver_set_lazy(KiwiSolver* s, bool enabled);
+void kiwi_solver_set_dedup(KiwiSolver* s, bool enabled);
+void kiwi_solver_set_presolve(KiwiSolver* s, bool enabled);
+const KiwiErr* kiwi_solver_set_parallel(KiwiSolver* s, int threads, int min_rows);
+
+typedef struct KiwiSnapshot KiwiSnapshot;
+KiwiSnapshot* kiwi_snapshot_new(int size);
+void kiwi_snapshot_free(KiwiSnapshot* snapshot);
+int kiwi_snapshot_size(const KiwiSnapshot* snapshot);
+uint64_t kiwi_snapshot_version(const KiwiSnapshot* snapshot);
+uint64_t kiwi_snapshot_read(const KiwiSnapshot* snapshot, int first, int count, double* out);
+void kiwi_solver_bind_snapshot(KiwiSolver* s, KiwiSnapshot* snapshot);
+void kiwi_solver_set_deferred(KiwiSolver* s, bool enabled);
+bool kiwi_solver_optimized(const KiwiSolver* s);
+const KiwiErr* kiwi_solver_step(KiwiSolver* s, double seconds, int max_pivots, bool* done);
+const KiwiErr* kiwi_solver_set_constraint_enabled(KiwiSolver* s, KiwiConstraint* constraint, bool enabled);
+bool kiwi_solver_constraint_enabled(const KiwiSolver* s, KiwiConstraint* constraint);
+const KiwiErr* kiwi_solver_set_strength(KiwiSolver* s, KiwiConstraint* constraint, double strength);
+double kiwi_solver_constraint_strength(const KiwiSolver* s, KiwiConstraint* constraint);
+const KiwiErr* kiwi_solver_set_constant(KiwiSolver* s, KiwiConstraint* constraint, double constant);
+const KiwiErr* kiwi_solver_add_constraints(
+    KiwiSolver* s,
+    KiwiConstraint* const* constraints,
+    int n,
+    int* added
+);
+const KiwiErr* kiwi_solver_set_constants(
+    KiwiSolver* s,
+    KiwiConstraint* const* constraints,
+    const double* constants,
+    int n
+);
+double kiwi_solver_constraint_constant(const KiwiSolver* s, KiwiConstraint* constraint);
+const KiwiErr* kiwi_solver_set_coefficient(
+    KiwiSolver* s,
+    KiwiConstraint* constraint,
+    KiwiVar* var,
+    double coefficient
+);
+double kiwi_solver_constraint_coefficient(const KiwiSolver* s, KiwiConstraint* constraint, KiwiVar* var);
+const KiwiErr* kiwi_solver_set_edit_strength(KiwiSolver* s, KiwiVar* var, double strength);
+
+typedef struct KiwiArena KiwiArena;
+KiwiArena* kiwi_arena_new(void);
+void kiwi_arena_free(KiwiArena* a);
+void kiwi_arena_release(KiwiArena* a);
+KiwiExpression* kiwi_arena_expression(KiwiArena* a, int term_count);
+KiwiTerm* kiwi_arena_term(KiwiArena* a);
+bool kiwi_arena_own_constraint(KiwiArena* a, KiwiConstraint* c);
+bool kiwi_arena_contains(const KiwiArena* a, const void* p);
+
+typedef struct KiwiAsyncSolver KiwiAsyncSolver;
+KiwiAsyncSolver* kiwi_async_solver_new(int slot_count);
+void kiwi_async_solver_free(KiwiAsyncSolver* s);
+const KiwiErr* kiwi_async_solver_add_constraint(KiwiAsyncSolver* s, KiwiConstraint* constraint);
+const KiwiErr* kiwi_async_solver_remove_constraint(KiwiAsyncSolver* s, KiwiConstraint* constraint);
+const KiwiErr* kiwi_async_solver_add_edit_var(KiwiAsyncSolver* s, KiwiVar* var, double strength);
+const KiwiErr* kiwi_async_solver_remove_edit_var(KiwiAsyncSolver* s, KiwiVar* var);
+const KiwiErr* kiwi_async_solver_suggest_value(KiwiAsyncSolver* s, KiwiVar* var, double value);
+const KiwiErr* kiwi_async_solver_set_var_slot(KiwiAsyncSolver* s, KiwiVar* var, int slot);
+bool kiwi_async_solver_poll(KiwiAsyncSolver* s, const double** values);
+bool kiwi_async_solver_wait(KiwiAsyncSolver* s, double timeout);
+const KiwiErr* kiwi_async_solver_error(KiwiAsyncSolver* s);
+]])
+end
+
 local strformat = string.format
-local ffi_copy, ffi_gc, ffi_istype, ffi_new, ffi_string =
-   ffi.copy, ffi.gc, ffi.istype, ffi.new, ffi.string
+local ffi_cast, ffi_copy, ffi_gc, ffi_istype, ffi_new, ffi_string =
+   ffi.cast, ffi.copy, ffi.gc, ffi.istype, ffi.new, ffi.string
 
 local concat = table.concat
 local has_table_new, new_tab = pcall(require, "table.new")
@@ -264,6 +370,19 @@ end
 
 local new_constraint
 
+---@type ffi.cdata*? the arena of the innermost `kiwi.scope`
+local scope_arena = nil
+---@type table? weak list of the objects handed out of `scope_arena`
+local scope_handles = nil
+
+--- Record an object handed out of the scope arena. The arena is not reused
+--- while any of them is still reachable.
+local function scope_track(o)
+   local handles = scope_handles --[[@as table]]
+   handles[#handles + 1] = o
+   return o
+end
+
 if RUST then
    ---@return kiwi.Constraint
    function new_constraint(lhs, rhs, op, strength)
@@ -273,22 +392,50 @@ if RUST then
    end
 else
    function new_constraint(lhs, rhs, op, strength)
-      return ffi_gc(
-         ljkiwi.kiwi_constraint_new(lhs, rhs, op or "EQ", strength or REQUIRED),
-         ljkiwi.kiwi_constraint_release
-      ) --[[@as kiwi.Constraint]]
+      local c = ljkiwi.kiwi_constraint_new(lhs, rhs, op or "EQ", strength or REQUIRED)
+      if scope_arena ~= nil then
+         if not ljkiwi.kiwi_arena_own_constraint(scope_arena, c) then
+            error("kiwi library memory allocation error")
+         end
+         return scope_track(c) --[[@as kiwi.Constraint]]
+      end
+      return ffi_gc(c, ljkiwi.kiwi_constraint_release) --[[@as kiwi.Constraint]]
    end
 end
 
-local function var_retain(var)
-   var.ref_count_ = var.ref_count_ + 1
+local var_retain, var_release
+
+if not RUST and ljkiwi.kiwi_atomic_refcount() then
+   -- Counts may be shared with other threads, leave them to the library.
+   var_retain = ljkiwi.kiwi_var_retain
+   var_release = ljkiwi.kiwi_var_release
+else
+   function var_retain(var)
+      var.ref_count_ = var.ref_count_ + 1
+   end
+
+   function var_release(var)
+      var.ref_count_ = var.ref_count_ - 1
+      if var.ref_count_ == 0 then
+         ljkiwi.kiwi_var_free(var)
+      end
+   end
 end
 
-local function var_release(var)
-   var.ref_count_ = var.ref_count_ - 1
-   if var.ref_count_ == 0 then
-      ljkiwi.kiwi_var_free(var)
+--- Allocate a zeroed expression with room for `n` terms. Inside `kiwi.scope` it
+--- comes from the scope arena instead of being collected with a finalizer.
+---@param n integer
+---@return kiwi.Expression
+---@nodiscard
+local function alloc_expr(n)
+   if scope_arena ~= nil then
+      local e = ljkiwi.kiwi_arena_expression(scope_arena, n)
+      if e == nil then
+         error("kiwi library memory allocation error")
+      end
+      return scope_track(e[0])
    end
+   return ffi_gc(ffi_new(Expression, n), ljkiwi.kiwi_expression_destroy) --[[@as kiwi.Expression]]
 end
 
 ---@param expr kiwi.Expression
@@ -296,9 +443,9 @@ end
 ---@param coeff number?
 ---@nodiscard
 local function add_expr_term(expr, var, coeff)
-   local ret = ffi_new(Expression, expr.term_count + 1)
+   local ret = alloc_expr(expr.term_count + 1)
    ljkiwi.kiwi_expression_add_term(expr, var, coeff or 1.0, ret)
-   return ffi_gc(ret, ljkiwi.kiwi_expression_destroy) --[[@as kiwi.Expression]]
+   return ret
 end
 
 ---@param constant number
@@ -306,7 +453,7 @@ end
 ---@param coeff number?
 ---@nodiscard
 local function new_expr_one(constant, var, coeff)
-   local ret = ffi_new(Expression, 1) --[[@as kiwi.Expression]]
+   local ret = alloc_expr(1)
    local dt = ret.terms_[0]
    dt.var = var
    dt.coefficient = coeff or 1.0
@@ -314,7 +461,7 @@ local function new_expr_one(constant, var, coeff)
    ret.term_count = 1
    ret.owner = ret
    var_retain(var)
-   return ffi_gc(ret, ljkiwi.kiwi_expression_destroy) --[[@as kiwi.Expression]]
+   return ret
 end
 
 ---@param constant number
@@ -324,7 +471,7 @@ end
 ---@param coeff2 number?
 ---@nodiscard
 local function new_expr_pair(constant, var1, var2, coeff1, coeff2)
-   local ret = ffi_new(Expression, 2) --[[@as kiwi.Expression]]
+   local ret = alloc_expr(2)
    local dt = ret.terms_[0]
    dt.var = var1
    dt.coefficient = coeff1 or 1.0
@@ -336,9 +483,11 @@ local function new_expr_pair(constant, var1, var2, coeff1, coeff2)
    ret.owner = ret
    var_retain(var1)
    var_retain(var2)
-   return ffi_gc(ret, ljkiwi.kiwi_expression_destroy) --[[@as kiwi.Expression]]
+   return ret
 end
 
+local LinearSum_mt = {}
+
 local function typename(o)
    if ffi.istype(Var, o) then
       return "Var"
@@ -348,6 +497,8 @@ local function typename(o)
       return "Expression"
    elseif ffi.istype(Constraint, o) then
       return "Constraint"
+   elseif getmetatable(o) == LinearSum_mt then
+      return "LinearSum"
    else
       return type(o)
    end
@@ -387,6 +538,8 @@ local function toexpr(o, temp)
       t.coefficient = 1.0
    elseif ffi_istype(Term, o) then
       ffi_copy(t, o, SIZEOF_TERM)
+   elseif getmetatable(o) == LinearSum_mt then
+      return o.expr_
    else
       return nil
    end
@@ -469,17 +622,41 @@ do
       return ffi_string(ljkiwi.kiwi_var_name(self))
    end
 
-   --- Get the current value of the variable.
-   ---@return number
-   ---@nodiscard
-   function Var_cls:value()
-      return self.value_
-   end
+   if RUST then
+      --- Get the current value of the variable.
+      ---@return number
+      ---@nodiscard
+      function Var_cls:value()
+         return self.value_
+      end
 
-   --- Set the value of the variable.
-   ---@param value number
-   function Var_cls:set(value)
-      self.value_ = value
+      --- Set the value of the variable.
+      ---@param value number
+      function Var_cls:set(value)
+         self.value_ = value
+      end
+   else
+      --- Get the current value of the variable.
+      --- Variables of a lazy solver are resolved from the solver if they are out of date.
+      ---@return number
+      ---@nodiscard
+      function Var_cls:value()
+         local lazy = self.lazy_
+         if lazy ~= nil and self.lazy_gen_ ~= lazy.generation then
+            return ljkiwi.kiwi_var_value(self)
+         end
+         return self.value_
+      end
+
+      --- Set the value of the variable.
+      ---@param value number
+      function Var_cls:set(value)
+         self.value_ = value
+         local lazy = self.lazy_
+         if lazy ~= nil then
+            self.lazy_gen_ = lazy.generation
+         end
+      end
    end
 
    --- Create a term from this variable.
@@ -532,6 +709,8 @@ do
          return add_expr_term(b, a)
       elseif type(b) == "number" then
          return new_expr_one(b, a)
+      elseif getmetatable(b) == LinearSum_mt then
+         return add_expr_term(b.expr_, a)
       end
       op_error(a, b, "+")
    end
@@ -545,6 +724,45 @@ do
    end
 
    ffi.metatype(Var, Var_mt)
+
+   local VarPtrArray = ffi.typeof("KiwiVar*[?]")
+   local CStrArray = ffi.typeof("const char*[?]")
+
+   --- Create `n` variables at once. The variables are allocated contiguously,
+   --- which is faster than creating them one at a time and keeps their values
+   --- close together in memory.
+   ---@param n integer
+   ---@param names? (string?)[] optional names, indexed from 1 to n
+   ---@return kiwi.Var[]
+   ---@nodiscard
+   function kiwi.new_vars(n, names)
+      local vars = new_tab(n, 0)
+      if RUST then
+         for i = 1, n do
+            vars[i] = Var(names and names[i])
+         end
+         return vars
+      end
+      if n <= 0 then
+         return vars
+      end
+
+      local cnames
+      if names then
+         cnames = ffi_new(CStrArray, n)
+         for i = 1, n do
+            cnames[i - 1] = names[i]
+         end
+      end
+      local out = ffi_new(VarPtrArray, n)
+      if ljkiwi.kiwi_var_new_array(n, cnames, out) ~= n then
+         error("kiwi library memory allocation error")
+      end
+      for i = 1, n do
+         vars[i] = ffi_gc(out[i - 1][0], var_release)
+      end
+      return vars
+   end
 end
 
 do
@@ -585,6 +803,17 @@ do
    end
 
    function Term_mt.__new(T, var, coefficient)
+      if scope_arena ~= nil then
+         local t = ljkiwi.kiwi_arena_term(scope_arena)
+         if t == nil then
+            error("kiwi library memory allocation error")
+         end
+         t = t[0]
+         t.var = var
+         t.coefficient = coefficient or 1.0
+         var_retain(var)
+         return scope_track(t)
+      end
       local t = ffi_new(T) --[[@as kiwi.Term]]
       t.var = var
       t.coefficient = coefficient or 1.0
@@ -625,6 +854,8 @@ do
          return add_expr_term(b, a.var, a.coefficient)
       elseif type(b) == "number" then
          return new_expr_one(b, a.var, a.coefficient)
+      elseif getmetatable(b) == LinearSum_mt then
+         return add_expr_term(b.expr_, a.var, a.coefficient)
       end
       op_error(a, b, "+")
    end
@@ -663,7 +894,7 @@ do
    ---@param constant number
    ---@nodiscard
    local function mul_expr_coeff(expr, constant)
-      local ret = ffi_new(Expression, expr.term_count) --[[@as kiwi.Expression]]
+      local ret = alloc_expr(expr.term_count)
       for i = 0, expr.term_count - 1 do
          local st = expr.terms_[i] --[[@as kiwi.Term]]
          local dt = ret.terms_[i] --[[@as kiwi.Term]]
@@ -673,7 +904,7 @@ do
       ret.constant = expr.constant * constant
       ret.term_count = expr.term_count
       ljkiwi.kiwi_expression_retain(ret)
-      return ffi_gc(ret, ljkiwi.kiwi_expression_destroy) --[[@as kiwi.Expression]]
+      return ret
    end
 
    ---@param a kiwi.Expression
@@ -682,23 +913,23 @@ do
    local function add_expr_expr(a, b)
       local a_count = a.term_count
       local b_count = b.term_count
-      local ret = ffi_new(Expression, a_count + b_count) --[[@as kiwi.Expression]]
+      local ret = alloc_expr(a_count + b_count)
 
       ffi_copy(ret.terms_, a.terms_, SIZEOF_TERM * a_count)
       ffi_copy(ret.terms_ + a_count, b.terms_, SIZEOF_TERM * b_count)
       ret.constant = a.constant + b.constant
       ret.term_count = a_count + b_count
       ljkiwi.kiwi_expression_retain(ret)
-      return ffi_gc(ret, ljkiwi.kiwi_expression_destroy) --[[@as kiwi.Expression]]
+      return ret
    end
 
    ---@param expr kiwi.Expression
    ---@param constant number
    ---@nodiscard
    local function new_expr_constant(expr, constant)
-      local ret = ffi_new(Expression, expr.term_count)
+      local ret = alloc_expr(expr.term_count)
       ljkiwi.kiwi_expression_set_constant(expr, constant, ret)
-      return ffi_gc(ret, ljkiwi.kiwi_expression_destroy) --[[@as kiwi.Expression]]
+      return ret
    end
 
    ---@return number
@@ -735,7 +966,7 @@ do
 
    function Expression_mt:__new(constant, ...)
       local term_count = select("#", ...)
-      local e = ffi_new(self, term_count) --[[@as kiwi.Expression]]
+      local e = alloc_expr(term_count)
       e.term_count = term_count
       e.constant = constant
       for i = 1, term_count do
@@ -745,7 +976,7 @@ do
          dt.coefficient = t.coefficient
       end
       ljkiwi.kiwi_expression_retain(e)
-      return ffi_gc(e, ljkiwi.kiwi_expression_destroy) --[[@as kiwi.Expression]]
+      return e
    end
 
    function Expression_mt.__mul(a, b)
@@ -781,6 +1012,8 @@ do
          return add_expr_term(a, b.var, b.coefficient)
       elseif type(b) == "number" then
          return new_expr_constant(a, a.constant + b)
+      elseif getmetatable(b) == LinearSum_mt then
+         return add_expr_expr(a, b.expr_)
       end
       op_error(a, b, "+")
    end
@@ -802,6 +1035,191 @@ do
    ffi.metatype(Expression, Expression_mt)
 end
 
+do
+   --- A mutable accumulator for building large linear expressions.
+   --- Terms are appended in place with amortized constant cost, unlike `+` on
+   --- expressions which copies every term. A sum can be used wherever an expression
+   --- is accepted to build a constraint.
+   ---@class kiwi.LinearSum
+   ---@overload fun(capacity: integer?): kiwi.LinearSum
+   ---@field package expr_ kiwi.Expression
+   ---@field package cap_ integer
+   local LinearSum_cls = {
+      le = kiwi.le,
+      ge = kiwi.ge,
+      eq = kiwi.eq,
+   }
+   LinearSum_mt.__index = LinearSum_cls
+
+   local MIN_CAPACITY = 8
+
+   local function new_sum_expr(cap)
+      local expr = ffi_new(Expression, cap) --[[@as kiwi.Expression]]
+      expr.owner = expr
+      return ffi_gc(expr, ljkiwi.kiwi_expression_destroy) --[[@as kiwi.Expression]]
+   end
+
+   ---@param sum kiwi.LinearSum
+   ---@param need integer
+   local function reserve(sum, need)
+      local cap = sum.cap_
+      if need <= cap then
+         return
+      end
+      repeat
+         cap = cap * 2
+      until cap >= need
+      local old = sum.expr_
+      local expr = new_sum_expr(cap)
+      local n = old.term_count
+      ffi_copy(expr.terms_, old.terms_, SIZEOF_TERM * n)
+      expr.constant = old.constant
+      expr.term_count = n
+      -- the terms now belong to the new expression
+      old.owner = nil
+      ffi_gc(old, nil)
+      sum.expr_ = expr
+      sum.cap_ = cap
+   end
+
+   ---@param sum kiwi.LinearSum
+   ---@param var kiwi.Var
+   ---@param coeff number
+   local function push_term(sum, var, coeff)
+      local expr = sum.expr_
+      local n = expr.term_count
+      if n == sum.cap_ then
+         reserve(sum, n + 1)
+         expr = sum.expr_
+      end
+      local dt = expr.terms_[n]
+      dt.var = var
+      dt.coefficient = coeff
+      expr.term_count = n + 1
+      var_retain(var)
+   end
+
+   --- Add `coeff * var` to the sum. A term may be passed in place of a variable,
+   --- in which case its coefficient is scaled by `coeff`.
+   ---@param var kiwi.Var|kiwi.Term
+   ---@param coeff number?
+   ---@return kiwi.LinearSum self
+   function LinearSum_cls:add(var, coeff)
+      coeff = coeff or 1.0
+      if ffi_istype(Var, var) then
+         push_term(self, var, coeff)
+      elseif ffi_istype(Term, var) then
+         push_term(self, var.var, var.coefficient * coeff)
+      else
+         op_error(self, var, "add")
+      end
+      return self
+   end
+
+   --- Add `scale * expr` to the sum.
+   ---@param expr kiwi.Expression|kiwi.LinearSum|kiwi.Term|kiwi.Var|number
+   ---@param scale number?
+   ---@return kiwi.LinearSum self
+   function LinearSum_cls:add_expr(expr, scale)
+      scale = scale or 1.0
+      local e = toexpr(expr, tmpexpr)
+      if e == nil then
+         op_error(self, expr, "add_expr")
+      end
+      local n = e.term_count
+      reserve(self, self.expr_.term_count + n)
+      for i = 0, n - 1 do
+         local t = e.terms_[i]
+         push_term(self, t.var, t.coefficient * scale)
+      end
+      self.expr_.constant = self.expr_.constant + e.constant * scale
+      return self
+   end
+
+   --- Add a constant to the sum.
+   ---@param constant number
+   ---@return kiwi.LinearSum self
+   function LinearSum_cls:add_constant(constant)
+      local expr = self.expr_
+      expr.constant = expr.constant + constant
+      return self
+   end
+
+   --- Remove all terms and reset the constant, keeping the capacity.
+   ---@return kiwi.LinearSum self
+   function LinearSum_cls:clear()
+      local expr = self.expr_
+      for i = 0, expr.term_count - 1 do
+         var_release(expr.terms_[i].var)
+      end
+      expr.term_count = 0
+      expr.constant = 0.0
+      return self
+   end
+
+   --- The number of terms in the sum. Repeated variables are counted each time.
+   ---@return integer
+   ---@nodiscard
+   function LinearSum_cls:term_count()
+      return self.expr_.term_count
+   end
+
+   ---@return number
+   ---@nodiscard
+   function LinearSum_cls:value()
+      return self.expr_:value()
+   end
+
+   --- Create an expression from the current contents of the sum.
+   ---@return kiwi.Expression
+   ---@nodiscard
+   function LinearSum_cls:expression()
+      return self.expr_:copy()
+   end
+
+   ---@param o any
+   local function sum_expr(o)
+      return getmetatable(o) == LinearSum_mt and o.expr_ or o
+   end
+
+   function LinearSum_mt.__add(a, b)
+      return sum_expr(a) + sum_expr(b)
+   end
+
+   function LinearSum_mt.__sub(a, b)
+      return sum_expr(a) - sum_expr(b)
+   end
+
+   function LinearSum_mt.__mul(a, b)
+      return sum_expr(a) * sum_expr(b)
+   end
+
+   function LinearSum_mt.__div(a, b)
+      return sum_expr(a) / sum_expr(b)
+   end
+
+   function LinearSum_mt:__unm()
+      return -self.expr_
+   end
+
+   function LinearSum_mt:__tostring()
+      return tostring(self.expr_)
+   end
+
+   --- Create an empty linear sum.
+   ---@param capacity integer? the initial number of terms to reserve
+   ---@return kiwi.LinearSum
+   ---@nodiscard
+   function kiwi.LinearSum(capacity)
+      local cap = math.max(capacity or 0, MIN_CAPACITY)
+      return setmetatable({ expr_ = new_sum_expr(cap), cap_ = cap }, LinearSum_mt)
+   end
+
+   function kiwi.is_linear_sum(o)
+      return getmetatable(o) == LinearSum_mt
+   end
+end
+
 do
    --- A constraint is a linear inequality or equality with associated strength.
    --- Constraints can be built with arbitrary left and right hand expressions. But
@@ -844,13 +1262,13 @@ do
    ---@nodiscard
    function Constraint_cls:expression()
       local SZ = 7
-      local expr = ffi_new(Expression, SZ) --[[@as kiwi.Expression]]
+      local expr = alloc_expr(SZ)
       local n = ljkiwi.kiwi_constraint_expression(self, expr, SZ)
       if n > SZ then
-         expr = ffi_new(Expression, n) --[[@as kiwi.Expression]]
+         expr = alloc_expr(n)
          n = ljkiwi.kiwi_constraint_expression(self, expr, n)
       end
-      return ffi_gc(expr, ljkiwi.kiwi_expression_destroy) --[[@as kiwi.Expression]]
+      return expr
    end
 
    --- Add the constraint to the solver.
@@ -1043,6 +1461,21 @@ do
       "null object passed as argument.",
       "An unknown error occurred.",
    }
+
+   ---@param err kiwi.KiwiErr
+   ---@param solver any
+   ---@param item any
+   ---@return kiwi.Error
+   local function error_data(err, solver, item)
+      if err.must_release then
+         ffi_gc(err, ljkiwi.kiwi_err_release)
+      end
+      local message = err.message ~= nil and ffi_string(err.message)
+         or ERR_MESSAGES[tonumber(err.kind)]
+         or ""
+      return new_error(err.kind, message, solver, item)
+   end
+
    ---@generic T
    ---@param f fun(solver: kiwi.Solver, item: T, ...): kiwi.KiwiErr?
    ---@param solver kiwi.Solver
@@ -1051,17 +1484,10 @@ do
    local function try_solver(f, solver, item, ...)
       local err = f(solver, item, ...)
       if err ~= nil then
-         if err.must_release then
-            ffi_gc(err, ljkiwi.kiwi_err_release)
-         end
-         local kind = err.kind
-         local message = err.message ~= nil and ffi_string(err.message)
-            or ERR_MESSAGES[tonumber(err.kind)]
-            or ""
-         local errdata = new_error(kind, message, solver, item)
+         local errdata = error_data(err, solver, item)
          local error_mask = ljkiwi.kiwi_solver_get_error_mask(solver)
          return item,
-            band(error_mask, lshift(1, kind --[[@as integer]])) == 0 and error(errdata)
+            band(error_mask, lshift(1, errdata.kind --[[@as integer]])) == 0 and error(errdata)
                or errdata
       end
       return item
@@ -1235,6 +1661,425 @@ do
       return vars, values
    end
 
+   ---@param f fun(solver: kiwi.Solver, item: any, ...): kiwi.KiwiErr?
+   ---@return boolean ok, integer? kind
+   local function try_status(f, solver, item, ...)
+      local err = f(solver, item, ...)
+      if err == nil then
+         return true
+      end
+      local kind = tonumber(err.kind)
+      if err.must_release then
+         ljkiwi.kiwi_err_release(err)
+      end
+      return false, kind
+   end
+
+   --- Add a constraint to the solver without building an error on failure.
+   --- Unlike `add_constraint`, this never raises for solver errors and ignores the error mask.
+   ---@param constraint kiwi.Constraint
+   ---@return boolean ok, integer? kind the `kiwi.ErrKind` value when not ok
+   function Solver_cls:try_add_constraint(constraint)
+      return try_status(ljkiwi.kiwi_solver_add_constraint, self, constraint)
+   end
+
+   --- Remove a constraint from the solver without building an error on failure.
+   ---@param constraint kiwi.Constraint
+   ---@return boolean ok, integer? kind the `kiwi.ErrKind` value when not ok
+   function Solver_cls:try_remove_constraint(constraint)
+      return try_status(ljkiwi.kiwi_solver_remove_constraint, self, constraint)
+   end
+
+   --- Add an edit variable to the solver without building an error on failure.
+   ---@param var kiwi.Var
+   ---@param strength number
+   ---@return boolean ok, integer? kind the `kiwi.ErrKind` value when not ok
+   function Solver_cls:try_add_edit_var(var, strength)
+      return try_status(ljkiwi.kiwi_solver_add_edit_var, self, var, strength)
+   end
+
+   --- Remove an edit variable from the solver without building an error on failure.
+   ---@param var kiwi.Var
+   ---@return boolean ok, integer? kind the `kiwi.ErrKind` value when not ok
+   function Solver_cls:try_remove_edit_var(var)
+      return try_status(ljkiwi.kiwi_solver_remove_edit_var, self, var)
+   end
+
+   --- Suggest a value for an edit variable without building an error on failure.
+   ---@param var kiwi.Var
+   ---@param value number
+   ---@return boolean ok, integer? kind the `kiwi.ErrKind` value when not ok
+   function Solver_cls:try_suggest_value(var, value)
+      return try_status(ljkiwi.kiwi_solver_suggest_value, self, var, value)
+   end
+
+   if not RUST then
+      local bound_values = setmetatable({}, { __mode = "k" })
+      local DoubleArray = ffi.typeof("double[?]")
+      local VarPtrArray = ffi.typeof("KiwiVar*[?]")
+      local VarPtr = ffi.typeof("KiwiVar*")
+      local uintptr_t = ffi.typeof("uintptr_t")
+
+      local ConstraintPtrArray = ffi.typeof("KiwiConstraint*[?]")
+
+      local get_vars_buf, get_values_buf, get_buf_size = nil, nil, 0
+      local changed_buf, changed_buf_size = nil, 0
+      local set_cns_buf, set_constants_buf, set_buf_size = nil, nil, 0
+
+      local changed_set = {}
+
+      --- Update the values of the external solver variables and return the variables
+      --- whose value moved by more than `tolerance` (default 0).
+      --- Values that move by less are not written, so small drifts accumulate until reported.
+      --- When `vars` is given the result holds the changed variables of `vars`, as the
+      --- caller's own objects and in the order of `vars`. Otherwise the returned variables
+      --- are new handles that compare equal (`==`) to the originals.
+      ---@param tolerance? number
+      ---@param vars? kiwi.Var[]
+      ---@return kiwi.Var[]
+      function Solver_cls:update_vars_changed(tolerance, vars)
+         local cap = ljkiwi.kiwi_solver_var_count(self)
+         if cap > changed_buf_size then
+            changed_buf_size = cap
+            changed_buf = ffi_new(VarPtrArray, cap)
+         end
+         local n = ljkiwi.kiwi_solver_update_vars_changed(self, tolerance or 0.0, changed_buf, cap)
+         if vars then
+            local ret = {}
+            if n == 0 then
+               return ret
+            end
+            for i = 0, n - 1 do
+               changed_set[tonumber(ffi_cast(uintptr_t, changed_buf[i]))] = true
+            end
+            local count, bad = 0, nil
+            for i = 1, #vars do
+               local var = vars[i]
+               if not ffi_istype(Var, var) then
+                  bad = i
+                  break
+               end
+               if changed_set[tonumber(ffi_cast(uintptr_t, ffi_cast(VarPtr, var)))] then
+                  count = count + 1
+                  ret[count] = var
+               end
+            end
+            for i = 0, n - 1 do
+               changed_set[tonumber(ffi_cast(uintptr_t, changed_buf[i]))] = nil
+            end
+            if bad then
+               error(strformat("bad argument #2 to 'update_vars_changed' (kiwi.Var expected at index %d)", bad), 2)
+            end
+            return ret
+         end
+
+         local ret = new_tab(n, 0)
+         for i = 1, n do
+            local var = changed_buf[i - 1][0]
+            var_retain(var)
+            ret[i] = ffi_gc(var, var_release)
+         end
+         return ret
+      end
+
+      --- Read the current solution for `vars` without updating the variables.
+      --- `out` may be a `double` cdata array, which is filled from index 0, or a table,
+      --- which is filled from index 1. A new table is returned when `out` is omitted.
+      --- Variables unknown to the solver report their current value.
+      ---@param vars kiwi.Var[]
+      ---@param out? number[]|ffi.cdata*
+      ---@return number[]|ffi.cdata* out
+      function Solver_cls:get_values(vars, out)
+         local n = #vars
+         if n > get_buf_size then
+            get_buf_size = n
+            get_vars_buf = ffi_new(VarPtrArray, n)
+            get_values_buf = ffi_new(DoubleArray, n)
+         end
+         for i = 1, n do
+            get_vars_buf[i - 1] = vars[i]
+         end
+
+         if type(out) == "cdata" then
+            ljkiwi.kiwi_solver_get_values(self, get_vars_buf, out, n)
+            return out
+         end
+
+         ljkiwi.kiwi_solver_get_values(self, get_vars_buf, get_values_buf, n)
+         out = out or new_tab(n, 0)
+         for i = 1, n do
+            out[i] = get_values_buf[i - 1]
+         end
+         return out
+      end
+
+      --- Bind a value buffer of `n` slots to the solver.
+      --- After binding, `update_vars` writes the value of each variable assigned a slot
+      --- with `set_var_slot` into the buffer instead of the variable itself.
+      --- Calling without `n` unbinds the current buffer.
+      ---@param n integer? the number of slots
+      ---@return ffi.cdata*? values a zero based `double[n]` array, nil when unbound
+      function Solver_cls:bind_values(n)
+         if n == nil or n <= 0 then
+            ljkiwi.kiwi_solver_bind_values(self, nil, 0)
+            bound_values[self] = nil
+            return nil
+         end
+         local values = ffi_new(DoubleArray, n)
+         ljkiwi.kiwi_solver_bind_values(self, values, n)
+         bound_values[self] = values
+         return values
+      end
+
+      local bound_snapshots = setmetatable({}, { __mode = "k" })
+
+      --- Bind a snapshot which `update_vars` publishes the values of slotted variables to.
+      --- Each update writes every variable with a slot below `snapshot:size()` as one
+      --- frame, which other threads read consistently without locking.
+      --- Calling without a snapshot unbinds the current one.
+      ---@param snapshot kiwi.Snapshot?
+      ---@return kiwi.Snapshot? snapshot
+      function Solver_cls:bind_snapshot(snapshot)
+         ljkiwi.kiwi_solver_bind_snapshot(self, snapshot)
+         bound_snapshots[self] = snapshot
+         return snapshot
+      end
+
+      --- Assign the zero based slot in the bound value buffer for a variable.
+      --- The variable does not need to be part of any constraint yet.
+      --- A nil or negative slot removes the assignment.
+      ---@param var kiwi.Var
+      ---@param slot integer?
+      ---@return kiwi.Var var, kiwi.Error?
+      function Solver_cls:set_var_slot(var, slot)
+         return try_solver(ljkiwi.kiwi_solver_set_var_slot, self, var, slot or -1)
+      end
+
+      --- Enable or disable lazy variable updates.
+      --- In lazy mode `update_vars` takes constant time, apart from writing a bound
+      --- value buffer or snapshot, and each variable computes its value from the
+      --- solver when it is next read with `Var:value`.
+      ---@param enabled boolean
+      function Solver_cls:set_lazy(enabled)
+         ljkiwi.kiwi_solver_set_lazy(self, not not enabled)
+      end
+
+      --- Enable or disable sharing of rows between equivalent constraints.
+      --- A constraint equal in terms, operator, strength and constant to one already in
+      --- the solver shares its row, as does a required inequality implied by a tighter one.
+      --- Only constraints added while enabled are shared.
+      ---@param enabled boolean
+      function Solver_cls:set_dedup(enabled)
+         ljkiwi.kiwi_solver_set_dedup(self, not not enabled)
+      end
+
+      --- Enable or disable presolving of trivial required constraints.
+      --- A required `x == c` or `x == y + c` whose `x` is new to the solver fixes `x` or
+      --- makes it an alias of `y` instead of adding a row to the tableau, and a required
+      --- `x >= c` or `x <= c` becomes a bound on `x`. Removing or changing the constraint
+      --- splits the alias again. Only variables new to the solver are presolved, the same
+      --- constraints on a variable already in the tableau get a row as usual.
+      ---@param enabled boolean
+      function Solver_cls:set_presolve(enabled)
+         ljkiwi.kiwi_solver_set_presolve(self, not not enabled)
+      end
+
+      local step_done = ffi_new("bool[1]")
+
+      --- Enable or disable deferred optimization.
+      --- While enabled, updates leave their reoptimization pending until `step` carries
+      --- it out, so a large change can be spread over several frames. Between steps
+      --- after structural updates the values are feasible but not yet optimal, after
+      --- suggested values `update_vars` keeps the values of the last update until
+      --- `step` returns true. Disabling finishes any pending optimization.
+      ---@param enabled boolean
+      function Solver_cls:set_deferred(enabled)
+         ljkiwi.kiwi_solver_set_deferred(self, not not enabled)
+      end
+
+      --- Test whether no deferred optimization is pending.
+      ---@return boolean
+      function Solver_cls:optimized()
+         return ljkiwi.kiwi_solver_optimized(self)
+      end
+
+      --- Carry out pending deferred optimization for at most `budget` seconds.
+      ---@param budget number? seconds, nil runs until done
+      ---@param max_pivots integer? an additional limit on the number of pivots
+      ---@return boolean done true once the solver is optimal and feasible
+      function Solver_cls:step(budget, max_pivots)
+         local err = ljkiwi.kiwi_solver_step(self, budget or -1, max_pivots or -1, step_done)
+         if err ~= nil then
+            error(error_data(err, self, nil))
+         end
+         return step_done[0]
+      end
+
+      --- Split the pivots of large tableaux across a pool of threads.
+      --- Once the tableau holds at least `min_rows` rows, row updates and leaving row
+      --- searches run on `threads` threads, the calling thread included. Results are
+      --- the same as with one thread. A thread count below two disables the mode.
+      ---@param threads integer
+      ---@param min_rows integer? defaults to 16384
+      function Solver_cls:set_parallel(threads, min_rows)
+         local err = ljkiwi.kiwi_solver_set_parallel(self, threads, min_rows or -1)
+         if err ~= nil then
+            error(error_data(err, self, nil))
+         end
+      end
+
+      --- Enable or disable a constraint without removing it from the solver.
+      --- Disabled soft constraints stay in the tableau and are re-enabled by reoptimizing.
+      --- Errors:
+      --- KiwiErrUnknownConstraint
+      --- KiwiErrUnsatisfiableConstraint: a required constraint cannot be enabled again.
+      ---@param constraint kiwi.Constraint
+      ---@param enabled boolean? defaults to true
+      ---@return kiwi.Constraint constraint, kiwi.Error?
+      function Solver_cls:set_constraint_enabled(constraint, enabled)
+         return try_solver(
+            ljkiwi.kiwi_solver_set_constraint_enabled,
+            self,
+            constraint,
+            enabled == nil or not not enabled
+         )
+      end
+
+      --- Test whether a constraint in the solver is enabled.
+      ---@type fun(self: kiwi.Solver, constraint: kiwi.Constraint): boolean
+      Solver_cls.constraint_enabled = ljkiwi.kiwi_solver_constraint_enabled
+
+      --- Change the strength of a non-required constraint in the solver.
+      --- The objective is adjusted in place; the constraint keeps the strength it was
+      --- created with, see `constraint_strength` for the strength used by the solver.
+      --- Errors:
+      --- KiwiErrUnknownConstraint
+      --- KiwiErrBadRequiredStrength: the constraint is required or `strength` is.
+      ---@param constraint kiwi.Constraint
+      ---@param strength number
+      ---@return kiwi.Constraint constraint, kiwi.Error?
+      function Solver_cls:set_strength(constraint, strength)
+         return try_solver(ljkiwi.kiwi_solver_set_strength, self, constraint, strength)
+      end
+
+      --- Get the strength a constraint has in the solver, nil if it was not added.
+      ---@param constraint kiwi.Constraint
+      ---@return number?
+      function Solver_cls:constraint_strength(constraint)
+         local strength = ljkiwi.kiwi_solver_constraint_strength(self, constraint)
+         return strength >= 0 and strength or nil
+      end
+
+      --- Change the constant of a constraint in the solver.
+      --- The constant is that of the constraint expression, so `x:eq(10)` has a constant
+      --- of -10. The tableau is updated in place like `suggest_value`, the constraint itself
+      --- is not modified, see `constraint_constant` for the constant used by the solver.
+      --- Errors:
+      --- KiwiErrUnknownConstraint
+      --- KiwiErrUnsatisfiableConstraint: the previous constant is kept.
+      ---@param constraint kiwi.Constraint
+      ---@param constant number
+      ---@return kiwi.Constraint constraint, kiwi.Error?
+      function Solver_cls:set_constant(constraint, constant)
+         return try_solver(ljkiwi.kiwi_solver_set_constant, self, constraint, constant)
+      end
+
+      local function set_constants_buffered(solver, _, n)
+         return ljkiwi.kiwi_solver_set_constants(solver, set_cns_buf, set_constants_buf, n)
+      end
+
+      --- Change the constants of several constraints with a single reoptimization.
+      --- `constants[i]` is the new constant of `constraints[i]`. Either all constants are
+      --- changed or, on error, none are.
+      --- Errors:
+      --- KiwiErrUnknownConstraint
+      --- KiwiErrUnsatisfiableConstraint
+      ---@param constraints kiwi.Constraint[]
+      ---@param constants number[]
+      ---@return kiwi.Constraint[] constraints, kiwi.Error?
+      function Solver_cls:set_constants(constraints, constants)
+         local n = #constraints
+         if n > set_buf_size then
+            set_buf_size = n
+            set_cns_buf = ffi_new(ConstraintPtrArray, n)
+            set_constants_buf = ffi_new(DoubleArray, n)
+         end
+         for i = 1, n do
+            set_cns_buf[i - 1] = constraints[i]
+            set_constants_buf[i - 1] = constants[i]
+         end
+         return try_solver(set_constants_buffered, self, constraints, n)
+      end
+
+      local add_cns_buf, add_buf_size = nil, 0
+      local add_count = ffi_new("int[1]")
+
+      --- Add constraints to the solver, optimizing once for the whole batch.
+      --- The constraints are added in order and the first failure stops the batch,
+      --- the constraints before it stay in the solver. The error item is the failing
+      --- constraint.
+      --- Errors:
+      --- KiwiErrDuplicateConstraint
+      --- KiwiErrUnsatisfiableConstraint
+      ---@param constraints kiwi.Constraint[]
+      ---@return kiwi.Constraint[] constraints, kiwi.Error?
+      function Solver_cls:add_constraints(constraints)
+         local n = #constraints
+         if n > add_buf_size then
+            add_buf_size = n
+            add_cns_buf = ffi_new(ConstraintPtrArray, n)
+         end
+         for i = 1, n do
+            add_cns_buf[i - 1] = constraints[i]
+         end
+         local err = ljkiwi.kiwi_solver_add_constraints(self, add_cns_buf, n, add_count)
+         if err ~= nil then
+            local errdata = error_data(err, self, constraints[add_count[0] + 1])
+            local error_mask = ljkiwi.kiwi_solver_get_error_mask(self)
+            if band(error_mask, lshift(1, errdata.kind --[[@as integer]])) == 0 then
+               error(errdata)
+            end
+            return constraints, errdata
+         end
+         return constraints
+      end
+
+      --- Get the constant a constraint has in the solver, 0 if it was not added.
+      ---@type fun(self: kiwi.Solver, constraint: kiwi.Constraint): number
+      Solver_cls.constraint_constant = ljkiwi.kiwi_solver_constraint_constant
+
+      --- Change the coefficient of a variable in a constraint in the solver.
+      --- A coefficient of 0 takes the variable out of the constraint, and a variable
+      --- that is not part of it yet is added. Like `set_constant` the constraint itself
+      --- is not modified, see `constraint_coefficient` for the value used by the solver.
+      --- Errors:
+      --- KiwiErrUnknownConstraint
+      --- KiwiErrUnsatisfiableConstraint: the previous coefficient is kept.
+      ---@param constraint kiwi.Constraint
+      ---@param var kiwi.Var
+      ---@param coefficient number
+      ---@return kiwi.Constraint constraint, kiwi.Error?
+      function Solver_cls:set_coefficient(constraint, var, coefficient)
+         return try_solver(ljkiwi.kiwi_solver_set_coefficient, self, constraint, var, coefficient)
+      end
+
+      --- Get the coefficient of a variable in a constraint in the solver, 0 if the
+      --- variable is not part of it or the constraint was not added.
+      ---@type fun(self: kiwi.Solver, constraint: kiwi.Constraint, var: kiwi.Var): number
+      Solver_cls.constraint_coefficient = ljkiwi.kiwi_solver_constraint_coefficient
+
+      --- Change the strength of an edit variable in the solver.
+      --- Errors:
+      --- KiwiErrUnknownEditVar
+      --- KiwiErrBadRequiredStrength: The given strength is >= required.
+      ---@param var kiwi.Var
+      ---@param strength number
+      ---@return kiwi.Var var, kiwi.Error?
+      function Solver_cls:set_edit_strength(var, strength)
+         return try_solver(ljkiwi.kiwi_solver_set_edit_strength, self, var, strength)
+      end
+   end
+
    --- Dump a representation of the solver to a string.
    ---@return string
    ---@nodiscard
@@ -1262,6 +2107,310 @@ do
    function kiwi.is_solver(s)
       return ffi_istype(Solver, s)
    end
+
+   if not RUST then
+      ---@class kiwi.AsyncSolver: ffi.cdata*
+      local AsyncSolver_cls = {}
+
+      local values_out = ffi_new("const double*[1]")
+
+      ---@generic T
+      ---@param f fun(solver: kiwi.AsyncSolver, item: T, ...): kiwi.KiwiErr?
+      ---@param solver kiwi.AsyncSolver
+      ---@param item T
+      ---@return T
+      local function try_async(f, solver, item, ...)
+         local err = f(solver, item, ...)
+         if err ~= nil then
+            error(error_data(err, solver, item))
+         end
+         return item
+      end
+
+      --- Queue adding a constraint.
+      --- Solver failures are reported later through `take_error`.
+      ---@param constraint kiwi.Constraint
+      ---@return kiwi.Constraint constraint
+      function AsyncSolver_cls:add_constraint(constraint)
+         return try_async(ljkiwi.kiwi_async_solver_add_constraint, self, constraint)
+      end
+
+      --- Queue removing a constraint.
+      ---@param constraint kiwi.Constraint
+      ---@return kiwi.Constraint constraint
+      function AsyncSolver_cls:remove_constraint(constraint)
+         return try_async(ljkiwi.kiwi_async_solver_remove_constraint, self, constraint)
+      end
+
+      --- Queue adding an edit variable.
+      ---@param var kiwi.Var
+      ---@param strength number
+      ---@return kiwi.Var var
+      function AsyncSolver_cls:add_edit_var(var, strength)
+         return try_async(ljkiwi.kiwi_async_solver_add_edit_var, self, var, strength)
+      end
+
+      --- Queue removing an edit variable.
+      ---@param var kiwi.Var
+      ---@return kiwi.Var var
+      function AsyncSolver_cls:remove_edit_var(var)
+         return try_async(ljkiwi.kiwi_async_solver_remove_edit_var, self, var)
+      end
+
+      --- Queue suggesting a value for an edit variable.
+      ---@param var kiwi.Var
+      ---@param value number
+      ---@return kiwi.Var var
+      function AsyncSolver_cls:suggest_value(var, value)
+         return try_async(ljkiwi.kiwi_async_solver_suggest_value, self, var, value)
+      end
+
+      --- Queue assigning the zero based snapshot slot of a variable.
+      --- A nil or negative slot removes the assignment.
+      ---@param var kiwi.Var
+      ---@param slot integer?
+      ---@return kiwi.Var var
+      function AsyncSolver_cls:set_var_slot(var, slot)
+         return try_async(ljkiwi.kiwi_async_solver_set_var_slot, self, var, slot or -1)
+      end
+
+      --- Pin the latest published snapshot without blocking.
+      --- The returned array stays valid and unchanged until the next `poll`.
+      ---@return boolean changed true if a new snapshot was published since the last poll
+      ---@return ffi.cdata* values a zero based `double` array with one value per slot
+      function AsyncSolver_cls:poll()
+         local changed = ljkiwi.kiwi_async_solver_poll(self, values_out)
+         return changed, values_out[0]
+      end
+
+      --- Wait until every queued mutation has been solved and published.
+      ---@param timeout number? seconds to wait, nil waits forever and 0 only checks
+      ---@return boolean done
+      function AsyncSolver_cls:wait(timeout)
+         return ljkiwi.kiwi_async_solver_wait(self, timeout or -1)
+      end
+
+      --- Take the first failure of a queued mutation since the last call.
+      ---@return kiwi.Error?
+      function AsyncSolver_cls:take_error()
+         local err = ljkiwi.kiwi_async_solver_error(self)
+         if err ~= nil then
+            return error_data(err, self, nil)
+         end
+      end
+
+      local AsyncSolver = ffi.metatype(ffi.typeof("struct KiwiAsyncSolver"), {
+         __index = AsyncSolver_cls,
+      })
+
+      --- Create a solver which applies queued mutations on a worker thread and
+      --- publishes the values of `slot_count` slotted variables after each batch.
+      --- Requires a library built with `FATOMIC_REFCOUNT`, variables are shared
+      --- with the worker. They and the constraints may also be used by other
+      --- solvers meanwhile, the worker never writes their values.
+      --- Only the LuaJIT FFI bindings provide it, the Lua C module does not.
+      ---@param slot_count integer
+      ---@return kiwi.AsyncSolver
+      function kiwi.AsyncSolver(slot_count)
+         if not ljkiwi.kiwi_atomic_refcount() then
+            error("kiwi.AsyncSolver requires a library built with atomic reference counts")
+         end
+         local s = ljkiwi.kiwi_async_solver_new(slot_count or 0)
+         if s == nil then
+            error("failed to start the async solver")
+         end
+         return ffi_gc(s, ljkiwi.kiwi_async_solver_free)
+      end
+
+      function kiwi.is_async_solver(s)
+         return ffi_istype(AsyncSolver, s)
+      end
+   end
+end
+
+if not RUST then
+   ---@class kiwi.Snapshot: ffi.cdata*
+   local Snapshot_cls = {}
+
+   --- The number of slots in the snapshot.
+   ---@type fun(self: kiwi.Snapshot): integer
+   Snapshot_cls.size = ljkiwi.kiwi_snapshot_size
+
+   --- The number of frames published so far.
+   ---@return integer
+   function Snapshot_cls:version()
+      return tonumber(ljkiwi.kiwi_snapshot_version(self)) --[[@as integer]]
+   end
+
+   --- Copy the latest complete frame without locking.
+   --- May be called from any thread, also on a pointer cast from another Lua state
+   --- with `ffi.cast("KiwiSnapshot*", address)`.
+   ---@param out ffi.cdata*? a zero based `double` array of at least `size()` values
+   ---@return integer version, ffi.cdata* values
+   function Snapshot_cls:read(out)
+      local n = ljkiwi.kiwi_snapshot_size(self)
+      out = out or ffi_new("double[?]", n)
+      local version = ljkiwi.kiwi_snapshot_read(self, 0, n, out)
+      return tonumber(version) --[[@as integer]], out
+   end
+
+   local Snapshot = ffi.metatype(ffi.typeof("struct KiwiSnapshot"), {
+      __index = Snapshot_cls,
+   })
+
+   --- Create a snapshot of `size` values, all NaN until the first frame.
+   --- The snapshot must outlive the readers in other threads.
+   ---@param size integer
+   ---@return kiwi.Snapshot
+   function kiwi.Snapshot(size)
+      local s = ljkiwi.kiwi_snapshot_new(size)
+      if s == nil then
+         error("kiwi library memory allocation error")
+      end
+      return ffi_gc(s, ljkiwi.kiwi_snapshot_free)
+   end
+
+   function kiwi.is_snapshot(s)
+      return ffi_istype(Snapshot, s)
+   end
+end
+
+do
+   --- Scoped allocation of temporary expressions, terms and constraints.
+   --- Inside `kiwi.scope` these objects are allocated from a C arena without
+   --- finalizers. When the scope exits the arena is retired, and it is released
+   --- in one pass and reused once the GC has collected every object it handed
+   --- out. A temporary that outlives the scope, as an error item or in a table or
+   --- upvalue, therefore stays valid but keeps the whole arena alive. Values
+   --- returned from `fn` are promoted to the enclosing scope, and `kiwi.promote`
+   --- copies any other object out so the arena can be reused sooner. Constraints
+   --- added to a solver remain in the solver. `fn` must not yield.
+   if RUST then
+      ---@generic T
+      ---@param fn fun(...): T
+      ---@return T
+      function kiwi.scope(fn, ...)
+         return fn(...)
+      end
+
+      ---@generic T
+      ---@param o T
+      ---@return T
+      function kiwi.promote(o)
+         return o
+      end
+   else
+      local unpack = unpack or table.unpack ---@diagnostic disable-line: deprecated
+      local ConstraintPtr = ffi.typeof("KiwiConstraint*")
+      local weak_values = { __mode = "v" }
+      -- Arenas ready for a new scope and the (empty) handle lists that go with them.
+      local free_arenas, free_handles = {}, {}
+      -- Arenas of exited scopes whose objects may still be referenced.
+      local retired_arenas, retired_handles = {}, {}
+
+      -- Move the retired arenas with no reachable object to the free lists.
+      local function reclaim_arenas()
+         local n = #retired_arenas
+         local kept = 0
+         for i = 1, n do
+            local arena, handles = retired_arenas[i], retired_handles[i]
+            if next(handles) == nil then
+               ljkiwi.kiwi_arena_release(arena)
+               free_arenas[#free_arenas + 1] = arena
+               free_handles[#free_handles + 1] = handles
+            else
+               kept = kept + 1
+               retired_arenas[kept] = arena
+               retired_handles[kept] = handles
+            end
+         end
+         for i = kept + 1, n do
+            retired_arenas[i] = nil
+            retired_handles[i] = nil
+         end
+      end
+
+      -- Copy an object out of `arena` into the current scope (or the GC when none).
+      local function promote(arena, o)
+         if type(o) ~= "cdata" then
+            return o
+         elseif ffi_istype(Constraint, o) then
+            ljkiwi.kiwi_constraint_retain(o)
+            if scope_arena == nil then
+               return ffi_gc(ffi.cast(ConstraintPtr, o), ljkiwi.kiwi_constraint_release)
+            elseif not ljkiwi.kiwi_arena_own_constraint(scope_arena, o) then
+               error("kiwi library memory allocation error")
+            end
+            return scope_track(o)
+         elseif arena == nil or not ljkiwi.kiwi_arena_contains(arena, o) then
+            return o
+         elseif ffi_istype(Expression, o) then
+            return o:copy()
+         elseif ffi_istype(Term, o) then
+            return Term(o.var, o.coefficient)
+         end
+         return o
+      end
+
+      local function scope_exit(arena, handles, outer, outer_handles, ok, ...)
+         scope_arena, scope_handles = outer, outer_handles
+         local n = select("#", ...)
+         local ret
+         if ok and n > 0 then
+            ret = { ... }
+            for i = 1, n do
+               ret[i] = promote(arena, ret[i])
+            end
+         end
+         retired_arenas[#retired_arenas + 1] = arena
+         retired_handles[#retired_handles + 1] = handles
+         if not ok then
+            error((...), 0)
+         end
+         if ret then
+            return unpack(ret, 1, n)
+         end
+      end
+
+      --- Run `fn(...)` with temporaries allocated from a scope arena.
+      ---@generic T
+      ---@param fn fun(...): T
+      ---@return T
+      function kiwi.scope(fn, ...)
+         if #free_arenas == 0 then
+            reclaim_arenas()
+         end
+         local n = #free_arenas
+         local arena, handles = free_arenas[n], free_handles[n]
+         if arena ~= nil then
+            free_arenas[n], free_handles[n] = nil, nil
+         else
+            arena = ljkiwi.kiwi_arena_new()
+            if arena == nil then
+               error("kiwi library memory allocation error")
+            end
+            arena = ffi_gc(arena, ljkiwi.kiwi_arena_free)
+            handles = setmetatable({}, weak_values)
+         end
+         local outer, outer_handles = scope_arena, scope_handles
+         scope_arena, scope_handles = arena, handles
+         return scope_exit(arena, handles, outer, outer_handles, pcall(fn, ...))
+      end
+
+      --- Get a copy of a temporary that outlives the current scope. Objects not
+      --- allocated in the current scope are returned as is, except constraints,
+      --- which always get a new handle.
+      ---@generic T
+      ---@param o T
+      ---@return T
+      function kiwi.promote(o)
+         local arena = scope_arena
+         scope_arena = nil
+         o = promote(arena, o)
+         scope_arena = arena
+         return o
+      end
+   end
 end
 
 return kiwi
@@ -7,5 +7,9 @@ set -o errexit -o nounset  # fail on error or on unset variables
 : "${CXX_FLAGS:=-std=c++11}"
 
 "$CXX_COMPILER" ${CXX_FLAGS} -O2 -Wall -pedantic -I.. enaml_like_benchmark.cpp -o run_bench
+"$CXX_COMPILER" ${CXX_FLAGS} -O2 -Wall -pedantic -I.. refcount_benchmark.cpp -o run_refcount_bench
+"$CXX_COMPILER" ${CXX_FLAGS} -O2 -Wall -pedantic -I.. -DKIWI_ATOMIC_REFCOUNT refcount_benchmark.cpp -o run_atomic_refcount_bench
 
 ./run_bench
+./run_refcount_bench
+./run_atomic_refcount_bench
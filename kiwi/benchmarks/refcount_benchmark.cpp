@@ -0,0 +1,61 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2020, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+
+// Time the reference count heavy paths, build with and without
+// KIWI_ATOMIC_REFCOUNT to compare the cost of atomic counts.
+
+#include <kiwi/kiwi.h>
+#include <vector>
+#define ANKERL_NANOBENCH_IMPLEMENT
+#include "nanobench.h"
+
+using namespace kiwi;
+
+int main()
+{
+#ifdef KIWI_ATOMIC_REFCOUNT
+    const char* title = "atomic refcount";
+#else
+    const char* title = "plain refcount";
+#endif
+
+    const int count = 1000;
+    std::vector<Variable> vars;
+    for (int i = 0; i < count; ++i)
+        vars.emplace_back("v");
+
+    ankerl::nanobench::Bench bench;
+    bench.title(title).minEpochIterations(20);
+
+    bench.run("copy variables", [&] {
+        std::vector<Variable> copies(vars);
+        ankerl::nanobench::doNotOptimizeAway(copies);
+    });
+
+    bench.run("build constraints", [&] {
+        std::vector<Constraint> constraints;
+        constraints.reserve(count);
+        for (int i = 1; i < count; ++i)
+            constraints.push_back(vars[i] >= vars[i - 1] + 1);
+        ankerl::nanobench::doNotOptimizeAway(constraints);
+    });
+
+    // Removal pivots are quadratic in the chain length, keep it short.
+    std::vector<Constraint> chain;
+    for (int i = 1; i < 100; ++i)
+        chain.push_back(vars[i] >= vars[i - 1] + 1);
+
+    bench.run("add and remove constraints", [&] {
+        Solver solver;
+        for (const auto& constraint : chain)
+            solver.addConstraint(constraint);
+        for (const auto& constraint : chain)
+            solver.removeConstraint(constraint);
+        ankerl::nanobench::doNotOptimizeAway(solver);
+    });
+}
@@ -6,8 +6,9 @@
 | The full license is in the file LICENSE, distributed with this software.
 |----------------------------------------------------------------------------*/
 #pragma once
+#include <algorithm>
 #include <cstdlib>
-#include <map>
+#include <new>
 #include <vector>
 #include "expression.h"
 #include "shareddata.h"
@@ -29,55 +30,183 @@ enum RelationalOperator
 class Constraint;
 class ConstraintData : public SharedData
 {
-    static Expression reduce(const Expression &expr)
+    // Raw term layout used while reducing; matches Term (and KiwiTerm) so the
+    // reduced terms can be converted in place once duplicates are merged.
+    struct RawTerm
     {
-        std::map<Variable, double> vars;
-        for (const auto & term : expr.terms())
-            vars[term.variable()] += term.coefficient();
+        VariableData *var;
+        double coefficient;
+    };
 
-        std::vector<Term> terms(vars.begin(), vars.end());
-        return Expression(std::move(terms), expr.constant());
+public:
+    // Lightweight view of the reduced terms stored inline after the data.
+    class TermRange
+    {
+    public:
+        TermRange(const Term *first, const Term *last) : m_first(first), m_last(last) {}
+
+        const Term *begin() const { return m_first; }
+        const Term *end() const { return m_last; }
+        std::size_t size() const { return static_cast<std::size_t>(m_last - m_first); }
+        bool empty() const { return m_first == m_last; }
+        const Term &operator[](std::size_t i) const { return m_first[i]; }
+
+    private:
+        const Term *m_first;
+        const Term *m_last;
+    };
+
+    static ConstraintData *alloc(const Expression &expr,
+                                 RelationalOperator op,
+                                 double strength)
+    {
+        const auto &terms = expr.terms();
+        ConstraintData *cn = create(terms.size(), expr.constant(), op, strength);
+        RawTerm *raw = cn->rawTerms();
+        for (const auto &term : terms)
+            raw[cn->m_size++] = RawTerm{const_cast<Variable &>(term.variable()).ptr(), term.coefficient()};
+        cn->reduce();
+        return cn;
     }
 
-public:
-    ConstraintData(const Expression &expr,
-                   RelationalOperator op,
-                   double strength) : SharedData(),
-                                      m_expression(reduce(expr)),
-                                      m_strength(strength::clip(strength)),
-                                      m_op(op) {}
+    /* Build a constraint directly from two raw term arrays as `lhs - rhs`.
 
-    ConstraintData(const ConstraintData &other, double strength) : SharedData(),
-                                                                   m_expression(other.m_expression),
-                                                                   m_strength(strength::clip(strength)),
-                                                                   m_op(other.m_op) {}
+    T is any term type exposing `var` (VariableData*) and `coefficient`
+    members, such as the C API KiwiTerm. Terms with a null variable are
+    skipped. The terms are reduced in place without intermediate containers.
 
-    ~ConstraintData() = default;
+    */
+    template <typename T>
+    static ConstraintData *alloc(const T *lhs, int lhs_count,
+                                 const T *rhs, int rhs_count,
+                                 double constant,
+                                 RelationalOperator op,
+                                 double strength)
+    {
+        lhs_count = lhs ? std::max(lhs_count, 0) : 0;
+        rhs_count = rhs ? std::max(rhs_count, 0) : 0;
+        ConstraintData *cn = create(static_cast<std::size_t>(lhs_count) + static_cast<std::size_t>(rhs_count),
+                                    constant, op, strength);
+        RawTerm *raw = cn->rawTerms();
+        for (int i = 0; i < lhs_count; ++i)
+        {
+            if (lhs[i].var)
+                raw[cn->m_size++] = RawTerm{lhs[i].var, lhs[i].coefficient};
+        }
+        for (int i = 0; i < rhs_count; ++i)
+        {
+            if (rhs[i].var)
+                raw[cn->m_size++] = RawTerm{rhs[i].var, -rhs[i].coefficient};
+        }
+        cn->reduce();
+        return cn;
+    }
+
+    static ConstraintData *alloc(const ConstraintData &other, double strength)
+    {
+        ConstraintData *cn = create(other.m_size, other.m_constant, other.m_op, strength);
+        Term *terms = cn->data();
+        for (const auto &term : other.terms())
+            new (&terms[cn->m_size++]) Term(term);
+        return cn;
+    }
 
-    const Expression &expression() const { return m_expression; }
+    // Storage is a single block holding the object and its trailing terms.
+    static void operator delete(void *p) { ::operator delete(p); }
+
+    ~ConstraintData()
+    {
+        Term *terms = data();
+        for (std::size_t i = 0; i < m_size; ++i)
+            terms[i].~Term();
+    }
+
+    TermRange terms() const { return TermRange(data(), data() + m_size); }
+    double constant() const { return m_constant; }
+    Expression expression() const
+    {
+        return Expression(std::vector<Term>(data(), data() + m_size), m_constant);
+    }
     RelationalOperator op() const { return m_op; }
     double strength() const { return m_strength; }
 
+    // Lookup hint for the tag of the constraint in a solver.
+    mutable impl::SolverSlot m_slot;
+
+    double value() const
+    {
+        double result = m_constant;
+        for (const auto &term : terms())
+            result += term.value();
+        return result;
+    }
+
     bool violated() const
     {
         switch (m_op)
         {
-            case OP_EQ: return !impl::nearZero(m_expression.value());
-            case OP_GE: return m_expression.value() < impl::EPSILON;
-            case OP_LE: return m_expression.value() > impl::EPSILON;
+            case OP_EQ: return !impl::nearZero(value());
+            case OP_GE: return value() < impl::EPSILON;
+            case OP_LE: return value() > impl::EPSILON;
         }
         std::abort();
     }
 
 private:
-    Expression m_expression;
+    std::size_t m_size;
+    double m_constant;
     double m_strength;
     RelationalOperator m_op;
 
+    ConstraintData(double constant, RelationalOperator op, double strength) : SharedData(),
+                                                                              m_size(0),
+                                                                              m_constant(constant),
+                                                                              m_strength(strength::clip(strength)),
+                                                                              m_op(op) {}
+
+    static ConstraintData *create(std::size_t capacity, double constant, RelationalOperator op, double strength)
+    {
+        void *mem = ::operator new(sizeof(ConstraintData) + capacity * sizeof(Term));
+        return new (mem) ConstraintData(constant, op, strength);
+    }
+
+    Term *data() { return reinterpret_cast<Term *>(this + 1); }
+    const Term *data() const { return reinterpret_cast<const Term *>(this + 1); }
+    RawTerm *rawTerms() { return reinterpret_cast<RawTerm *>(this + 1); }
+
+    // Sort the raw terms by variable, merge duplicates and convert them to
+    // Terms in place, retaining each distinct variable once.
+    void reduce()
+    {
+        static_assert(sizeof(RawTerm) == sizeof(Term), "raw terms must match the Term layout");
+        RawTerm *first = rawTerms();
+        RawTerm *last = first + m_size;
+        std::sort(first, last, [](const RawTerm &a, const RawTerm &b) { return a.var < b.var; });
+
+        std::size_t count = 0;
+        for (RawTerm *it = first; it != last; ++it)
+        {
+            if (count > 0 && first[count - 1].var == it->var)
+                first[count - 1].coefficient += it->coefficient;
+            else
+                first[count++] = *it;
+        }
+
+        Term *terms = data();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            const RawTerm raw = first[i];
+            new (&terms[i]) Term(Variable(raw.var), raw.coefficient);
+        }
+        m_size = count;
+    }
+
     ConstraintData(const ConstraintData &other) = delete;
     ConstraintData &operator=(const ConstraintData &other) = delete;
 };
 
+static_assert(sizeof(ConstraintData) % alignof(Term) == 0, "inline terms must be aligned");
+
 class Constraint
 {
 public:
@@ -87,9 +216,9 @@ public:
 
     Constraint(const Expression &expr,
                RelationalOperator op,
-               double strength = strength::required) : m_data(new ConstraintData(expr, op, strength)) {}
+               double strength = strength::required) : m_data(ConstraintData::alloc(expr, op, strength)) {}
 
-    Constraint(const Constraint &other, double strength) : m_data(new ConstraintData(*other.m_data, strength)) {}
+    Constraint(const Constraint &other, double strength) : m_data(ConstraintData::alloc(*other.m_data, strength)) {}
 
     Constraint(const Constraint &) = default;
 
@@ -97,7 +226,12 @@ public:
 
     ~Constraint() = default;
 
-    const Expression &expression() const { return m_data->expression(); }
+    ConstraintData *ptr() { return m_data.data(); }
+    const ConstraintData *ptr() const { return m_data.data(); }
+
+    Expression expression() const { return m_data->expression(); }
+    ConstraintData::TermRange terms() const { return m_data->terms(); }
+    double constant() const { return m_data->constant(); }
     RelationalOperator op() const { return m_data->op(); }
     double strength() const { return m_data->strength(); }
     bool violated() const { return m_data->violated(); }
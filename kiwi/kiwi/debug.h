@@ -76,7 +76,7 @@ public:
         for (const auto &varPair : vars)
         {
             out << varPair.first.name() << " = ";
-            dump(varPair.second, out);
+            dump(varPair.second.symbol, out);
             out << std::endl;
         }
     }
@@ -130,12 +130,12 @@ public:
 
     static void dump(const Constraint &cn, std::ostream &out)
     {
-        for (const auto &term : cn.expression().terms())
+        for (const auto &term : cn.terms())
         {
             out << term.coefficient() << " * ";
             out << term.variable().name() << " + ";
         }
-        out << cn.expression().constant();
+        out << cn.constant();
         switch (cn.op())
         {
         case OP_LE:
@@ -159,4 +159,19 @@ private:
     std::string m_msg;
 };
 
+/* Outcome of a solver operation that reports errors without throwing.
+
+   Each value other than Ok corresponds to the exception of the same name.
+*/
+enum class SolverStatus
+{
+    Ok = 0,
+    UnsatisfiableConstraint,
+    UnknownConstraint,
+    DuplicateConstraint,
+    UnknownEditVariable,
+    DuplicateEditVariable,
+    BadRequiredStrength
+};
+
 } // namespace kiwi
@@ -11,6 +11,7 @@
 #include "errors.h"
 #include "expression.h"
 #include "shareddata.h"
+#include "snapshot.h"
 #include "solver.h"
 #include "strength.h"
 #include "symbolics.h"
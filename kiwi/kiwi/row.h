@@ -6,6 +6,7 @@
 | The full license is in the file LICENSE, distributed with this software.
 |----------------------------------------------------------------------------*/
 #pragma once
+#include <cstdint>
 #include "maptype.h"
 #include "symbol.h"
 #include "util.h"
@@ -24,7 +25,7 @@ public:
 
     Row() : Row(0.0) {}
 
-    Row(double constant) : m_constant(constant) {}
+    Row(double constant) : m_constant(constant), m_frame_constant(constant), m_frame_generation(0) {}
 
     Row(const Row &other) = default;
 
@@ -172,9 +173,35 @@ public:
         }
     }
 
+    /* Save the constant before its first change in a lazy generation.
+
+	Lazy variable values resolve against the constants the rows had
+	when the generation began, so the solver calls this before it
+	changes the constant of a row in the tableau.
+
+	*/
+    void saveFrame(std::uint32_t generation)
+    {
+        if (m_frame_generation != generation)
+        {
+            m_frame_generation = generation;
+            m_frame_constant = m_constant;
+        }
+    }
+
+    /* Get the constant the row had when the given generation began.
+
+	*/
+    double frameConstant(std::uint32_t generation) const
+    {
+        return m_frame_generation == generation ? m_frame_constant : m_constant;
+    }
+
 private:
     CellMap m_cells;
     double m_constant;
+    double m_frame_constant;
+    std::uint32_t m_frame_generation;
 };
 
 } // namespace impl
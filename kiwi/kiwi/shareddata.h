@@ -6,6 +6,9 @@
 | The full license is in the file LICENSE, distributed with this software.
 |----------------------------------------------------------------------------*/
 #pragma once
+#ifdef KIWI_ATOMIC_REFCOUNT
+#include <atomic>
+#endif
 
 /*
 Implementation note
@@ -15,11 +18,67 @@ but do not use atomic counters under the hood.
 Since kiwi operates within a single thread context, atomic counters are not necessary,
 especially given the extra CPU cost.
 Therefore the use of SharedDataPtr/SharedData is preferred over std::shared_ptr.
+
+Defining KIWI_ATOMIC_REFCOUNT makes the reference counts of constraints and
+variables atomic, so they can be created on one thread and handed to a solver,
+or shared between solvers, on another. A solver itself is still not thread safe.
 */
 
 namespace kiwi
 {
 
+namespace impl
+{
+
+#ifdef KIWI_ATOMIC_REFCOUNT
+
+/* An atomic reference count with the interface of a plain integer.
+
+Increments are relaxed. A decrement releases and the final one acquires,
+so the object is complete when it is destroyed on another thread.
+
+*/
+template <typename T>
+class RefCount
+{
+public:
+    RefCount(T count = 0) : m_count(count) {}
+
+    // Only used to initialize aggregates holding a count.
+    RefCount(const RefCount &other) : m_count(static_cast<T>(other)) {}
+
+    RefCount &operator=(T count)
+    {
+        m_count.store(count, std::memory_order_relaxed);
+        return *this;
+    }
+
+    operator T() const { return m_count.load(std::memory_order_relaxed); }
+
+    T operator++() { return m_count.fetch_add(1, std::memory_order_relaxed) + 1; }
+    T operator++(int) { return m_count.fetch_add(1, std::memory_order_relaxed); }
+
+    T operator--()
+    {
+        T count = m_count.fetch_sub(1, std::memory_order_release) - 1;
+        if (count == 0)
+            std::atomic_thread_fence(std::memory_order_acquire);
+        return count;
+    }
+
+private:
+    std::atomic<T> m_count;
+};
+
+#else
+
+template <typename T>
+using RefCount = T;
+
+#endif
+
+} // namespace impl
+
 class SharedData
 {
 
@@ -30,7 +89,7 @@ public:
 
     SharedData(SharedData&& other) = delete;
 
-    int m_refcount;
+    impl::RefCount<int> m_refcount;
 
     SharedData &operator=(const SharedData &other) = delete;
     
@@ -0,0 +1,114 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2013-2017, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <thread>
+
+namespace kiwi
+{
+
+// A frame of variable values published by a single writer and read by any
+// number of threads without locks.
+//
+// The frame is guarded by a sequence counter which is odd while a frame is
+// being written. Readers copy the values and retry when the counter was odd
+// or moved during the copy, so they never see a partially written frame.
+// Values are stored as relaxed atomics to keep the racing copy well defined.
+class ValueSnapshot
+{
+
+public:
+    explicit ValueSnapshot(std::size_t size) : m_values(new std::atomic<std::uint64_t>[size]), m_size(size)
+    {
+        const std::uint64_t nan = toBits(std::numeric_limits<double>::quiet_NaN());
+        for (std::size_t i = 0; i < size; ++i)
+            m_values[i].store(nan, std::memory_order_relaxed);
+        m_seq.store(0, std::memory_order_release);
+    }
+
+    ValueSnapshot(const ValueSnapshot &) = delete;
+
+    ValueSnapshot &operator=(const ValueSnapshot &) = delete;
+
+    std::size_t size() const
+    {
+        return m_size;
+    }
+
+    // The number of frames published so far.
+    std::uint64_t version() const
+    {
+        return m_seq.load(std::memory_order_acquire) / 2;
+    }
+
+    // Start writing a frame. Only one thread may write.
+    void beginWrite()
+    {
+        m_seq.store(m_seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void store(std::size_t index, double value)
+    {
+        m_values[index].store(toBits(value), std::memory_order_relaxed);
+    }
+
+    // Publish the frame written since beginWrite().
+    void endWrite()
+    {
+        m_seq.store(m_seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Copy `count` values starting at `first` from the latest complete
+    // frame into `out` and return the version of that frame.
+    std::uint64_t read(std::size_t first, std::size_t count, double *out) const
+    {
+        for (unsigned attempt = 0;; ++attempt)
+        {
+            const std::uint64_t seq = m_seq.load(std::memory_order_acquire);
+            if ((seq & 1) == 0)
+            {
+                for (std::size_t i = 0; i < count; ++i)
+                    out[i] = fromBits(m_values[first + i].load(std::memory_order_relaxed));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_seq.load(std::memory_order_relaxed) == seq)
+                    return seq / 2;
+            }
+            if (attempt >= 16)
+                std::this_thread::yield();
+        }
+    }
+
+private:
+    static std::uint64_t toBits(double value)
+    {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    static double fromBits(std::uint64_t bits)
+    {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    static_assert(sizeof(double) == sizeof(std::uint64_t), "values are stored as 64 bit words");
+
+    std::atomic<std::uint64_t> m_seq{0};
+    std::unique_ptr<std::atomic<std::uint64_t>[]> m_values;
+    std::size_t m_size;
+};
+
+} // namespace kiwi
@@ -62,6 +62,130 @@ public:
 		return m_impl.hasConstraint( constraint );
 	}
 
+	/* Enable or disable a constraint without removing it from the solver.
+
+	A disabled soft constraint keeps its place in the tableau and is
+	re-enabled by reoptimizing. A disabled required constraint is taken
+	out of the tableau until it is enabled again.
+
+	Throws
+	------
+	UnknownConstraint
+		The given constraint has not been added to the solver.
+
+	UnsatisfiableConstraint
+		The given constraint is required and cannot be satisfied
+		when it is enabled again. It remains disabled.
+
+	*/
+	void setConstraintEnabled( const Constraint& constraint, bool enabled )
+	{
+		m_impl.setConstraintEnabled( constraint, enabled );
+	}
+
+	/* Test whether a constraint in the solver is enabled.
+
+	*/
+	bool constraintEnabled( const Constraint& constraint ) const
+	{
+		return m_impl.constraintEnabled( constraint );
+	}
+
+	/* Change the strength of a non-required constraint in the solver.
+
+	The objective is adjusted in place and reoptimized. The constraint
+	object keeps the strength it was created with; use
+	constraintStrength() to read the strength used by the solver.
+
+	Throws
+	------
+	UnknownConstraint
+		The given constraint has not been added to the solver.
+
+	BadRequiredStrength
+		The constraint is required or the given strength is >= required.
+
+	*/
+	void setStrength( const Constraint& constraint, double strength )
+	{
+		m_impl.setStrength( constraint, strength );
+	}
+
+	/* Get the strength a constraint has in the solver.
+
+	Returns a negative value if the constraint has not been added.
+
+	*/
+	double constraintStrength( const Constraint& constraint ) const
+	{
+		return m_impl.constraintStrength( constraint );
+	}
+
+	/* Change the constant of a constraint in the solver.
+
+	The constant is that of the constraint expression, so for `x == 10`
+	it is -10. The change is applied to the tableau in place, like a
+	suggested value, instead of removing and adding the constraint. Use
+	constraintConstant() to read the constant used by the solver.
+
+	Throws
+	------
+	UnknownConstraint
+		The given constraint has not been added to the solver.
+
+	UnsatisfiableConstraint
+		The new constant conflicts with the required constraints. The
+		previous constant is kept.
+
+	*/
+	void setConstant( const Constraint& constraint, double constant )
+	{
+		m_impl.setConstant( constraint, constant );
+	}
+
+	/* Get the constant a constraint has in the solver.
+
+	Returns 0.0 if the constraint has not been added.
+
+	*/
+	double constraintConstant( const Constraint& constraint ) const
+	{
+		return m_impl.constraintConstant( constraint );
+	}
+
+	/* Change the coefficient of a variable in a constraint in the solver.
+
+	A coefficient of zero removes the variable from the constraint. The
+	tableau is updated in place and reoptimized instead of removing and
+	adding the constraint. Use constraintCoefficient() to read the
+	coefficient used by the solver.
+
+	Throws
+	------
+	UnknownConstraint
+		The given constraint has not been added to the solver.
+
+	UnsatisfiableConstraint
+		The new coefficient conflicts with the required constraints.
+		The previous coefficient is kept.
+
+	*/
+	void setCoefficient( const Constraint& constraint, const Variable& variable, double coefficient )
+	{
+		m_impl.setCoefficient( constraint, variable, coefficient );
+	}
+
+	/* Get the coefficient of a variable in a constraint in the solver.
+
+	Returns 0.0 if the variable is not part of the constraint or the
+	constraint has not been added.
+
+	*/
+	double constraintCoefficient( const Constraint& constraint, const Variable& variable ) const
+	{
+		return m_impl.constraintCoefficient( constraint, variable );
+	}
+
 	/* Add an edit variable to the solver.
 
 	This method should be called before the `suggestValue` method is
@@ -102,6 +226,22 @@ public:
 		return m_impl.hasEditVariable( variable );
 	}
 
+	/* Change the strength of an edit variable in the solver.
+
+	Throws
+	------
+	UnknownEditVariable
+		The given edit variable has not been added to the solver.
+
+	BadRequiredStrength
+		The given strength is >= required.
+
+	*/
+	void setEditStrength( const Variable& variable, double strength )
+	{
+		m_impl.setEditStrength( variable, strength );
+	}
+
 	/* Suggest a value for the given edit variable.
 
 	This method should be used after an edit variable as been added to
@@ -120,6 +260,86 @@ public:
 		m_impl.suggestValue( variable, value );
 	}
 
+	/* Non-throwing variants of the methods above.
+
+	The expected failures documented for each method are returned as a
+	SolverStatus instead of being thrown. InternalSolverError and
+	allocation failures are still thrown.
+
+	*/
+	SolverStatus tryAddConstraint( const Constraint& constraint )
+	{
+		return m_impl.tryAddConstraint( constraint );
+	}
+
+	/* Add `count` constraints, optimizing once for the whole batch.
+	`cnAt( i )` returns the i-th constraint. The first failure stops
+	the batch and `added` receives the number of constraints added
+	before it.
+
+	*/
+	template<typename CnAt>
+	SolverStatus tryAddConstraints( std::size_t count, CnAt&& cnAt, std::size_t& added )
+	{
+		return m_impl.tryAddConstraints( count, std::forward<CnAt>( cnAt ), added );
+	}
+
+	SolverStatus tryRemoveConstraint( const Constraint& constraint )
+	{
+		return m_impl.tryRemoveConstraint( constraint );
+	}
+
+	SolverStatus trySetConstraintEnabled( const Constraint& constraint, bool enabled )
+	{
+		return m_impl.trySetConstraintEnabled( constraint, enabled );
+	}
+
+	SolverStatus trySetStrength( const Constraint& constraint, double strength )
+	{
+		return m_impl.trySetStrength( constraint, strength );
+	}
+
+	SolverStatus trySetConstant( const Constraint& constraint, double constant )
+	{
+		return m_impl.trySetConstant( constraint, constant );
+	}
+
+	SolverStatus trySetCoefficient( const Constraint& constraint, const Variable& variable, double coefficient )
+	{
+		return m_impl.trySetCoefficient( constraint, variable, coefficient );
+	}
+
+	/* Change the constants of `count` constraints with a single dual
+	optimization. `cnAt( i )` returns the i-th constraint. Either all
+	constants are changed or none are.
+
+	*/
+	template<typename CnAt>
+	SolverStatus trySetConstants( std::size_t count, CnAt&& cnAt, const double* constants )
+	{
+		return m_impl.trySetConstants( count, std::forward<CnAt>( cnAt ), constants );
+	}
+
+	SolverStatus tryAddEditVariable( const Variable& variable, double strength )
+	{
+		return m_impl.tryAddEditVariable( variable, strength );
+	}
+
+	SolverStatus trySetEditStrength( const Variable& variable, double strength )
+	{
+		return m_impl.trySetEditStrength( variable, strength );
+	}
+
+	SolverStatus tryRemoveEditVariable( const Variable& variable )
+	{
+		return m_impl.tryRemoveEditVariable( variable );
+	}
+
+	SolverStatus trySuggestValue( const Variable& variable, double value )
+	{
+		return m_impl.trySuggestValue( variable, value );
+	}
+
 	/* Update the values of the external solver variables.
 
 	*/
@@ -128,6 +348,238 @@ public:
 		m_impl.updateVariables();
 	}
 
+	/* Update the values of the external solver variables and report changes.
+
+	`changed( variable )` is called for every variable whose value moved by
+	more than `tolerance` since it was last written. Smaller moves are not
+	written, so the stored value is always the last reported one.
+
+	*/
+	template<typename F>
+	void updateVariables( double tolerance, F&& changed )
+	{
+		m_impl.updateVariables( tolerance, std::forward<F>( changed ) );
+	}
+
+	/* Get the number of variables known to the solver.
+
+	*/
+	std::size_t variableCount() const
+	{
+		return m_impl.variableCount();
+	}
+
+	/* Read the current solution for a set of variables.
+
+	The value of `variables[ i ]` is written to `values[ i ]`. Unlike
+	updateVariables(), the variables themselves are not modified.
+	Variables unknown to the solver report their current value.
+
+	*/
+	void getValues( const Variable* variables, std::size_t count, double* values ) const
+	{
+		m_impl.getValues( count, [variables]( std::size_t i ) { return variables[ i ].ptr(); }, values );
+	}
+
+	/* Read the current solution for variables given by an accessor.
+
+	`varAt( i )` must return the `const VariableData*` for the i-th value.
+
+	*/
+	template<typename VarAt>
+	void getValues( std::size_t count, VarAt&& varAt, double* values ) const
+	{
+		m_impl.getValues( count, std::forward<VarAt>( varAt ), values );
+	}
+
+	/* Bind an external buffer which receives the values of slotted variables.
+
+	After binding, updateVariables() writes the value of every variable
+	with a slot below `size` to `values[slot]` instead of the variable
+	itself. Passing a null buffer unbinds it. The buffer must remain
+	valid until it is unbound or the solver is reset or destroyed.
+
+	*/
+	void bindValues( double* values, std::size_t size )
+	{
+		m_impl.bindValues( values, size );
+	}
+
+	/* Bind a snapshot which receives the values of slotted variables.
+
+	After binding, updateVariables() also publishes the value of every
+	variable with a slot below the size of the snapshot as one frame.
+	Other threads can read consistent frames from the snapshot without
+	locking while this thread keeps updating. Passing null unbinds it.
+	The snapshot must remain valid until it is unbound or the solver is
+	reset or destroyed.
+
+	*/
+	void bindSnapshot( ValueSnapshot* snapshot )
+	{
+		m_impl.bindSnapshot( snapshot );
+	}
+
+	/* Assign a dense slot index in the bound value buffer to a variable.
+
+	The variable does not need to be part of any constraint yet.
+
+	*/
+	void setVariableSlot( const Variable& variable, std::size_t slot )
+	{
+		m_impl.setVariableSlot( variable, slot );
+	}
+
+	/* Remove the value buffer slot assigned to a variable.
+
+	*/
+	void clearVariableSlot( const Variable& variable )
+	{
+		m_impl.setVariableSlot( variable, impl::SolverImpl::NoSlot );
+	}
+
+	/* Enable or disable lazy variable updates.
+
+	When enabled, updateVariables() runs in constant time, apart from
+	writing a bound value buffer or snapshot, and each variable computes
+	its value from the solver when it is next read. Changes to the
+	tableau save the values they replace so reads still see the last
+	update.
+
+	*/
+	void setLazyUpdates( bool enabled )
+	{
+		m_impl.setLazyUpdates( enabled );
+	}
+
+	/* Test whether lazy variable updates are enabled.
+
+	*/
+	bool lazyUpdates() const
+	{
+		return m_impl.lazyUpdates();
+	}
+
+	/* Enable or disable sharing of rows between equivalent constraints.
+
+	When enabled, a constraint with the same terms, operator, strength
+	and constant as one in the solver shares its row, and a required
+	inequality implied by a tighter one with the same terms gets no row
+	at all. The shared row stays until its last constraint is removed.
+
+	*/
+	void setDeduplication( bool enabled )
+	{
+		m_impl.setDeduplication( enabled );
+	}
+
+	/* Test whether constraint deduplication is enabled.
+
+	*/
+	bool deduplication() const
+	{
+		return m_impl.deduplication();
+	}
+
+	/* Enable or disable presolving of trivial required constraints.
+
+	When enabled, a required `x == c` or `x == y + c` whose variable x
+	is new to the solver fixes x or makes it an alias of y instead of
+	adding a row. A required `x >= c` or `x <= c` on a new variable
+	becomes a bound on x. Removing the constraint splits the alias again.
+	Presolve only applies to variables the solver does not know yet, so
+	the same constraints on a variable already in the tableau get a row
+	as usual.
+
+	*/
+	void setPresolve( bool enabled )
+	{
+		m_impl.setPresolve( enabled );
+	}
+
+	/* Test whether presolving is enabled.
+
+	*/
+	bool presolve() const
+	{
+		return m_impl.presolve();
+	}
+
+	/* Split pivots on large tableaux across a pool of threads.
+
+	Once the tableau holds at least `min_rows` rows, the row updates and
+	leaving row searches of each pivot run on `threads` threads, the
+	calling thread included. Results are the same as with one thread.
+	A thread count below two disables the mode.
+
+	*/
+	void setParallel( std::size_t threads,
+		std::size_t min_rows = impl::SolverImpl::DefaultParallelRows )
+	{
+		m_impl.setParallel( threads, min_rows );
+	}
+
+	/* The number of threads used for pivots on large tableaux.
+
+	*/
+	std::size_t parallelThreads() const
+	{
+		return m_impl.parallelThreads();
+	}
+
+	/* Enable or disable deferred optimization.
+
+	While enabled, updates leave their reoptimization pending and
+	optimizeFor() carries it out in budgeted steps, so a large change
+	can be spread over several frames. Between steps after structural
+	updates the values are feasible but not yet optimal. After suggested
+	values updateVariables() keeps the values of the last update until
+	the steps are done. Disabling finishes any pending optimization.
+
+	*/
+	void setDeferredOptimize( bool enabled )
+	{
+		m_impl.setDeferredOptimize( enabled );
+	}
+
+	/* Test whether deferred optimization is enabled.
+
+	*/
+	bool deferredOptimize() const
+	{
+		return m_impl.deferredOptimize();
+	}
+
+	/* Test whether no deferred optimization is pending.
+
+	*/
+	bool optimized() const
+	{
+		return m_impl.optimized();
+	}
+
+	/* Make at most `maxPivots` pivots of pending optimization.
+
+	Returns true once the solver is optimal and feasible.
+
+	*/
+	bool optimizeFor( std::size_t maxPivots )
+	{
+		return m_impl.optimizeFor( maxPivots );
+	}
+
+	/* Make pivots of pending optimization until the deadline passes or
+	`maxPivots` pivots were made.
+
+	Returns true once the solver is optimal and feasible.
+
+	*/
+	bool optimizeFor( std::chrono::steady_clock::time_point deadline,
+		std::size_t maxPivots = std::numeric_limits<std::size_t>::max() )
+	{
+		return m_impl.optimizeFor( deadline, maxPivots );
+	}
+
 	/* Reset the solver to the empty starting condition.
 
 	This method resets the internal solver state to the empty starting
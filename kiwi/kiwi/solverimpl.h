@@ -7,16 +7,22 @@
 |----------------------------------------------------------------------------*/
 #pragma once
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
 #include <limits>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 #include "constraint.h"
 #include "errors.h"
 #include "expression.h"
 #include "maptype.h"
 #include "row.h"
+#include "snapshot.h"
 #include "symbol.h"
 #include "term.h"
+#include "threadpool.h"
 #include "util.h"
 #include "variable.h"
 
@@ -35,6 +41,9 @@ class SolverImpl
 	{
 		Symbol marker;
 		Symbol other;
+		double strength = 0.0;
+		double constant = 0.0;
+		bool disabled = false;
 	};
 
 	struct EditInfo
@@ -44,30 +53,108 @@ class SolverImpl
 		double constant;
 	};
 
-	using VarMap = MapType<Variable, Symbol>;
+	struct VarInfo
+	{
+		VarInfo() : slot( NoSlot ), scale( 1.0 ), offset( 0.0 ) {}
+		VarInfo( Symbol sym ) : symbol( sym ), slot( NoSlot ), scale( 1.0 ), offset( 0.0 ) {}
+
+		// A presolved variable takes the symbol of the variable it is an
+		// alias of, the slack of its bound, or no symbol if it is fixed.
+		// Its value is `scale * symbol + offset`.
+		Symbol symbol;
+		std::size_t slot;
+		double scale;
+		double offset;
+	};
+
+	using VarMap = MapType<Variable, VarInfo>;
+
+	// A root is its own parent and is fixed or bounded at `offset`.
+	struct Alias
+	{
+		Variable parent;
+		double offset;
+		bool root;
+	};
+
+	using AliasMap = MapType<Variable, Alias>;
+
+	using PresolveMap = MapType<Constraint, Variable>;
+
+	struct LazySource : LazyValueSource
+	{
+		LazySource( const SolverImpl* owner ) : solver( owner )
+		{
+			generation = 0;
+			resolve = &LazySource::resolveValue;
+		}
+
+		static double resolveValue( const LazyValueSource* source, const VariableData* var )
+		{
+			return static_cast<const LazySource*>( source )->solver->frameValueOf( var );
+		}
+
+		const SolverImpl* solver;
+	};
 
 	using RowMap = MapType<Symbol, Row*>;
 
 	using CnMap = MapType<Constraint, Tag>;
 
+	using CnTermMap = MapType<Constraint, std::vector<Term>>;
+
+	using CnShareMap = MapType<Constraint, Constraint>;
+
+	using CnMemberMap = MapType<Constraint, std::vector<Constraint>>;
+
+	using CnHashMap = MapType<Constraint, std::size_t>;
+
+	using CnIndex = std::unordered_map<std::size_t, std::vector<Constraint>>;
+
 	using EditMap = MapType<Variable, EditInfo>;
 
+	// Positions of objects whose slot is claimed by another solver.
+	using SlotHintMap = std::unordered_map<const SolverSlot*, std::size_t>;
+
 	struct DualOptimizeGuard
 	{
 		DualOptimizeGuard( SolverImpl& impl ) : m_impl( impl ) {}
-		~DualOptimizeGuard() { m_impl.dualOptimize(); }
+		~DualOptimizeGuard() { m_impl.dualReoptimize(); }
+		SolverImpl& m_impl;
+	};
+
+	struct DeferredGuard
+	{
+		DeferredGuard( SolverImpl& impl ) : m_impl( impl ), m_deferred( impl.m_deferred_enabled )
+		{
+			m_impl.m_deferred_enabled = true;
+		}
+		~DeferredGuard() { m_impl.m_deferred_enabled = m_deferred; }
 		SolverImpl& m_impl;
+		bool m_deferred;
 	};
 
 public:
 
-	SolverImpl() : m_objective( new Row() ), m_id_tick( 1 ) {}
+	static constexpr std::size_t NoSlot = std::numeric_limits<std::size_t>::max();
+
+	static constexpr std::size_t DefaultParallelRows = 16384;
+
+	SolverImpl() : m_objective( new Row() ), m_id_tick( 1 ), m_values( nullptr ), m_values_size( 0 ), m_snapshot( nullptr ),
+		m_lazy( this ), m_lazy_enabled( false ), m_dedup_enabled( false ), m_presolve_enabled( false ),
+		m_parallel_rows( DefaultParallelRows ), m_deferred_enabled( false ), m_pending_primal( false ),
+		m_pending_dual( false ), m_dual_degenerate( 0 ), m_toggled( false ) {}
 
 	SolverImpl( const SolverImpl& ) = delete;
 
 	SolverImpl( SolverImpl&& ) = delete;
 
-	~SolverImpl() { clearRows(); }
+	~SolverImpl()
+	{
+		unbindLazy();
+		releaseSlots();
+		clearRows();
+	}
 
 	/* Add a constraint to the solver.
 
@@ -82,54 +169,54 @@ public:
 	*/
 	void addConstraint( const Constraint& constraint )
 	{
-		if( m_cns.find( constraint ) != m_cns.end() )
-			throw DuplicateConstraint( constraint );
+		raise( tryAddConstraint( constraint ), constraint );
+	}
 
-		// Creating a row causes symbols to be reserved for the variables
-		// in the constraint. If this method exits with an exception,
-		// then its possible those variables will linger in the var map.
-		// Since its likely that those variables will be used in other
-		// constraints and since exceptional conditions are uncommon,
-		// i'm not too worried about aggressive cleanup of the var map.
-		Tag tag;
-		std::unique_ptr<Row> rowptr( createRow( constraint, tag ) );
-		Symbol subject( chooseSubject( *rowptr, tag ) );
+	/* Add a constraint to the solver, reporting expected failures.
 
-		// If chooseSubject could not find a valid entering symbol, one
-		// last option is available if the entire row is composed of
-		// dummy variables. If the constant of the row is zero, then
-		// this represents redundant constraints and the new dummy
-		// marker can enter the basis. If the constant is non-zero,
-		// then it represents an unsatisfiable constraint.
-		if( subject.type() == Symbol::Invalid && allDummies( *rowptr ) )
-		{
-			if( !nearZero( rowptr->constant() ) )
-				throw UnsatisfiableConstraint( constraint );
-			else
-				subject = tag.marker;
-		}
+	Returns SolverStatus::DuplicateConstraint or
+	SolverStatus::UnsatisfiableConstraint instead of throwing. Only
+	InternalSolverError and allocation failures are thrown.
 
-		// If an entering symbol still isn't found, then the row must
-		// be added using an artificial variable. If that fails, then
-		// the row represents an unsatisfiable constraint.
-		if( subject.type() == Symbol::Invalid )
-		{
-			if( !addWithArtificialVariable( *rowptr ) )
-				throw UnsatisfiableConstraint( constraint );
-		}
-		else
-		{
-			rowptr->solveFor( subject );
-			substitute( subject, *rowptr );
-			m_rows[ subject ] = rowptr.release();
-		}
+	*/
+	SolverStatus tryAddConstraint( const Constraint& constraint )
+	{
+		finishDual();
+		if( hasConstraint( constraint ) )
+			return SolverStatus::DuplicateConstraint;
+		if( m_dedup_enabled )
+			return shareConstraint( constraint );
+		return addUnshared( constraint );
+	}
 
-		m_cns[ constraint ] = tag;
+	/* Add several constraints to the solver, reporting expected failures.
 
-		// Optimizing after each constraint is added performs less
-		// aggregate work due to a smaller average system size. It
-		// also ensures the solver remains in a consistent state.
-		optimize( *m_objective );
+	`cnAt( i )` returns the i-th constraint. The constraints are added
+	in order as by tryAddConstraint() and the first failure stops the
+	batch: the constraints before it stay in the solver and the rest
+	are not added. `added` receives the number that were added.
+
+	Each row which needs an artificial variable still gets its own
+	phase 1, but the objective is optimized once for the whole batch
+	instead of after every constraint.
+
+	*/
+	template<typename CnAt>
+	SolverStatus tryAddConstraints( std::size_t count, CnAt&& cnAt, std::size_t& added )
+	{
+		SolverStatus status = SolverStatus::Ok;
+		{
+			DeferredGuard guard( *this );
+			for( added = 0; added < count; ++added )
+			{
+				status = tryAddConstraint( cnAt( added ) );
+				if( status != SolverStatus::Ok )
+					break;
+			}
+		}
+		if( !m_deferred_enabled )
+			finishPrimal();
+		return status;
 	}
 
 	/* Remove a constraint from the solver.
@@ -142,42 +229,56 @@ public:
 	*/
 	void removeConstraint( const Constraint& constraint )
 	{
-		auto cn_it = m_cns.find( constraint );
-		if( cn_it == m_cns.end() )
-			throw UnknownConstraint( constraint );
+		raise( tryRemoveConstraint( constraint ), constraint );
+	}
 
-		Tag tag( cn_it->second );
-		m_cns.erase( cn_it );
+	/* Remove a constraint from the solver, reporting expected failures.
 
-		// Remove the error effects from the objective function
-		// *before* pivoting, or substitutions into the objective
-		// will lead to incorrect solver results.
-		removeConstraintEffects( constraint, tag );
+	Returns SolverStatus::UnknownConstraint instead of throwing.
 
-		// If the marker is basic, simply drop the row. Otherwise,
-		// pivot the marker into the basis and then drop the row.
-		auto row_it = m_rows.find( tag.marker );
-		if( row_it != m_rows.end() )
+	*/
+	SolverStatus tryRemoveConstraint( const Constraint& constraint )
+	{
+		finishDual();
+		if( unpresolve( constraint ) )
+			return SolverStatus::Ok;
+
+		auto sh_it = m_shared.find( constraint );
+		if( sh_it != m_shared.end() )
 		{
-			std::unique_ptr<Row> rowptr( row_it->second );
-			m_rows.erase( row_it );
+			leaveShared( sh_it );
+			return SolverStatus::Ok;
 		}
-		else
+
+		if( unindexConstraint( constraint ) )
 		{
-			row_it = getMarkerLeavingRow( tag.marker );
-			if( row_it == m_rows.end() )
-				throw InternalSolverError( "failed to find leaving row" );
-			Symbol leaving( row_it->first );
-			std::unique_ptr<Row> rowptr( row_it->second );
-			m_rows.erase( row_it );
-			rowptr->solveFor( leaving, tag.marker );
-			substitute( tag.marker, *rowptr );
+			// A duplicate can keep the row as it is. Otherwise the
+			// members get a row of their own before this one is gone.
+			if( handOverRow( constraint ) )
+				return SolverStatus::Ok;
+			rehomeMembers( constraint );
 		}
 
+		auto cn_it = findCn( constraint );
+		if( cn_it == m_cns.end() )
+			return SolverStatus::UnknownConstraint;
+
+		Tag tag( cn_it->second );
+		releaseSlot( constraint.ptr()->m_slot, m_cn_hints );
+		m_cns.erase( cn_it );
+		m_cn_terms.erase( constraint );
+
+		// A disabled required constraint has no row in the tableau.
+		if( tag.disabled && constraint.strength() >= strength::required )
+			return SolverStatus::Ok;
+
+		dropConstraint( tag );
+
 		// Optimizing after each constraint is removed ensures that the
 		// solver remains consistent. It makes the solver api easier to
 		// use at a small tradeoff for speed.
-		optimize( *m_objective );
+		reoptimize();
+		return SolverStatus::Ok;
 	}
 
 	/* Test whether a constraint has been added to the solver.
@@ -185,616 +286,3130 @@ public:
 	*/
 	bool hasConstraint( const Constraint& constraint ) const
 	{
-		return m_cns.find( constraint ) != m_cns.end();
+		return findCn( constraint ) != m_cns.end() || isRowless( constraint );
 	}
 
-	/* Add an edit variable to the solver.
-
-	This method should be called before the `suggestValue` method is
-	used to supply a suggested value for the given edit variable.
+	/* Enable or disable a constraint without removing it from the solver.
 
 	Throws
 	------
-	DuplicateEditVariable
-		The given edit variable has already been added to the solver.
+	UnknownConstraint
+		The given constraint has not been added to the solver.
 
-	BadRequiredStrength
-		The given strength is >= required.
+	UnsatisfiableConstraint
+		The given constraint is required and cannot be satisfied
+		when it is enabled again.
 
 	*/
-	void addEditVariable( const Variable& variable, double strength )
+	void setConstraintEnabled( const Constraint& constraint, bool enabled )
 	{
-		if( m_edits.find( variable ) != m_edits.end() )
-			throw DuplicateEditVariable( variable );
-		strength = strength::clip( strength );
-		if( strength == strength::required )
-			throw BadRequiredStrength();
-		Constraint cn( Expression( variable ), OP_EQ, strength );
-		addConstraint( cn );
-		EditInfo info;
-		info.tag = m_cns[ cn ];
-		info.constraint = cn;
-		info.constant = 0.0;
-		m_edits[ variable ] = info;
+		raise( trySetConstraintEnabled( constraint, enabled ), constraint );
 	}
 
-	/* Remove an edit variable from the solver.
+	/* Enable or disable a constraint, reporting expected failures.
 
-	Throws
-	------
-	UnknownEditVariable
-		The given edit variable has not been added to the solver.
+	A soft constraint keeps its row in the tableau. Disabling it removes
+	the weight of its error variables from the objective, and enabling
+	it adds the weight back, so either way only a primal reoptimization
+	is needed. A required constraint has no error variables to relax, so
+	its row is dropped while disabled and inserted again when enabled.
+	If that fails the constraint stays disabled and
+	SolverStatus::UnsatisfiableConstraint is returned.
 
 	*/
-	void removeEditVariable( const Variable& variable )
+	SolverStatus trySetConstraintEnabled( const Constraint& constraint, bool enabled )
 	{
-		auto it = m_edits.find( variable );
-		if( it == m_edits.end() )
-			throw UnknownEditVariable( variable );
-		removeConstraint( it->second.constraint );
-		m_edits.erase( it );
+		finishDual();
+		SolverStatus status = unshare( constraint );
+		if( status != SolverStatus::Ok )
+			return status;
+
+		auto cn_it = findCn( constraint );
+		if( cn_it == m_cns.end() )
+			return SolverStatus::UnknownConstraint;
+
+		Tag& tag = cn_it->second;
+		if( tag.disabled != enabled )
+			return SolverStatus::Ok;
+		if( !enabled )
+			m_toggled = true;
+
+		if( constraint.strength() >= strength::required )
+		{
+			if( enabled )
+			{
+				Tag inserted;
+				status = insertConstraint( constraint, inserted, tag.constant );
+				if( status != SolverStatus::Ok )
+					return status;
+				tag = inserted;
+				return SolverStatus::Ok;
+			}
+			dropConstraintRow( tag );
+		}
+		else if( enabled )
+		{
+			shiftConstraintEffects( tag, tag.strength );
+		}
+		else
+		{
+			shiftConstraintEffects( tag, -tag.strength );
+			clearMarkerResidue( tag, tag.strength );
+		}
+
+		tag.disabled = !enabled;
+		reoptimize();
+		return SolverStatus::Ok;
 	}
 
-	/* Test whether an edit variable has been added to the solver.
+	/* Test whether a constraint in the solver is enabled.
+
+	Constraints not added to the solver are reported as disabled.
 
 	*/
-	bool hasEditVariable( const Variable& variable ) const
+	bool constraintEnabled( const Constraint& constraint ) const
 	{
-		return m_edits.find( variable ) != m_edits.end();
+		if( isRowless( constraint ) )
+			return true;
+		auto cn_it = findCn( constraint );
+		return cn_it != m_cns.end() && !cn_it->second.disabled;
 	}
 
-	/* Suggest a value for the given edit variable.
-
-	This method should be used after an edit variable as been added to
-	the solver in order to suggest the value for that variable.
+	/* Change the strength of a non-required constraint in the solver.
 
 	Throws
 	------
-	UnknownEditVariable
-		The given edit variable has not been added to the solver.
+	UnknownConstraint
+		The given constraint has not been added to the solver.
+
+	BadRequiredStrength
+		The constraint is required or the given strength is >= required.
 
 	*/
-	void suggestValue( const Variable& variable, double value )
+	void setStrength( const Constraint& constraint, double strength )
 	{
-		auto it = m_edits.find( variable );
-		if( it == m_edits.end() )
-			throw UnknownEditVariable( variable );
-
-		DualOptimizeGuard guard( *this );
-		EditInfo& info = it->second;
-		double delta = value - info.constant;
-		info.constant = value;
-
-		// Check first if the positive error variable is basic.
-		auto row_it = m_rows.find( info.tag.marker );
-		if( row_it != m_rows.end() )
-		{
-			if( row_it->second->add( -delta ) < 0.0 )
-				m_infeasible_rows.push_back( row_it->first );
-			return;
-		}
-
-		// Check next if the negative error variable is basic.
-		row_it = m_rows.find( info.tag.other );
-		if( row_it != m_rows.end() )
-		{
-			if( row_it->second->add( delta ) < 0.0 )
-				m_infeasible_rows.push_back( row_it->first );
-			return;
-		}
-
-		// Otherwise update each row where the error variables exist.
-		for (const auto & rowPair : m_rows)
-		{
-			double coeff = rowPair.second->coefficientFor( info.tag.marker );
-			if( coeff != 0.0 &&
-				rowPair.second->add( delta * coeff ) < 0.0 &&
-				rowPair.first.type() != Symbol::External )
-				m_infeasible_rows.push_back( rowPair.first );
-		}
+		raise( trySetStrength( constraint, strength ), constraint );
 	}
 
-	/* Update the values of the external solver variables.
+	/* Change the strength of a constraint, reporting expected failures.
+
+	Strength only enters the objective as the weight of the error
+	markers, so the difference is added to the objective in place and
+	the system is reoptimized. The constraint object itself keeps the
+	strength it was created with.
 
 	*/
-	void updateVariables()
+	SolverStatus trySetStrength( const Constraint& constraint, double strength )
 	{
-		auto row_end = m_rows.end();
-
-		for (auto &varPair : m_vars)
-		{
-			Variable& var = varPair.first;
-			auto row_it = m_rows.find( varPair.second );
-			if( row_it == row_end )
-				var.setValue( 0.0 );
-			else
-				var.setValue( row_it->second->constant() );
-		}
+		finishDual();
+		SolverStatus status = unshare( constraint );
+		if( status != SolverStatus::Ok )
+			return status;
+		auto cn_it = findCn( constraint );
+		if( cn_it == m_cns.end() )
+			return SolverStatus::UnknownConstraint;
+		return updateStrength( cn_it->second, strength );
 	}
 
-	/* Reset the solver to the empty starting condition.
+	/* Get the strength a constraint has in the solver.
 
-	This method resets the internal solver state to the empty starting
-	condition, as if no constraints or edit variables have been added.
-	This can be faster than deleting the solver and creating a new one
-	when the entire system must change, since it can avoid unecessary
-	heap (de)allocations.
+	Returns a negative value if the constraint has not been added.
 
 	*/
-	void reset()
+	double constraintStrength( const Constraint& constraint ) const
 	{
-		clearRows();
-		m_cns.clear();
-		m_vars.clear();
-		m_edits.clear();
-		m_infeasible_rows.clear();
-		m_objective.reset( new Row() );
-		m_artificial.reset();
-		m_id_tick = 1;
+		if( isRowless( constraint ) )
+			return constraint.strength();
+		auto cn_it = findCn( constraint );
+		return cn_it != m_cns.end() ? cn_it->second.strength : -1.0;
 	}
 
-	SolverImpl& operator=( const SolverImpl& ) = delete;
+	/* Change the constant of a constraint in the solver.
 
-	SolverImpl& operator=( SolverImpl&& ) = delete;
+	The constant is that of the constraint expression, so for `x == 10`
+	it is -10. The constraint object itself is not modified.
 
-private:
+	Throws
+	------
+	UnknownConstraint
+		The given constraint has not been added to the solver.
 
-	struct RowDeleter
-	{
-		template<typename T>
-		void operator()( T& pair ) { delete pair.second; }
-	};
+	UnsatisfiableConstraint
+		The new constant conflicts with the required constraints. The
+		solver is left with the previous constant.
 
-	void clearRows()
+	*/
+	void setConstant( const Constraint& constraint, double constant )
 	{
-		std::for_each( m_rows.begin(), m_rows.end(), RowDeleter() );
-		m_rows.clear();
+		raise( trySetConstant( constraint, constant ), constraint );
 	}
 
-	/* Get the symbol for the given variable.
-
-	If a symbol does not exist for the variable, one will be created.
+	/* Change the constant of a constraint, reporting expected failures.
 
 	*/
-	Symbol getVarSymbol( const Variable& variable )
+	SolverStatus trySetConstant( const Constraint& constraint, double constant )
 	{
-		auto it = m_vars.find( variable );
-		if( it != m_vars.end() )
-			return it->second;
-		Symbol symbol( Symbol::External, m_id_tick++ );
-		m_vars[ variable ] = symbol;
-		return symbol;
+		return trySetConstants( 1, [&constraint]( std::size_t ) -> const Constraint& {
+			return constraint;
+		}, &constant );
 	}
 
-	/* Create a new Row object for the given constraint.
+	/* Change the constants of several constraints at once.
 
-	The terms in the constraint will be converted to cells in the row.
-	Any term in the constraint with a coefficient of zero is ignored.
-	This method uses the `getVarSymbol` method to get the symbol for
-	the variables added to the row. If the symbol for a given cell
+	`cnAt( i )` returns the i-th constraint to update. The change in
+	each constant is pushed through the tableau along the constraint
+	marker, in the same way `suggestValue` moves an edit variable, and
+	the solver is dual optimized once for the whole batch. If any
+	constraint is unknown nothing is changed. If the new constants are
+	unsatisfiable all of them are rolled back.
+
+	*/
+	template<typename CnAt>
+	SolverStatus trySetConstants( std::size_t count, CnAt&& cnAt, const double* constants )
+	{
+		finishDual();
+		finishPrimal();
+		for( std::size_t i = 0; i < count; ++i )
+		{
+			SolverStatus status = unshare( cnAt( i ) );
+			if( status != SolverStatus::Ok )
+				return status;
+			if( findCn( cnAt( i ) ) == m_cns.end() )
+				return SolverStatus::UnknownConstraint;
+		}
+
+		std::vector<double> previous( count );
+		bool dummies = false;
+		for( std::size_t i = 0; i < count; ++i )
+		{
+			const Constraint& constraint( cnAt( i ) );
+			Tag& tag = findCn( constraint )->second;
+			previous[ i ] = tag.constant;
+			// A disabled required constraint has no row in the tableau;
+			// the constant is picked up when it is enabled again.
+			if( !( tag.disabled && constraint.strength() >= strength::required ) )
+			{
+				shiftConstant( constraint, tag, constants[ i ] - tag.constant );
+				dummies = dummies || tag.marker.type() == Symbol::Dummy;
+			}
+			tag.constant = constants[ i ];
+		}
+
+		// Redundant required equalities share a row of dummy variables,
+		// which can only be satisfied with a zero constant.
+		if( ( !dummies || dummyRowsSatisfied() ) && tryDualOptimize() )
+			return SolverStatus::Ok;
+
+		for( std::size_t i = count; i-- > 0; )
+		{
+			const Constraint& constraint( cnAt( i ) );
+			Tag& tag = findCn( constraint )->second;
+			if( !( tag.disabled && constraint.strength() >= strength::required ) )
+				shiftConstant( constraint, tag, previous[ i ] - tag.constant );
+			tag.constant = previous[ i ];
+		}
+		repairFeasibility();
+		return SolverStatus::UnsatisfiableConstraint;
+	}
+
+	/* Get the constant a constraint has in the solver.
+
+	Returns 0.0 if the constraint has not been added.
+
+	*/
+	double constraintConstant( const Constraint& constraint ) const
+	{
+		if( isRowless( constraint ) )
+			return constraint.constant();
+		auto cn_it = findCn( constraint );
+		return cn_it != m_cns.end() ? cn_it->second.constant : 0.0;
+	}
+
+	/* Change the coefficient of a variable in a constraint in the solver.
+
+	A coefficient of zero removes the variable from the constraint and
+	a variable not yet in the constraint is added to it. The constraint
+	object itself is not modified.
+
+	Throws
+	------
+	UnknownConstraint
+		The given constraint has not been added to the solver.
+
+	UnsatisfiableConstraint
+		The new coefficient conflicts with the required constraints.
+		The solver is left with the previous coefficient.
+
+	*/
+	void setCoefficient( const Constraint& constraint, const Variable& variable, double coefficient )
+	{
+		raise( trySetCoefficient( constraint, variable, coefficient ), constraint );
+	}
+
+	/* Change the coefficient of a variable, reporting expected failures.
+
+	The change is made in two steps that each keep the tableau in a
+	state one of the simplex methods can continue from. First the term
+	`delta * (variable - value)` is added to the constraint, where
+	`value` is the current value of the variable. It is zero at the
+	current solution, so every row stays feasible and a primal
+	optimization finishes the step. The remaining `delta * value` is a
+	change of the constant, which is applied like `setConstant` and
+	followed by a dual optimization.
+
+	The first step is done in place when the variable is basic and
+	its row holds no other variables. A parameter variable, a row
+	with other variables as parameters, a basic dummy marker or a
+	degenerate rescale of the marker fall back to dropping and
+	reinserting the constraint, which allocates new symbols for it.
+
+	*/
+	SolverStatus trySetCoefficient( const Constraint& constraint, const Variable& variable, double coefficient )
+	{
+		finishDual();
+		SolverStatus status = unshare( constraint );
+		if( status != SolverStatus::Ok )
+			return status;
+		auto cn_it = findCn( constraint );
+		if( cn_it == m_cns.end() )
+			return SolverStatus::UnknownConstraint;
+
+		Tag& tag = cn_it->second;
+		double previous = constraintCoefficient( constraint, variable );
+		double delta = coefficient - previous;
+		if( delta == 0.0 )
+			return SolverStatus::Ok;
+		storeCoefficient( constraint, variable, coefficient );
+
+		// A disabled required constraint has no row in the tableau.
+		if( tag.disabled && constraint.strength() >= strength::required )
+			return SolverStatus::Ok;
+
+		Symbol symbol( getVarSymbol( variable ) );
+		double value = 0.0;
+		if( m_aliases.find( variable ) != m_aliases.end() ||
+			!shiftCoefficient( constraint, tag, symbol, delta, value ) )
+		{
+			// The marker cannot absorb the change in this basis, or the
+			// variable is presolved and has no symbol of its own.
+			dropConstraint( tag );
+			status = reinsertConstraint( constraint, tag );
+			if( status != SolverStatus::Ok )
+			{
+				storeCoefficient( constraint, variable, previous );
+				if( reinsertConstraint( constraint, tag ) != SolverStatus::Ok )
+					throw InternalSolverError( "failed to restore constraint" );
+			}
+			return status;
+		}
+		optimize( *m_objective );
+		if( value == 0.0 )
+			return SolverStatus::Ok;
+
+		shiftConstant( constraint, tag, delta * value );
+		if( ( tag.marker.type() != Symbol::Dummy || dummyRowsSatisfied() ) && tryDualOptimize() )
+			return SolverStatus::Ok;
+
+		// Undo both steps. The constant is restored against the value
+		// the variable has after the first one was undone.
+		shiftConstant( constraint, tag, -delta * value );
+		repairFeasibility();
+		storeCoefficient( constraint, variable, previous );
+		double restored = 0.0;
+		if( shiftCoefficient( constraint, tag, symbol, -delta, restored ) )
+		{
+			optimize( *m_objective );
+			shiftConstant( constraint, tag, delta * ( value - restored ) );
+			repairFeasibility();
+		}
+		else
+		{
+			dropConstraint( tag );
+			if( reinsertConstraint( constraint, tag ) != SolverStatus::Ok )
+				throw InternalSolverError( "failed to restore constraint" );
+		}
+		return SolverStatus::UnsatisfiableConstraint;
+	}
+
+	/* Get the coefficient of a variable in a constraint in the solver.
+
+	Returns 0.0 if the variable is not part of the constraint or the
+	constraint has not been added.
+
+	*/
+	double constraintCoefficient( const Constraint& constraint, const Variable& variable ) const
+	{
+		if( !hasConstraint( constraint ) )
+			return 0.0;
+		double coefficient = 0.0;
+		for( const auto& term : constraintTerms( constraint ) )
+		{
+			if( term.variable().equals( variable ) )
+				coefficient += term.coefficient();
+		}
+		return coefficient;
+	}
+
+	/* Add an edit variable to the solver.
+
+	This method should be called before the `suggestValue` method is
+	used to supply a suggested value for the given edit variable.
+
+	Throws
+	------
+	DuplicateEditVariable
+		The given edit variable has already been added to the solver.
+
+	BadRequiredStrength
+		The given strength is >= required.
+
+	*/
+	void addEditVariable( const Variable& variable, double strength )
+	{
+		raise( tryAddEditVariable( variable, strength ), variable );
+	}
+
+	/* Add an edit variable to the solver, reporting expected failures.
+
+	Returns SolverStatus::DuplicateEditVariable or
+	SolverStatus::BadRequiredStrength instead of throwing.
+
+	*/
+	SolverStatus tryAddEditVariable( const Variable& variable, double strength )
+	{
+		finishDual();
+		if( findEdit( variable ) != m_edits.end() )
+			return SolverStatus::DuplicateEditVariable;
+		strength = strength::clip( strength );
+		if( strength == strength::required )
+			return SolverStatus::BadRequiredStrength;
+		Constraint cn( Expression( variable ), OP_EQ, strength );
+		SolverStatus status = addUnshared( cn );
+		if( status != SolverStatus::Ok )
+			return status;
+		EditInfo info;
+		info.tag = findCn( cn )->second;
+		info.constraint = cn;
+		info.constant = 0.0;
+		m_edits[ variable ] = info;
+		return SolverStatus::Ok;
+	}
+
+	/* Remove an edit variable from the solver.
+
+	Throws
+	------
+	UnknownEditVariable
+		The given edit variable has not been added to the solver.
+
+	*/
+	void removeEditVariable( const Variable& variable )
+	{
+		raise( tryRemoveEditVariable( variable ), variable );
+	}
+
+	/* Remove an edit variable from the solver, reporting expected failures.
+
+	Returns SolverStatus::UnknownEditVariable instead of throwing.
+
+	*/
+	SolverStatus tryRemoveEditVariable( const Variable& variable )
+	{
+		auto it = findEdit( variable );
+		if( it == m_edits.end() )
+			return SolverStatus::UnknownEditVariable;
+		SolverStatus status = tryRemoveConstraint( it->second.constraint );
+		if( status != SolverStatus::Ok )
+			return status;
+		releaseSlot( variable.ptr()->edit_slot_, m_edit_hints );
+		m_edits.erase( it );
+		return SolverStatus::Ok;
+	}
+
+	/* Test whether an edit variable has been added to the solver.
+
+	*/
+	bool hasEditVariable( const Variable& variable ) const
+	{
+		return findEdit( variable ) != m_edits.end();
+	}
+
+	/* Change the strength of an edit variable in the solver.
+
+	Throws
+	------
+	UnknownEditVariable
+		The given edit variable has not been added to the solver.
+
+	BadRequiredStrength
+		The given strength is >= required.
+
+	*/
+	void setEditStrength( const Variable& variable, double strength )
+	{
+		raise( trySetEditStrength( variable, strength ), variable );
+	}
+
+	/* Change the strength of an edit variable, reporting expected failures.
+
+	*/
+	SolverStatus trySetEditStrength( const Variable& variable, double strength )
+	{
+		finishDual();
+		auto it = findEdit( variable );
+		if( it == m_edits.end() )
+			return SolverStatus::UnknownEditVariable;
+		auto cn_it = findCn( it->second.constraint );
+		if( cn_it == m_cns.end() )
+			throw InternalSolverError( "edit constraint is missing" );
+		SolverStatus status = updateStrength( cn_it->second, strength );
+		it->second.tag = cn_it->second;
+		return status;
+	}
+
+	/* Suggest a value for the given edit variable.
+
+	This method should be used after an edit variable as been added to
+	the solver in order to suggest the value for that variable.
+
+	Throws
+	------
+	UnknownEditVariable
+		The given edit variable has not been added to the solver.
+
+	*/
+	void suggestValue( const Variable& variable, double value )
+	{
+		raise( trySuggestValue( variable, value ), variable );
+	}
+
+	/* Suggest a value for the given edit variable, reporting expected failures.
+
+	Returns SolverStatus::UnknownEditVariable instead of throwing.
+
+	*/
+	SolverStatus trySuggestValue( const Variable& variable, double value )
+	{
+		auto it = findEdit( variable );
+		if( it == m_edits.end() )
+			return SolverStatus::UnknownEditVariable;
+
+		finishPrimal();
+		DualOptimizeGuard guard( *this );
+		EditInfo& info = it->second;
+		double delta = value - info.constant;
+		info.constant = value;
+
+		// Check first if the positive error variable is basic.
+		auto row_it = m_rows.find( info.tag.marker );
+		if( row_it != m_rows.end() )
+		{
+			saveFrame( *row_it->second );
+			if( row_it->second->add( -delta ) < 0.0 )
+				m_infeasible_rows.push_back( row_it->first );
+			return SolverStatus::Ok;
+		}
+
+		// Check next if the negative error variable is basic.
+		row_it = m_rows.find( info.tag.other );
+		if( row_it != m_rows.end() )
+		{
+			saveFrame( *row_it->second );
+			if( row_it->second->add( delta ) < 0.0 )
+				m_infeasible_rows.push_back( row_it->first );
+			return SolverStatus::Ok;
+		}
+
+		// Otherwise update each row where the error variables exist.
+		for (const auto & rowPair : m_rows)
+		{
+			double coeff = rowPair.second->coefficientFor( info.tag.marker );
+			if( coeff == 0.0 )
+				continue;
+			saveFrame( *rowPair.second );
+			if( rowPair.second->add( delta * coeff ) < 0.0 &&
+				rowPair.first.type() != Symbol::External )
+				m_infeasible_rows.push_back( rowPair.first );
+		}
+		return SolverStatus::Ok;
+	}
+
+	/* Update the values of the external solver variables.
+
+	Variables assigned a slot inside the bound value buffer have their
+	value written to the buffer instead of the variable. A bound
+	snapshot receives the values of all slotted variables as one frame.
+	While a deferred dual optimization is pending nothing is written, so
+	the values of the last update, which were feasible, are kept.
+
+	*/
+	void updateVariables()
+	{
+		if( m_pending_dual )
+			return;
+		if( m_snapshot )
+			publishSnapshot();
+		if( m_lazy_enabled )
+		{
+			m_lazy_basis.clear();
+			++m_lazy.generation;
+			if( m_values )
+				writeSlots();
+			return;
+		}
+		writeValues( []( const Variable&, double& dest, double value ) { dest = value; } );
+	}
+
+	/* Update the values of the external solver variables and report changes.
+
+	`changed( variable )` is invoked for each variable whose value moved by
+	more than `tolerance`. Values that move by less are left untouched, so
+	small drifts accumulate until they are reported.
+
+	*/
+	template<typename F>
+	void updateVariables( double tolerance, F&& changed )
+	{
+		if( m_pending_dual )
+			return;
+		if( m_snapshot )
+			publishSnapshot();
+		if( m_lazy_enabled )
+		{
+			m_lazy_basis.clear();
+			++m_lazy.generation;
+		}
+		writeValues( [tolerance, &changed]( const Variable& var, double& dest, double value ) {
+			if( std::abs( value - dest ) > tolerance )
+			{
+				dest = value;
+				changed( var );
+			}
+		} );
+	}
+
+	/* Get the number of variables known to the solver.
+
+	*/
+	std::size_t variableCount() const
+	{
+		return m_vars.size();
+	}
+
+	/* Read the current solution for a set of variables.
+
+	`varAt( i )` yields the VariableData of the i-th requested variable;
+	its value is written to `out[ i ]` without modifying the variable.
+	Variables unknown to the solver report their current value and null
+	variables report NaN.
+
+	Larger requests are matched against the variable map and the tableau
+	in one sorted pass each, instead of a lookup per variable.
+
+	*/
+	template<typename VarAt>
+	void getValues( std::size_t count, VarAt&& varAt, double* out ) const
+	{
+		using VarPtr = const VariableData*;
+
+		if( count * 16 < m_vars.size() )
+		{
+			for( std::size_t i = 0; i < count; ++i )
+				out[ i ] = valueOf( varAt( i ) );
+			return;
+		}
+
+		std::vector<std::size_t> order( count );
+		for( std::size_t i = 0; i < count; ++i )
+			order[ i ] = i;
+		std::sort( order.begin(), order.end(), [&varAt]( std::size_t a, std::size_t b ) {
+			return std::less<VarPtr>()( varAt( a ), varAt( b ) );
+		} );
+
+		struct SymbolSlot
+		{
+			Symbol symbol;
+			double scale;
+			std::size_t index;
+		};
+
+		std::vector<SymbolSlot> symbols;
+		symbols.reserve( count );
+		auto var_it = m_vars.begin();
+		auto var_end = m_vars.end();
+		for( std::size_t i : order )
+		{
+			VarPtr var = varAt( i );
+			if( !var )
+			{
+				out[ i ] = std::numeric_limits<double>::quiet_NaN();
+				continue;
+			}
+			while( var_it != var_end && std::less<VarPtr>()( var_it->first.ptr(), var ) )
+				++var_it;
+			if( var_it != var_end && var_it->first.ptr() == var )
+			{
+				symbols.push_back( SymbolSlot{ var_it->second.symbol, var_it->second.scale, i } );
+				out[ i ] = var_it->second.offset;
+			}
+			else
+				out[ i ] = var->value();
+		}
+
+		std::sort( symbols.begin(), symbols.end(), []( const SymbolSlot& a, const SymbolSlot& b ) {
+			return a.symbol < b.symbol;
+		} );
+
+		auto row_it = m_rows.begin();
+		auto row_end = m_rows.end();
+		for( const auto& slot : symbols )
+		{
+			while( row_it != row_end && row_it->first < slot.symbol )
+				++row_it;
+			if( row_it != row_end && row_it->first == slot.symbol )
+				out[ slot.index ] += slot.scale * row_it->second->constant();
+		}
+	}
+
+	/* Bind an external buffer which receives the values of slotted variables.
+
+	Passing a null buffer or a zero size unbinds the current buffer.
+	The buffer must remain valid until it is unbound or the solver is
+	reset or destroyed.
+
+	*/
+	void bindValues( double* values, std::size_t size )
+	{
+		m_values = size > 0 ? values : nullptr;
+		m_values_size = values ? size : 0;
+	}
+
+	/* Bind a snapshot which updateVariables() publishes the values of
+	slotted variables to.
+
+	Each update writes the value of every variable with a slot below
+	the size of the snapshot as one frame, which other threads can read
+	without locking. Passing null unbinds it. The snapshot must remain
+	valid until it is unbound or the solver is reset or destroyed.
+
+	*/
+	void bindSnapshot( ValueSnapshot* snapshot )
+	{
+		m_snapshot = snapshot;
+	}
+
+	/* Assign a dense slot index in the bound value buffer to a variable.
+
+	The variable is registered with the solver if it is not yet known.
+	Passing NoSlot removes the assignment.
+
+	*/
+	void setVariableSlot( const Variable& variable, std::size_t slot )
+	{
+		auto it = findVar( variable );
+		if( it == m_vars.end() )
+		{
+			getVarSymbol( variable );
+			it = findVar( variable );
+		}
+		it->second.slot = slot;
+	}
+
+	/* Enable or disable lazy variable updates.
+
+	In lazy mode updateVariables() only advances a generation counter.
+	Variables registered with the solver are bound to it and compute
+	their value when next read, so variables which are never read cost
+	nothing. The first change to a row constant or to the basis in a
+	generation saves the value it replaces, so every value read belongs
+	to the solution of the last update. Slots in a bound value buffer
+	are still written eagerly. A variable is bound to the first lazy solver it is registered
+	with; disabling lazy mode resolves and unbinds every bound variable.
+
+	*/
+	void setLazyUpdates( bool enabled )
+	{
+		if( enabled == m_lazy_enabled )
+			return;
+		m_lazy_enabled = enabled;
+		if( !enabled )
+		{
+			unbindLazy();
+			m_lazy_basis.clear();
+			return;
+		}
+		for( auto& varPair : m_vars )
+			bindLazy( varPair.first );
+	}
+
+	bool lazyUpdates() const
+	{
+		return m_lazy_enabled;
+	}
+
+	/* Enable or disable sharing of rows between equivalent constraints.
+
+	While enabled, a constraint with the same nonzero terms, operator,
+	strength and constant as one already in the solver shares its row
+	instead of getting one of its own. A soft duplicate adds its strength
+	to the weight of the shared row, so the solution is the same as with
+	separate rows. A required inequality which is implied by a tighter
+	one with the same terms is recorded without a row at all. The shared
+	row stays until its last constraint is removed. Changing a shared
+	constraint in place gives it a row of its own first. Disabling only
+	affects constraints added afterwards.
+
+	*/
+	void setDeduplication( bool enabled )
+	{
+		m_dedup_enabled = enabled;
+	}
+
+	bool deduplication() const
+	{
+		return m_dedup_enabled;
+	}
+
+	/* Enable or disable presolving of trivial required constraints.
+
+	While enabled, a required `x == c`, `x == y + c`, `x >= c` or
+	`x <= c` whose variable x is not yet known to the solver does not
+	get a row. x is fixed, made an alias of y, or bounded by a slack
+	symbol of its own in the variable map, and rows which use x refer
+	to that symbol instead. Removing or changing such a constraint
+	splits the alias again and rebuilds the rows which use x or its
+	aliases. Disabling only affects constraints added afterwards.
+
+	*/
+	void setPresolve( bool enabled )
+	{
+		m_presolve_enabled = enabled;
+	}
+
+	bool presolve() const
+	{
+		return m_presolve_enabled;
+	}
+
+	/* Split the per-pivot loops over the rows across worker threads.
+
+	While the tableau holds at least `min_rows` rows, substitutions and
+	the leaving row searches are divided into contiguous ranges of rows
+	which run on a pool of `threads` threads, the calling thread
+	included. The results of the ranges are merged in row order, so the
+	pivots, the infeasible rows and the solution are the same as with a
+	single thread. A thread count below two stops the pool.
+
+	*/
+	void setParallel( std::size_t threads, std::size_t min_rows = DefaultParallelRows )
+	{
+		if( threads < 2 )
+			m_pool.reset();
+		else if( !m_pool || m_pool->size() != threads )
+		{
+			m_pool.reset();
+			m_pool.reset( new ThreadPool( threads ) );
+		}
+		m_parallel_rows = min_rows;
+	}
+
+	std::size_t parallelThreads() const
+	{
+		return m_pool ? m_pool->size() : 1;
+	}
+
+	/* Enable or disable deferred optimization.
+
+	While enabled, updates leave the reoptimization they need pending
+	and optimizeFor() carries it out in budgeted steps. Between steps
+	after structural updates the tableau is feasible and the values are
+	a valid but not yet optimal solution. After suggested values the
+	tableau violates constraints until the steps are done, and
+	updateVariables() keeps the values of the last update meanwhile.
+	An update which
+	cannot start from the pending state finishes it first. Disabling
+	finishes any pending optimization.
+
+	*/
+	void setDeferredOptimize( bool enabled )
+	{
+		if( !enabled )
+		{
+			finishDual();
+			finishPrimal();
+		}
+		m_deferred_enabled = enabled;
+	}
+
+	bool deferredOptimize() const
+	{
+		return m_deferred_enabled;
+	}
+
+	/* Test whether no deferred optimization is pending.
+
+	*/
+	bool optimized() const
+	{
+		return !m_pending_primal && !m_pending_dual;
+	}
+
+	/* Make at most `maxPivots` pivots of pending optimization.
+
+	Returns true once the solver is optimal and feasible.
+
+	*/
+	bool optimizeFor( std::size_t maxPivots )
+	{
+		return optimizeWhile( [&maxPivots]() {
+			if( maxPivots == 0 )
+				return false;
+			--maxPivots;
+			return true;
+		} );
+	}
+
+	/* Make pivots of pending optimization until the deadline passes or
+	`maxPivots` pivots were made.
+
+	Returns true once the solver is optimal and feasible.
+
+	*/
+	bool optimizeFor( std::chrono::steady_clock::time_point deadline,
+		std::size_t maxPivots = std::numeric_limits<std::size_t>::max() )
+	{
+		return optimizeWhile( [deadline, &maxPivots]() {
+			if( maxPivots == 0 || std::chrono::steady_clock::now() >= deadline )
+				return false;
+			--maxPivots;
+			return true;
+		} );
+	}
+
+	/* Reset the solver to the empty starting condition.
+
+	This method resets the internal solver state to the empty starting
+	condition, as if no constraints or edit variables have been added.
+	This can be faster than deleting the solver and creating a new one
+	when the entire system must change, since it can avoid unecessary
+	heap (de)allocations.
+
+	*/
+	void reset()
+	{
+		unbindLazy();
+		m_lazy_basis.clear();
+		releaseSlots();
+		clearRows();
+		m_cns.clear();
+		m_cn_terms.clear();
+		m_shared.clear();
+		m_members.clear();
+		m_cn_hashes.clear();
+		m_cn_index.clear();
+		m_aliases.clear();
+		m_presolved.clear();
+		m_vars.clear();
+		m_edits.clear();
+		m_infeasible_rows.clear();
+		m_objective.reset( new Row() );
+		m_artificial.reset();
+		m_id_tick = 1;
+		m_values = nullptr;
+		m_values_size = 0;
+		m_snapshot = nullptr;
+		m_pending_primal = false;
+		m_pending_dual = false;
+		m_toggled = false;
+	}
+
+	SolverImpl& operator=( const SolverImpl& ) = delete;
+
+	SolverImpl& operator=( SolverImpl&& ) = delete;
+
+private:
+
+	struct RowDeleter
+	{
+		template<typename T>
+		void operator()( T& pair ) { delete pair.second; }
+	};
+
+	void clearRows()
+	{
+		std::for_each( m_rows.begin(), m_rows.end(), RowDeleter() );
+		m_rows.clear();
+	}
+
+	/* Throw the exception matching a failed constraint operation.
+
+	*/
+	static void raise( SolverStatus status, const Constraint& constraint )
+	{
+		switch( status )
+		{
+			case SolverStatus::Ok:
+				return;
+			case SolverStatus::UnsatisfiableConstraint:
+				throw UnsatisfiableConstraint( constraint );
+			case SolverStatus::UnknownConstraint:
+				throw UnknownConstraint( constraint );
+			case SolverStatus::DuplicateConstraint:
+				throw DuplicateConstraint( constraint );
+			case SolverStatus::BadRequiredStrength:
+				throw BadRequiredStrength();
+			default:
+				throw InternalSolverError( "unexpected constraint status" );
+		}
+	}
+
+	/* Throw the exception matching a failed edit variable operation.
+
+	*/
+	static void raise( SolverStatus status, const Variable& variable )
+	{
+		switch( status )
+		{
+			case SolverStatus::Ok:
+				return;
+			case SolverStatus::UnknownEditVariable:
+				throw UnknownEditVariable( variable );
+			case SolverStatus::DuplicateEditVariable:
+				throw DuplicateEditVariable( variable );
+			case SolverStatus::BadRequiredStrength:
+				throw BadRequiredStrength();
+			default:
+				throw InternalSolverError( "unexpected edit variable status" );
+		}
+	}
+
+	/* Compute the value of every variable and hand it to the writer.
+
+	`write( variable, dest, value )` receives the storage for the value,
+	which is the bound buffer slot or the variable itself.
+
+	*/
+	template<typename F>
+	void writeValues( F&& write )
+	{
+		auto row_end = m_rows.end();
+
+		for (auto &varPair : m_vars)
+		{
+			auto row_it = m_rows.find( varPair.second.symbol );
+			double value = varPair.second.offset;
+			if( row_it != row_end )
+				value += varPair.second.scale * row_it->second->constant();
+			VariableData* var = varPair.first.ptr();
+			if( varPair.second.slot < m_values_size )
+			{
+				write( varPair.first, m_values[ varPair.second.slot ], value );
+				continue;
+			}
+			write( varPair.first, var->value_, value );
+			if( var->lazy_ == &m_lazy )
+				var->lazy_gen_ = m_lazy.generation;
+		}
+	}
+
+	/* Write the values of slotted variables to the bound buffer.
+
+	*/
+	void writeSlots()
+	{
+		forSlots( m_values_size, [this]( std::size_t slot, double value ) {
+			m_values[ slot ] = value;
+		} );
+	}
+
+	/* Publish the values of slotted variables to the bound snapshot.
+
+	*/
+	void publishSnapshot()
+	{
+		ValueSnapshot& snapshot = *m_snapshot;
+		snapshot.beginWrite();
+		forSlots( snapshot.size(), [&snapshot]( std::size_t slot, double value ) {
+			snapshot.store( slot, value );
+		} );
+		snapshot.endWrite();
+	}
+
+	/* Call fn( slot, value ) for each variable with a slot below `size`.
+
+	*/
+	template<typename F>
+	void forSlots( std::size_t size, F&& fn ) const
+	{
+		auto row_end = m_rows.end();
+
+		for( const auto& varPair : m_vars )
+		{
+			if( varPair.second.slot >= size )
+				continue;
+			auto row_it = m_rows.find( varPair.second.symbol );
+			double value = varPair.second.offset;
+			if( row_it != row_end )
+				value += varPair.second.scale * row_it->second->constant();
+			fn( varPair.second.slot, value );
+		}
+	}
+
+	/* Bind a variable to the lazy value source of this solver.
+
+	Variables already bound to another solver are left alone. The current
+	value is kept until the next call to updateVariables().
+
+	*/
+	void bindLazy( const Variable& variable )
+	{
+		const VariableData* var = variable.ptr();
+		if( var->lazy_ )
+			return;
+		VariableData* data = const_cast<VariableData*>( var );
+		data->lazy_ = &m_lazy;
+		data->lazy_gen_ = m_lazy.generation;
+	}
+
+	/* Resolve the pending value of every variable bound to this solver
+	and unbind it.
+
+	*/
+	void unbindLazy()
+	{
+		for( auto& varPair : m_vars )
+		{
+			VariableData* var = varPair.first.ptr();
+			if( var->lazy_ != &m_lazy )
+				continue;
+			var->value();
+			var->lazy_ = nullptr;
+		}
+	}
+
+	/* Save the value a symbol had at the last update before it enters
+	or leaves the basis.
+
+	Only the first change in a generation is kept, and only for the
+	kinds of symbol a variable can map to.
+
+	*/
+	void saveFrameBasis( const Symbol& symbol )
+	{
+		if( !m_lazy_enabled ||
+			( symbol.type() != Symbol::External && symbol.type() != Symbol::Slack ) ||
+			m_lazy_basis.find( symbol ) != m_lazy_basis.end() )
+			return;
+		auto row_it = m_rows.find( symbol );
+		m_lazy_basis[ symbol ] = row_it != m_rows.end() ?
+			row_it->second->frameConstant( m_lazy.generation ) : 0.0;
+	}
+
+	/* Save the constant of a row in the tableau before it changes.
+
+	*/
+	void saveFrame( Row& row )
+	{
+		if( m_lazy_enabled )
+			row.saveFrame( m_lazy.generation );
+	}
+
+	/* Resolve the pending value of a bound variable before the solver
+	changes how it maps to the tableau.
+
+	*/
+	void settleLazy( const Variable& variable )
+	{
+		if( variable.ptr()->lazy_ == &m_lazy )
+			variable.value();
+	}
+
+	/* Get the symbol for the given variable.
+
+	If a symbol does not exist for the variable, one will be created.
+
+	*/
+	Symbol getVarSymbol( const Variable& variable )
+	{
+		return getVarInfo( variable ).symbol;
+	}
+
+	/* Get the variable map entry for the given variable.
+
+	If the variable is not in the map, it is added with a new symbol.
+
+	*/
+	VarInfo& getVarInfo( const Variable& variable )
+	{
+		auto it = findVar( variable );
+		if( it != m_vars.end() )
+			return it->second;
+		Symbol symbol( Symbol::External, m_id_tick++ );
+		VarInfo& info( m_vars[ variable ] );
+		info = VarInfo( symbol );
+		if( m_lazy_enabled )
+			bindLazy( variable );
+		return info;
+	}
+
+	/* Add a constraint with a row of its own.
+
+	With presolve enabled, a trivial required equality may be folded
+	into the variable map instead.
+
+	*/
+	SolverStatus addUnshared( const Constraint& constraint )
+	{
+		if( m_presolve_enabled && presolveConstraint( constraint ) )
+			return SolverStatus::Ok;
+
+		Tag tag;
+		SolverStatus status = insertConstraint( constraint, tag, constraint.constant() );
+		if( status == SolverStatus::Ok )
+			m_cns[ constraint ] = tag;
+		return status;
+	}
+
+	/* Add a constraint, sharing the row of an equivalent one if possible.
+
+	Only constraints in the index can carry the row of another. Those
+	are enabled and have not been changed since they were added, so
+	the constraint object describes their row.
+
+	*/
+	SolverStatus shareConstraint( const Constraint& constraint )
+	{
+		std::size_t hash = structureHash( constraint );
+		auto idx_it = m_cn_index.find( hash );
+		if( idx_it != m_cn_index.end() )
+		{
+			const Constraint* owner = nullptr;
+			for( const auto& candidate : idx_it->second )
+			{
+				if( !sameStructure( candidate, constraint ) || !coversConstraint( candidate, constraint ) )
+					continue;
+				owner = &candidate;
+				if( candidate.constant() == constraint.constant() )
+					break;
+			}
+			if( owner )
+			{
+				joinShared( Constraint( *owner ), constraint );
+				return SolverStatus::Ok;
+			}
+		}
+
+		SolverStatus status = addUnshared( constraint );
+		if( status == SolverStatus::Ok && m_presolved.find( constraint ) == m_presolved.end() )
+		{
+			m_cn_index[ hash ].push_back( constraint );
+			m_cn_hashes[ constraint ] = hash;
+		}
+		return status;
+	}
+
+	/* Record a constraint as carried by the row of another.
+
+	*/
+	void joinShared( const Constraint& owner, const Constraint& constraint )
+	{
+		m_shared[ constraint ] = owner;
+		m_members[ owner ].push_back( constraint );
+		// Only duplicates of a soft constraint can be soft.
+		if( constraint.strength() < strength::required )
+		{
+			shiftConstraintEffects( m_cns[ owner ], constraint.strength() );
+			reoptimize();
+		}
+	}
+
+	/* Detach a constraint from the row it shares.
+
+	*/
+	void leaveShared( CnShareMap::iterator sh_it )
+	{
+		Constraint constraint( sh_it->first );
+		Constraint owner( sh_it->second );
+		m_shared.erase( sh_it );
+		auto mem_it = m_members.find( owner );
+		std::vector<Constraint>& members( mem_it->second );
+		members.erase( std::find( members.begin(), members.end(), constraint ) );
+		if( members.empty() )
+			m_members.erase( mem_it );
+		if( constraint.strength() < strength::required )
+		{
+			shiftConstraintEffects( m_cns[ owner ], -constraint.strength() );
+			reoptimize();
+		}
+	}
+
+	/* Remove a constraint from the index of shareable rows.
+
+	Returns true if the constraint was in the index.
+
+	*/
+	bool unindexConstraint( const Constraint& constraint )
+	{
+		auto hash_it = m_cn_hashes.find( constraint );
+		if( hash_it == m_cn_hashes.end() )
+			return false;
+		auto idx_it = m_cn_index.find( hash_it->second );
+		std::vector<Constraint>& bucket( idx_it->second );
+		bucket.erase( std::find( bucket.begin(), bucket.end(), constraint ) );
+		if( bucket.empty() )
+			m_cn_index.erase( idx_it );
+		m_cn_hashes.erase( hash_it );
+		return true;
+	}
+
+	/* Give the row of an owner which is being removed to a duplicate.
+
+	The duplicate takes over the tag and the index entry of the owner,
+	and the remaining members move with it. Returns false if the owner
+	has no duplicate among its members.
+
+	*/
+	bool handOverRow( const Constraint& owner )
+	{
+		auto mem_it = m_members.find( owner );
+		if( mem_it == m_members.end() )
+			return false;
+		std::vector<Constraint> members( mem_it->second );
+		auto dup_it = std::find_if( members.begin(), members.end(), [&owner]( const Constraint& member ) {
+			return member.constant() == owner.constant();
+		} );
+		if( dup_it == members.end() )
+			return false;
+
+		Constraint heir( *dup_it );
+		members.erase( dup_it );
+		m_members.erase( mem_it );
+		m_shared.erase( heir );
+		auto cn_it = findCn( owner );
+		Tag tag( cn_it->second );
+		releaseSlot( owner.ptr()->m_slot, m_cn_hints );
+		m_cns.erase( cn_it );
+		m_cns[ heir ] = tag;
+		for( const auto& member : members )
+			m_shared[ member ] = heir;
+		if( !members.empty() )
+			m_members[ heir ] = std::move( members );
+
+		std::size_t hash = structureHash( heir );
+		m_cn_index[ hash ].push_back( heir );
+		m_cn_hashes[ heir ] = hash;
+
+		if( heir.strength() < strength::required )
+		{
+			shiftConstraintEffects( tag, -heir.strength() );
+			reoptimize();
+		}
+		return true;
+	}
+
+	/* Move the members of a shared row off it.
+
+	The weight the members added to the row is taken off again and the
+	members are added anew, tightest bound first, so the first one gets
+	a row and the others share it.
+
+	*/
+	void rehomeMembers( const Constraint& owner )
+	{
+		auto mem_it = m_members.find( owner );
+		if( mem_it == m_members.end() )
+			return;
+		std::vector<Constraint> members;
+		members.swap( mem_it->second );
+		m_members.erase( mem_it );
+
+		Tag tag( m_cns[ owner ] );
+		for( const auto& member : members )
+		{
+			m_shared.erase( member );
+			if( member.strength() < strength::required )
+				shiftConstraintEffects( tag, -member.strength() );
+		}
+
+		std::sort( members.begin(), members.end(), []( const Constraint& lhs, const Constraint& rhs ) {
+			return lhs.op() == OP_LE ? lhs.constant() > rhs.constant() : lhs.constant() < rhs.constant();
+		} );
+		for( const auto& member : members )
+		{
+			if( shareConstraint( member ) != SolverStatus::Ok )
+				throw InternalSolverError( "failed to re-add shared constraint" );
+		}
+	}
+
+	/* Give a constraint a row of its own before it is changed.
+
+	A presolved constraint is taken out of the variable map and added
+	as a row. A member is detached from the row it shares and added
+	again on its own. An owner is taken out of the index and its
+	members are moved off its row. On failure a member stays shared.
+
+	*/
+	SolverStatus unshare( const Constraint& constraint )
+	{
+		if( unpresolve( constraint ) )
+		{
+			// The variables are known to the tableau now, so the
+			// constraint is not folded again.
+			if( addUnshared( constraint ) != SolverStatus::Ok )
+				throw InternalSolverError( "failed to restore constraint" );
+			return SolverStatus::Ok;
+		}
+
+		auto sh_it = m_shared.find( constraint );
+		if( sh_it != m_shared.end() )
+		{
+			Constraint owner( sh_it->second );
+			leaveShared( sh_it );
+			SolverStatus status = addUnshared( constraint );
+			if( status != SolverStatus::Ok )
+				joinShared( owner, constraint );
+			return status;
+		}
+		if( unindexConstraint( constraint ) )
+			rehomeMembers( constraint );
+		return SolverStatus::Ok;
+	}
+
+	/* Test whether a constraint is in the solver without a row of its own.
+
+	*/
+	bool isRowless( const Constraint& constraint ) const
+	{
+		return m_shared.find( constraint ) != m_shared.end() ||
+			m_presolved.find( constraint ) != m_presolved.end();
+	}
+
+	/* Fold a trivial required constraint into the variable map.
+
+	`a*x + k == 0` fixes x at -k/a, and `a*x - a*y + k == 0` makes x an
+	alias of y offset by -k/a. A bound `a*x + k >= 0` or `<= 0` makes x
+	-k/a plus or minus a new slack symbol. The bound is then kept by the
+	sign restriction of the slack, which the ratio tests already honour,
+	and no row or slack marker is needed for it. Only a variable the
+	solver does not know yet is folded, so no row has to change.
+	Returns false if the constraint needs a row.
+
+	*/
+	bool presolveConstraint( const Constraint& constraint )
+	{
+		if( constraint.strength() < strength::required )
+			return false;
+		const Term* terms[ 2 ];
+		std::size_t count = 0;
+		for( const auto& term : constraint.terms() )
+		{
+			if( nearZero( term.coefficient() ) )
+				continue;
+			if( count == 2 )
+				return false;
+			terms[ count++ ] = &term;
+		}
+
+		double constant = constraint.constant();
+		if( count == 1 )
+		{
+			const Variable& var( terms[ 0 ]->variable() );
+			if( findVar( var ) != m_vars.end() )
+				return false;
+			double coeff = terms[ 0 ]->coefficient();
+			Symbol symbol;
+			double scale = 1.0;
+			if( constraint.op() != OP_EQ )
+			{
+				symbol = Symbol( Symbol::Slack, m_id_tick++ );
+				if( ( constraint.op() == OP_GE ) != ( coeff > 0.0 ) )
+					scale = -1.0;
+			}
+			rootVariable( constraint, var, symbol, scale, -constant / coeff );
+			return true;
+		}
+
+		if( constraint.op() != OP_EQ || count != 2 ||
+			terms[ 0 ]->coefficient() != -terms[ 1 ]->coefficient() )
+			return false;
+		double offset = constant / terms[ 0 ]->coefficient();
+		const Variable& first( terms[ 0 ]->variable() );
+		const Variable& second( terms[ 1 ]->variable() );
+		if( findVar( first ) == m_vars.end() )
+			aliasVariable( constraint, first, second, -offset );
+		else if( findVar( second ) == m_vars.end() )
+			aliasVariable( constraint, second, first, offset );
+		else
+			return false;
+		return true;
+	}
+
+	/* Add a variable to the variable map as an alias of another.
+
+	*/
+	void aliasVariable( const Constraint& constraint, const Variable& variable,
+		const Variable& parent, double offset )
+	{
+		const VarInfo& parentInfo( getVarInfo( parent ) );
+		VarInfo info( parentInfo.symbol );
+		info.scale = parentInfo.scale;
+		info.offset = parentInfo.offset + offset;
+		presolveVariable( constraint, variable, info, Alias{ parent, offset, false } );
+	}
+
+	/* Add a variable to the variable map as a fixed or bounded root.
+
+	*/
+	void rootVariable( const Constraint& constraint, const Variable& variable,
+		const Symbol& symbol, double scale, double offset )
+	{
+		VarInfo info( symbol );
+		info.scale = scale;
+		info.offset = offset;
+		presolveVariable( constraint, variable, info, Alias{ variable, offset, true } );
+	}
+
+	void presolveVariable( const Constraint& constraint, const Variable& variable,
+		const VarInfo& info, const Alias& alias )
+	{
+		m_vars[ variable ] = info;
+		if( m_lazy_enabled )
+			bindLazy( variable );
+		m_aliases.insert( std::make_pair( variable, alias ) );
+		m_presolved.insert( std::make_pair( constraint, variable ) );
+	}
+
+	/* Take a presolved constraint out of the variable map.
+
+	The variable it folded becomes free again, along with every alias
+	of it. Rows which refer to any of those variables are rebuilt.
+	Returns false if the constraint is not presolved.
+
+	*/
+	bool unpresolve( const Constraint& constraint )
+	{
+		auto pre_it = m_presolved.find( constraint );
+		if( pre_it == m_presolved.end() )
+			return false;
+		Variable variable( pre_it->second );
+		m_presolved.erase( pre_it );
+
+		// Collect the aliases of the variable, parents before children.
+		std::vector<Variable> split{ variable };
+		for( std::size_t i = 0; i < split.size(); ++i )
+		{
+			for( const auto& aliasPair : m_aliases )
+			{
+				if( !aliasPair.second.root && aliasPair.second.parent.equals( split[ i ] ) )
+					split.push_back( aliasPair.first );
+			}
+		}
+		std::vector<Variable> sorted( split );
+		std::sort( sorted.begin(), sorted.end() );
+
+		std::vector<Constraint> affected;
+		for( const auto& cnPair : m_cns )
+		{
+			const Constraint& cn( cnPair.first );
+			if( cnPair.second.disabled && cn.strength() >= strength::required )
+				continue;
+			for( const auto& term : constraintTerms( cn ) )
+			{
+				if( std::binary_search( sorted.begin(), sorted.end(), term.variable() ) )
+				{
+					affected.push_back( cn );
+					break;
+				}
+			}
+		}
+
+		std::vector<double> shared( affected.size() );
+		for( std::size_t i = 0; i < affected.size(); ++i )
+		{
+			Tag& tag = findCn( affected[ i ] )->second;
+			shared[ i ] = sharedWeight( affected[ i ] );
+			if( shared[ i ] != 0.0 )
+				shiftConstraintEffects( tag, -shared[ i ] );
+			dropConstraint( tag );
+		}
+		reoptimize();
+
+		for( const auto& var : split )
+			settleLazy( var );
+		m_aliases.erase( variable );
+		VarInfo& info( findVar( variable )->second );
+		info.symbol = Symbol( Symbol::External, m_id_tick++ );
+		info.scale = 1.0;
+		info.offset = 0.0;
+		for( std::size_t i = 1; i < split.size(); ++i )
+		{
+			const Alias& alias( m_aliases.find( split[ i ] )->second );
+			const VarInfo& parentInfo( findVar( alias.parent )->second );
+			VarInfo& aliasInfo( findVar( split[ i ] )->second );
+			aliasInfo.symbol = parentInfo.symbol;
+			aliasInfo.scale = parentInfo.scale;
+			aliasInfo.offset = parentInfo.offset + alias.offset;
+		}
+
+		for( std::size_t i = 0; i < affected.size(); ++i )
+		{
+			Tag& tag = findCn( affected[ i ] )->second;
+			if( reinsertConstraint( affected[ i ], tag ) != SolverStatus::Ok )
+				throw InternalSolverError( "failed to split variable alias" );
+			if( shared[ i ] != 0.0 )
+			{
+				shiftConstraintEffects( tag, shared[ i ] );
+				reoptimize();
+			}
+		}
+
+		// Rebuilt edit rows start from a zero suggestion.
+		for( auto& editPair : m_edits )
+		{
+			EditInfo& edit( editPair.second );
+			if( std::find( affected.begin(), affected.end(), edit.constraint ) == affected.end() )
+				continue;
+			edit.tag = findCn( edit.constraint )->second;
+			double value = edit.constant;
+			edit.constant = 0.0;
+			trySuggestValue( editPair.first, value );
+		}
+		finishDual();
+		return true;
+	}
+
+	/* Get the weight soft duplicates add to the row of a constraint.
+
+	*/
+	double sharedWeight( const Constraint& owner ) const
+	{
+		double weight = 0.0;
+		auto mem_it = m_members.find( owner );
+		if( mem_it == m_members.end() )
+			return weight;
+		for( const auto& member : mem_it->second )
+		{
+			if( member.strength() < strength::required )
+				weight += member.strength();
+		}
+		return weight;
+	}
+
+	/* Hash the terms, operator and strength of a constraint.
+
+	The constant is left out, so constraints which only differ in their
+	bound end up in the same bucket.
+
+	*/
+	static std::size_t structureHash( const Constraint& constraint )
+	{
+		std::size_t hash = std::hash<int>()( constraint.op() );
+		hash = combineHash( hash, std::hash<double>()( constraint.strength() ) );
+		for( const auto& term : constraint.terms() )
+		{
+			if( term.coefficient() == 0.0 )
+				continue;
+			hash = combineHash( hash, std::hash<const VariableData*>()( term.variable().ptr() ) );
+			hash = combineHash( hash, std::hash<double>()( term.coefficient() ) );
+		}
+		return hash;
+	}
+
+	static std::size_t combineHash( std::size_t hash, std::size_t value )
+	{
+		return hash ^ ( value + 0x9e3779b9 + ( hash << 6 ) + ( hash >> 2 ) );
+	}
+
+	/* Test whether two constraints have the same terms, operator and strength.
+
+	The terms of a constraint are sorted by variable, so they can be
+	compared pairwise once zero coefficients are skipped.
+
+	*/
+	static bool sameStructure( const Constraint& lhs, const Constraint& rhs )
+	{
+		if( lhs.op() != rhs.op() || lhs.strength() != rhs.strength() )
+			return false;
+		auto lterms = lhs.terms();
+		auto rterms = rhs.terms();
+		const Term* lit = lterms.begin();
+		const Term* rit = rterms.begin();
+		for( ;; )
+		{
+			while( lit != lterms.end() && lit->coefficient() == 0.0 )
+				++lit;
+			while( rit != rterms.end() && rit->coefficient() == 0.0 )
+				++rit;
+			if( lit == lterms.end() || rit == rterms.end() )
+				return lit == lterms.end() && rit == rterms.end();
+			if( !lit->variable().equals( rit->variable() ) || lit->coefficient() != rit->coefficient() )
+				return false;
+			++lit;
+			++rit;
+		}
+	}
+
+	/* Test whether the row of `owner` satisfies a constraint of the same structure.
+
+	An equal constant makes the constraint a duplicate. A required
+	inequality with a looser bound than the owner is implied by it.
+
+	*/
+	static bool coversConstraint( const Constraint& owner, const Constraint& constraint )
+	{
+		if( constraint.constant() == owner.constant() )
+			return true;
+		if( constraint.strength() < strength::required )
+			return false;
+		switch( constraint.op() )
+		{
+		case OP_GE:
+			return constraint.constant() > owner.constant();
+		case OP_LE:
+			return constraint.constant() < owner.constant();
+		default:
+			return false;
+		}
+	}
+
+	/* Get the terms a constraint has in the solver.
+
+	*/
+	ConstraintData::TermRange constraintTerms( const Constraint& constraint ) const
+	{
+		auto it = m_cn_terms.find( constraint );
+		if( it == m_cn_terms.end() )
+			return constraint.terms();
+		const std::vector<Term>& terms( it->second );
+		return ConstraintData::TermRange( terms.data(), terms.data() + terms.size() );
+	}
+
+	/* Record the coefficient of a variable in a constraint.
+
+	The terms of the constraint are copied on the first change.
+
+	*/
+	void storeCoefficient( const Constraint& constraint, const Variable& variable, double coefficient )
+	{
+		auto it = m_cn_terms.find( constraint );
+		if( it == m_cn_terms.end() )
+		{
+			auto terms = constraint.terms();
+			it = m_cn_terms.insert( std::make_pair( constraint,
+				std::vector<Term>( terms.begin(), terms.end() ) ) ).first;
+		}
+		std::vector<Term>& terms( it->second );
+		terms.erase( std::remove_if( terms.begin(), terms.end(), [&variable]( const Term& term ) {
+			return term.variable().equals( variable );
+		} ), terms.end() );
+		if( coefficient != 0.0 )
+			terms.emplace_back( variable, coefficient );
+	}
+
+	/* Get the current solution value for a variable.
+
+	*/
+	double valueOf( const VariableData* var ) const
+	{
+		if( !var )
+			return std::numeric_limits<double>::quiet_NaN();
+		auto it = findSlotted( m_vars, var, var->var_slot_, m_var_hints );
+		if( it == m_vars.end() )
+			return var->value();
+		auto row_it = m_rows.find( it->second.symbol );
+		double value = it->second.offset;
+		return row_it != m_rows.end() ? value + it->second.scale * row_it->second->constant() : value;
+	}
+
+	/* Get the value a variable had at the last updateVariables().
+
+	*/
+	double frameValueOf( const VariableData* var ) const
+	{
+		auto it = findSlotted( m_vars, var, var->var_slot_, m_var_hints );
+		if( it == m_vars.end() )
+			return var->value_;
+		const Symbol& symbol( it->second.symbol );
+		double constant = 0.0;
+		auto basis_it = m_lazy_basis.find( symbol );
+		if( basis_it != m_lazy_basis.end() )
+			constant = basis_it->second;
+		else
+		{
+			auto row_it = m_rows.find( symbol );
+			if( row_it != m_rows.end() )
+				constant = row_it->second->frameConstant( m_lazy.generation );
+		}
+		return it->second.offset + it->second.scale * constant;
+	}
+
+	/* Create a new Row object for the given constraint.
+
+	The terms in the constraint will be converted to cells in the row.
+	Any term in the constraint with a coefficient of zero is ignored.
+	This method uses the `getVarInfo` method to get the symbol for
+	the variables added to the row. If the symbol for a given cell
 	variable is basic, the cell variable will be substituted with the
-	basic row.
+	basic row. A presolved variable enters as its scaled symbol with
+	the offset added to the constant, and a fixed variable contributes
+	only the constant.
+
+	The necessary slack and error variables will be added to the row.
+	If the constant for the row is negative, the sign for the row
+	will be inverted so the constant becomes positive.
+
+	The row uses `constant` in place of the constraint constant and the
+	terms from `constraintTerms`, so a constant or coefficient changed
+	in the solver survives re-insertion. The tag
+	will be updated with the marker and error symbols to use for
+	tracking the movement of the constraint in the tableau.
+
+	*/
+	std::unique_ptr<Row> createRow( const Constraint& constraint, Tag& tag, double constant )
+	{
+		std::unique_ptr<Row> row( new Row( constant ) );
+		tag.strength = constraint.strength();
+		tag.constant = constant;
+
+		// Substitute the current basic variables into the row.
+		for (const auto &term : constraintTerms( constraint ))
+		{
+			if( !nearZero( term.coefficient() ) )
+			{
+				const VarInfo& info( getVarInfo( term.variable() ) );
+				Symbol symbol( info.symbol );
+				row->add( term.coefficient() * info.offset );
+				if( symbol.type() == Symbol::Invalid )
+					continue;
+				double coeff = term.coefficient() * info.scale;
+				auto row_it = m_rows.find( symbol );
+				if( row_it != m_rows.end() )
+					row->insert( *row_it->second, coeff );
+				else
+					row->insert( symbol, coeff );
+			}
+		}
+
+		// Add the necessary slack, error, and dummy variables.
+		switch( constraint.op() )
+		{
+			case OP_LE:
+			case OP_GE:
+			{
+				double coeff = constraint.op() == OP_LE ? 1.0 : -1.0;
+				Symbol slack( Symbol::Slack, m_id_tick++ );
+				tag.marker = slack;
+				row->insert( slack, coeff );
+				if( constraint.strength() < strength::required )
+				{
+					Symbol error( Symbol::Error, m_id_tick++ );
+					tag.other = error;
+					row->insert( error, -coeff );
+					m_objective->insert( error, constraint.strength() );
+				}
+				break;
+			}
+			case OP_EQ:
+			{
+				if( constraint.strength() < strength::required )
+				{
+					Symbol errplus( Symbol::Error, m_id_tick++ );
+					Symbol errminus( Symbol::Error, m_id_tick++ );
+					tag.marker = errplus;
+					tag.other = errminus;
+					row->insert( errplus, -1.0 ); // v = eplus - eminus
+					row->insert( errminus, 1.0 ); // v - eplus + eminus = 0
+					m_objective->insert( errplus, constraint.strength() );
+					m_objective->insert( errminus, constraint.strength() );
+				}
+				else
+				{
+					Symbol dummy( Symbol::Dummy, m_id_tick++ );
+					tag.marker = dummy;
+					row->insert( dummy );
+				}
+				break;
+			}
+		}
+
+		// Ensure the row as a positive constant.
+		if( row->constant() < 0.0 )
+			row->reverseSign();
+
+		return row;
+	}
+
+	/* Choose the subject for solving for the row.
+
+	This method will choose the best subject for using as the solve
+	target for the row. An invalid symbol will be returned if there
+	is no valid target.
+
+	The symbols are chosen according to the following precedence:
+
+	1) The first symbol representing an external variable.
+	2) A negative slack or error tag variable.
+
+	If a subject cannot be found, an invalid symbol will be returned.
+
+	*/
+	Symbol chooseSubject( const Row& row, const Tag& tag ) const
+	{
+		for (const auto &cellPair : row.cells())
+		{
+			if( cellPair.first.type() == Symbol::External )
+				return cellPair.first;
+		}
+		if( tag.marker.type() == Symbol::Slack || tag.marker.type() == Symbol::Error )
+		{
+			if( row.coefficientFor( tag.marker ) < 0.0 )
+				return tag.marker;
+		}
+		if( tag.other.type() == Symbol::Slack || tag.other.type() == Symbol::Error )
+		{
+			if( row.coefficientFor( tag.other ) < 0.0 )
+				return tag.other;
+		}
+		return Symbol();
+	}
+
+ 	/* Add the row to the tableau using an artificial variable.
+
+	This will return false if the constraint cannot be satisfied. The
+	tableau is then returned to the basis it had before the call.
+
+ 	*/
+ 	bool addWithArtificialVariable( const Row& row )
+ 	{
+		// Remember the basis so that a failed insertion can be undone.
+		std::vector<Symbol> basis;
+		basis.reserve( m_rows.size() );
+		for( const auto& rowPair : m_rows )
+			basis.push_back( rowPair.first );
+
+		// Create and add the artificial variable to the tableau
+		Symbol art( Symbol::Slack, m_id_tick++ );
+		saveFrameBasis( art );
+		m_rows[ art ] = new Row( row );
+		m_artificial.reset( new Row( row ) );
+		basis.push_back( art );
+
+		// Optimize the artificial objective. This is successful
+		// only if the artificial objective is optimized to zero.
+		optimize( *m_artificial );
+		bool success = nearZero( m_artificial->constant() );
+		m_artificial.reset();
+
+		// The artificial variable is basic if the objective could not
+		// be zeroed. Pivoting back to the old basis (which includes it)
+		// and dropping its row restores the tableau without the new
+		// constraint.
+		if( !success )
+		{
+			restoreBasis( basis );
+			auto it = m_rows.find( art );
+			if( it == m_rows.end() )
+				throw InternalSolverError( "artificial variable is not basic" );
+			delete it->second;
+			m_rows.erase( it );
+			return false;
+		}
+
+		// If the artificial variable is not basic, pivot the row so that
+		// it becomes basic. If the row is constant, exit early.
+		auto it = m_rows.find( art );
+		if( it != m_rows.end() )
+		{
+			std::unique_ptr<Row> rowptr( it->second );
+			m_rows.erase( it );
+			if( rowptr->cells().empty() )
+				return success;
+			Symbol entering( anyPivotableSymbol( *rowptr ) );
+			if( entering.type() == Symbol::Invalid )
+				return false;  // unsatisfiable (will this ever happen?)
+			rowptr->solveFor( art, entering );
+			substitute( entering, *rowptr );
+			saveFrameBasis( entering );
+			m_rows[ entering ] = rowptr.release();
+		}
+
+		// Remove the artificial variable from the tableau.
+		for (auto &rowPair : m_rows)
+			rowPair.second->remove(art);
+
+		m_objective->remove( art );
+		return success;
+ 	}
+
+	/* Pivot the tableau back to a previous basis.
+
+	`basis` holds the sorted basic symbols of a basis the tableau had
+	before. Each of them that is no longer basic replaces a symbol
+	that was not basic then, picking the largest coefficient.
+
+	*/
+	void restoreBasis( const std::vector<Symbol>& basis )
+	{
+		auto wasBasic = [&basis]( const Symbol& symbol ) {
+			return std::binary_search( basis.begin(), basis.end(), symbol );
+		};
+		for( const auto& entering : basis )
+		{
+			if( m_rows.find( entering ) != m_rows.end() )
+				continue;
+			auto found = m_rows.end();
+			double largest = 0.0;
+			for( auto it = m_rows.begin(); it != m_rows.end(); ++it )
+			{
+				double c = std::fabs( it->second->coefficientFor( entering ) );
+				if( c > largest && !wasBasic( it->first ) )
+				{
+					largest = c;
+					found = it;
+				}
+			}
+			if( found == m_rows.end() || nearZero( largest ) )
+				throw InternalSolverError( "failed to restore basis" );
+			Symbol leaving( found->first );
+			Row* row = found->second;
+			saveFrameBasis( leaving );
+			m_rows.erase( found );
+			row->solveFor( leaving, entering );
+			substitute( entering, *row );
+			saveFrameBasis( entering );
+			m_rows[ entering ] = row;
+		}
+	}
+
+	/* Substitute the parametric symbol with the given row.
+
+	This method will substitute all instances of the parametric symbol
+	in the tableau and the objective function with the given row.
+
+	*/
+	void substitute( const Symbol& symbol, const Row& row )
+	{
+		const std::uint32_t* frame = m_lazy_enabled ? &m_lazy.generation : nullptr;
+		if( parallelRows() )
+		{
+			m_range_rows.resize( m_pool->size() );
+			forRowRanges( [&]( std::size_t i, RowMap::iterator begin, RowMap::iterator end ) {
+				m_range_rows[ i ].clear();
+				substituteRange( symbol, row, begin, end, m_range_rows[ i ], frame );
+			} );
+			for( const auto& infeasible : m_range_rows )
+				m_infeasible_rows.insert( m_infeasible_rows.end(), infeasible.begin(), infeasible.end() );
+		}
+		else
+			substituteRange( symbol, row, m_rows.begin(), m_rows.end(), m_infeasible_rows, frame );
+		m_objective->substitute( symbol, row );
+		if( m_artificial.get() )
+			m_artificial->substitute( symbol, row );
+	}
+
+	/* Optimize the system for the given objective function.
+
+	This method performs iterations of Phase 2 of the simplex method
+	until the objective function reaches a minimum.
+
+	Throws
+	------
+	InternalSolverError
+		The value of the objective function is unbounded.
+
+	*/
+	void optimize( const Row& objective )
+	{
+		Symbol entering;
+		RowMap::iterator it;
+		while( findPrimalPivot( objective, entering, it ) )
+			pivot( it, entering );
+	}
+
+	/* Find the next pivot of the primal simplex method.
+
+	Returns false once the objective function is optimal.
+
+	Throws
+	------
+	InternalSolverError
+		The value of the objective function is unbounded.
+
+	*/
+	bool findPrimalPivot( const Row& objective, Symbol& entering, RowMap::iterator& it )
+	{
+		entering = getEnteringSymbol( objective );
+		if( entering.type() == Symbol::Invalid )
+			return false;
+		it = getLeavingRow( entering );
+		if( it == m_rows.end() )
+			throw InternalSolverError( "The objective is unbounded." );
+		return true;
+	}
+
+	/* Pivot the entering symbol into the basis in place of the basic
+	symbol of the given row.
+
+	*/
+	void pivot( RowMap::iterator it, const Symbol& entering )
+	{
+		Symbol leaving( it->first );
+		Row* row = it->second;
+		saveFrameBasis( leaving );
+		m_rows.erase( it );
+		row->solveFor( leaving, entering );
+		substitute( entering, *row );
+		saveFrameBasis( entering );
+		m_rows[ entering ] = row;
+	}
+
+	/* Optimize the system using the dual of the simplex method.
+
+	The current state of the system should be such that the objective
+	function is optimal, but not feasible. This method will perform
+	an iteration of the dual simplex method to make the solution both
+	optimal and feasible.
+
+	Throws
+	------
+	InternalSolverError
+		The system cannot be dual optimized.
+
+	*/
+	void dualOptimize()
+	{
+		if( !tryDualOptimize() )
+			throw InternalSolverError( "Dual optimize failed." );
+	}
+
+	/* Optimize the system using the dual simplex method.
+
+	Returns false if an infeasible row has no entering symbol, which
+	means the constraints cannot be satisfied. The pivots made until
+	then are kept and the tableau stays consistent.
+
+	A pivot on a symbol with no cost in the objective leaves it
+	unchanged, and a run of them can cycle between the same bases.
+	Once such a run is longer than the tableau, the leaving row is
+	chosen by Bland's rule, which cannot cycle.
+
+	*/
+	bool tryDualOptimize()
+	{
+		std::size_t degenerate = 0;
+		Symbol entering;
+		RowMap::iterator it;
+		DualPivot found;
+		while( ( found = findDualPivot( degenerate, entering, it ) ) == DualPivot::Found )
+			pivot( it, entering );
+		return found == DualPivot::Done;
+	}
+
+	enum class DualPivot
+	{
+		Found,
+		Done,
+		Failed
+	};
+
+	/* Find the next pivot of the dual simplex method.
+
+	The leaving row is taken off the infeasible rows. `degenerate`
+	counts the run of pivots on symbols with no cost in the objective.
+	Returns DualPivot::Done once no infeasible row is left and
+	DualPivot::Failed if an infeasible row has no entering symbol.
+
+	*/
+	DualPivot findDualPivot( std::size_t& degenerate, Symbol& entering, RowMap::iterator& it )
+	{
+		while( !m_infeasible_rows.empty() )
+		{
+			if( degenerate > m_rows.size() && !queueLowestInfeasibleRow() )
+				break;
+			Symbol leaving( m_infeasible_rows.back() );
+			m_infeasible_rows.pop_back();
+			it = m_rows.find( leaving );
+			if( it != m_rows.end() && !nearZero( it->second->constant() ) &&
+				it->second->constant() < 0.0 )
+			{
+				entering = getDualEnteringSymbol( *it->second );
+				if( entering.type() == Symbol::Invalid )
+					return DualPivot::Failed;
+				if( m_objective->coefficientFor( entering ) == 0.0 )
+					++degenerate;
+				else
+					degenerate = 0;
+				return DualPivot::Found;
+			}
+		}
+		return DualPivot::Done;
+	}
+
+	/* Optimize the objective after a structural update, or leave it to
+	optimizeFor() while optimization is deferred.
+
+	*/
+	void reoptimize()
+	{
+		if( m_deferred_enabled )
+			m_pending_primal = true;
+		else
+			optimize( *m_objective );
+	}
+
+	/* Dual optimize after a suggested value, or leave it to
+	optimizeFor() while optimization is deferred.
+
+	*/
+	void dualReoptimize()
+	{
+		if( !m_deferred_enabled )
+			dualOptimize();
+		else if( !m_pending_dual )
+		{
+			m_pending_dual = true;
+			m_dual_degenerate = 0;
+		}
+	}
+
+	/* Finish a deferred dual optimization before an update which needs
+	a feasible tableau.
+
+	*/
+	void finishDual()
+	{
+		if( !m_pending_dual )
+			return;
+		m_pending_dual = false;
+		dualOptimize();
+	}
+
+	/* Finish a deferred primal optimization before an update which
+	needs an optimal objective.
+
+	*/
+	void finishPrimal()
+	{
+		if( !m_pending_primal )
+			return;
+		m_pending_primal = false;
+		optimize( *m_objective );
+	}
+
+	/* Make the pivots of deferred optimization while `allow()` agrees
+	to each of them. Returns true once nothing is left to do.
+
+	*/
+	template<typename Allow>
+	bool optimizeWhile( Allow&& allow )
+	{
+		Symbol entering;
+		RowMap::iterator it;
+		while( m_pending_dual )
+		{
+			DualPivot found = findDualPivot( m_dual_degenerate, entering, it );
+			if( found == DualPivot::Failed )
+			{
+				m_pending_dual = false;
+				throw InternalSolverError( "Dual optimize failed." );
+			}
+			if( found == DualPivot::Done )
+			{
+				m_pending_dual = false;
+				break;
+			}
+			if( !allow() )
+			{
+				m_infeasible_rows.push_back( it->first );
+				return false;
+			}
+			pivot( it, entering );
+		}
+		while( m_pending_primal )
+		{
+			if( !findPrimalPivot( *m_objective, entering, it ) )
+			{
+				m_pending_primal = false;
+				break;
+			}
+			if( !allow() )
+				return false;
+			pivot( it, entering );
+		}
+		return true;
+	}
+
+	/* Move the infeasible row with the lowest symbol id to the back
+	of the queue.
+
+	Entries for rows which became feasible are dropped on the way.
+	Returns false if no infeasible row is left.
+
+	*/
+	bool queueLowestInfeasibleRow()
+	{
+		const std::size_t none = std::size_t( -1 );
+		std::size_t lowest = none;
+		for( std::size_t i = m_infeasible_rows.size(); i-- > 0; )
+		{
+			auto it = m_rows.find( m_infeasible_rows[ i ] );
+			if( it == m_rows.end() || nearZero( it->second->constant() ) ||
+				it->second->constant() > 0.0 )
+			{
+				std::size_t last = m_infeasible_rows.size() - 1;
+				m_infeasible_rows[ i ] = m_infeasible_rows[ last ];
+				m_infeasible_rows.pop_back();
+				if( lowest == last )
+					lowest = i;
+			}
+			else if( lowest == none || m_infeasible_rows[ i ] < m_infeasible_rows[ lowest ] )
+				lowest = i;
+		}
+		if( lowest == none )
+			return false;
+		std::swap( m_infeasible_rows[ lowest ], m_infeasible_rows.back() );
+		return true;
+	}
+
+	/* Compute the entering variable for a pivot operation.
+
+	This method will return first symbol in the objective function which
+	is non-dummy and has a coefficient less than zero. If no symbol meets
+	the criteria, it means the objective function is at a minimum, and an
+	invalid symbol is returned.
+
+	Once a constraint has been disabled, a coefficient counts as negative
+	only below a tolerance relative to the largest one. Taking weights out
+	of the objective and putting them back leaves a residue of that order
+	on costs which are zero. Otherwise any negative coefficient counts.
+
+	*/
+	Symbol getEnteringSymbol( const Row& objective ) const
+	{
+		double tolerance = 0.0;
+		if( m_toggled )
+		{
+			for( const auto& cellPair : objective.cells() )
+				tolerance = std::max( tolerance, std::fabs( cellPair.second ) );
+			tolerance *= 1.0e-12;
+		}
+		for (const auto &cellPair : objective.cells())
+		{
+			if( cellPair.first.type() != Symbol::Dummy && cellPair.second < -tolerance )
+				return cellPair.first;
+		}
+		return Symbol();
+	}
+
+	/* Compute the entering symbol for the dual optimize operation.
+
+	This method will return the symbol in the row which has a positive
+	coefficient and yields the minimum ratio for its respective symbol
+	in the objective function. The provided row *must* be infeasible.
+	If no symbol is found which meats the criteria, an invalid symbol
+	is returned.
+
+	*/
+	Symbol getDualEnteringSymbol( const Row& row ) const
+	{
+		Symbol entering;
+		double ratio = std::numeric_limits<double>::max();
+		for (const auto &cellPair : row.cells())
+		{
+			if( cellPair.second > 0.0 && cellPair.first.type() != Symbol::Dummy )
+			{
+				double coeff = m_objective->coefficientFor( cellPair.first );
+				double r = coeff / cellPair.second;
+				if( r < ratio )
+				{
+					ratio = r;
+					entering = cellPair.first;
+				}
+			}
+		}
+		return entering;
+	}
+
+	/* Get the first Slack or Error symbol in the row.
+
+	If no such symbol is present, and Invalid symbol will be returned.
+
+	*/
+	Symbol anyPivotableSymbol( const Row& row ) const
+	{
+		for (const auto &cellPair : row.cells())
+		{
+			const Symbol& sym( cellPair.first );
+			if( sym.type() == Symbol::Slack || sym.type() == Symbol::Error )
+				return sym;
+		}
+		return Symbol();
+	}
 
-	The necessary slack and error variables will be added to the row.
-	If the constant for the row is negative, the sign for the row
-	will be inverted so the constant becomes positive.
+	/* Compute the row which holds the exit symbol for a pivot.
 
-	The tag will be updated with the marker and error symbols to use
-	for tracking the movement of the constraint in the tableau.
+	This method will return an iterator to the row in the row map
+	which holds the exit symbol. If no appropriate exit symbol is
+	found, the end() iterator will be returned. This indicates that
+	the objective function is unbounded.
 
 	*/
-	std::unique_ptr<Row> createRow( const Constraint& constraint, Tag& tag )
+	RowMap::iterator getLeavingRow( const Symbol& entering )
 	{
-		const Expression& expr( constraint.expression() );
-		std::unique_ptr<Row> row( new Row( expr.constant() ) );
+		if( !parallelRows() )
+			return leavingRowIn( entering, m_rows.begin(), m_rows.end() ).row;
+		std::vector<LeavingRow> found( m_pool->size() );
+		forRowRanges( [&]( std::size_t i, RowMap::iterator begin, RowMap::iterator end ) {
+			found[ i ] = leavingRowIn( entering, begin, end );
+		} );
+		// Ties go to the earliest range, as they go to the earliest row.
+		LeavingRow best{ m_rows.end(), std::numeric_limits<double>::max() };
+		for( const auto& leaving : found )
+		{
+			if( leaving.row != m_rows.end() && leaving.ratio < best.ratio )
+				best = leaving;
+		}
+		return best.row;
+	}
 
-		// Substitute the current basic variables into the row.
-		for (const auto &term : expr.terms())
+	/* Compute the leaving row for a marker variable.
+
+	This method will return an iterator to the row in the row map
+	which holds the given marker variable. The row will be chosen
+	according to the following precedence:
+
+	0) A row with a dummy basic variable. Such a row is what is left of
+	   a redundant required equality, and pivoting the marker into it
+	   leaves the other rows untouched apart from the renamed marker.
+
+	1) The row with a restricted basic varible and a negative coefficient
+	   for the marker with the smallest ratio of -constant / coefficient.
+
+	2) The row with a restricted basic variable and the smallest ratio
+	   of constant / coefficient.
+
+	3) The last unrestricted row which contains the marker.
+
+	If the marker does not exist in any row, the row map end() iterator
+	will be returned. This indicates an internal solver error since
+	the marker *should* exist somewhere in the tableau.
+
+	*/
+	RowMap::iterator getMarkerLeavingRow( const Symbol& marker )
+	{
+		auto end = m_rows.end();
+		MarkerLeavingRow best{ end, end, end, end,
+			std::numeric_limits<double>::max(), std::numeric_limits<double>::max() };
+		if( !parallelRows() )
+			markerLeavingRowIn( marker, m_rows.begin(), end, best );
+		else
 		{
-			if( !nearZero( term.coefficient() ) )
+			std::vector<MarkerLeavingRow> found( m_pool->size(), best );
+			forRowRanges( [&]( std::size_t i, RowMap::iterator begin, RowMap::iterator stop ) {
+				markerLeavingRowIn( marker, begin, stop, found[ i ] );
+			} );
+			// Merge in row order: the first dummy row, the first of the
+			// smallest ratios and the last unrestricted row.
+			for( const auto& leaving : found )
 			{
-				Symbol symbol( getVarSymbol( term.variable() ) );
-				auto row_it = m_rows.find( symbol );
-				if( row_it != m_rows.end() )
-					row->insert( *row_it->second, term.coefficient() );
-				else
-					row->insert( symbol, term.coefficient() );
+				if( leaving.dummy != end )
+					return leaving.dummy;
+				if( leaving.first != end && leaving.r1 < best.r1 )
+				{
+					best.r1 = leaving.r1;
+					best.first = leaving.first;
+				}
+				if( leaving.second != end && leaving.r2 < best.r2 )
+				{
+					best.r2 = leaving.r2;
+					best.second = leaving.second;
+				}
+				if( leaving.third != end )
+					best.third = leaving.third;
 			}
 		}
+		if( best.dummy != end )
+			return best.dummy;
+		if( best.first != end )
+			return best.first;
+		if( best.second != end )
+			return best.second;
+		return best.third;
+	}
 
-		// Add the necessary slack, error, and dummy variables.
-		switch( constraint.op() )
+	/* The leaving row candidates of a range of rows.
+
+	*/
+	struct LeavingRow
+	{
+		RowMap::iterator row;
+		double ratio;
+	};
+
+	struct MarkerLeavingRow
+	{
+		RowMap::iterator dummy;
+		RowMap::iterator first;
+		RowMap::iterator second;
+		RowMap::iterator third;
+		double r1;
+		double r2;
+	};
+
+	/* Whether the row loops of a pivot are split across the pool.
+
+	*/
+	bool parallelRows() const
+	{
+		return m_pool && m_rows.size() >= m_parallel_rows;
+	}
+
+	/* Call fn( i, begin, end ) for one contiguous range of rows per
+	thread of the pool, on the pool.
+
+	*/
+	template<typename F>
+	void forRowRanges( const F& fn )
+	{
+		const std::size_t count = m_pool->size();
+		const std::size_t size = m_rows.size();
+		auto rows = m_rows.begin();
+		m_pool->run( count, [&]( std::size_t i ) {
+			fn( i, rows + size * i / count, rows + size * ( i + 1 ) / count );
+		} );
+	}
+
+	/* Substitute the parametric symbol in a range of rows and collect
+	the rows which become infeasible. With `frame` set, each row saves
+	its constant for that lazy generation first.
+
+	*/
+	static void substituteRange( const Symbol& symbol, const Row& row,
+		RowMap::iterator begin, RowMap::iterator end, std::vector<Symbol>& infeasible,
+		const std::uint32_t* frame )
+	{
+		for( auto it = begin; it != end; ++it )
 		{
-			case OP_LE:
-			case OP_GE:
+			if( frame )
+				it->second->saveFrame( *frame );
+			it->second->substitute( symbol, row );
+			if( it->first.type() != Symbol::External &&
+				it->second->constant() < 0.0 )
+				infeasible.push_back( it->first );
+		}
+	}
+
+	/* Find the row with the smallest ratio for the entering symbol in a
+	range of rows. The row is `m_rows.end()` if there is none.
+
+	*/
+	LeavingRow leavingRowIn( const Symbol& entering, RowMap::iterator begin, RowMap::iterator end )
+	{
+		LeavingRow found{ m_rows.end(), std::numeric_limits<double>::max() };
+		for( auto it = begin; it != end; ++it )
+		{
+			if( it->first.type() != Symbol::External )
 			{
-				double coeff = constraint.op() == OP_LE ? 1.0 : -1.0;
-				Symbol slack( Symbol::Slack, m_id_tick++ );
-				tag.marker = slack;
-				row->insert( slack, coeff );
-				if( constraint.strength() < strength::required )
+				double temp = it->second->coefficientFor( entering );
+				if( temp < 0.0 )
 				{
-					Symbol error( Symbol::Error, m_id_tick++ );
-					tag.other = error;
-					row->insert( error, -coeff );
-					m_objective->insert( error, constraint.strength() );
+					double temp_ratio = -it->second->constant() / temp;
+					if( temp_ratio < found.ratio )
+					{
+						found.ratio = temp_ratio;
+						found.row = it;
+					}
 				}
-				break;
 			}
-			case OP_EQ:
+		}
+		return found;
+	}
+
+	/* Collect the leaving row candidates for a marker in a range of rows,
+	stopping at the first dummy row.
+
+	*/
+	static void markerLeavingRowIn( const Symbol& marker, RowMap::iterator begin,
+		RowMap::iterator end, MarkerLeavingRow& found )
+	{
+		for( auto it = begin; it != end; ++it )
+		{
+			double c = it->second->coefficientFor( marker );
+			if( c == 0.0 )
+				continue;
+			if( it->first.type() == Symbol::Dummy )
 			{
-				if( constraint.strength() < strength::required )
+				found.dummy = it;
+				return;
+			}
+			if( it->first.type() == Symbol::External )
+			{
+				found.third = it;
+			}
+			else if( c < 0.0 )
+			{
+				double r = -it->second->constant() / c;
+				if( r < found.r1 )
 				{
-					Symbol errplus( Symbol::Error, m_id_tick++ );
-					Symbol errminus( Symbol::Error, m_id_tick++ );
-					tag.marker = errplus;
-					tag.other = errminus;
-					row->insert( errplus, -1.0 ); // v = eplus - eminus
-					row->insert( errminus, 1.0 ); // v - eplus + eminus = 0
-					m_objective->insert( errplus, constraint.strength() );
-					m_objective->insert( errminus, constraint.strength() );
+					found.r1 = r;
+					found.first = it;
 				}
-				else
+			}
+			else
+			{
+				double r = it->second->constant() / c;
+				if( r < found.r2 )
 				{
-					Symbol dummy( Symbol::Dummy, m_id_tick++ );
-					tag.marker = dummy;
-					row->insert( dummy );
+					found.r2 = r;
+					found.second = it;
 				}
-				break;
 			}
 		}
+	}
 
-		// Ensure the row as a positive constant.
-		if( row->constant() < 0.0 )
-			row->reverseSign();
+	/* Insert the row for a constraint into the tableau.
 
-		return row;
+	The symbols of the new row are stored in `tag`. The constraint map
+	is not modified.
+
+	*/
+	SolverStatus insertConstraint( const Constraint& constraint, Tag& tag, double constant )
+	{
+		// Creating a row causes symbols to be reserved for the variables
+		// in the constraint. If this method fails, then its possible
+		// those variables will linger in the var map.
+		// Since its likely that those variables will be used in other
+		// constraints and since exceptional conditions are uncommon,
+		// i'm not too worried about aggressive cleanup of the var map.
+		std::unique_ptr<Row> rowptr( createRow( constraint, tag, constant ) );
+		Symbol subject( chooseSubject( *rowptr, tag ) );
+
+		// If chooseSubject could not find a valid entering symbol, one
+		// last option is available if the entire row is composed of
+		// dummy variables. If the constant of the row is zero, then
+		// this represents redundant constraints and the new dummy
+		// marker can enter the basis. If the constant is non-zero,
+		// then it represents an unsatisfiable constraint.
+		if( subject.type() == Symbol::Invalid && allDummies( *rowptr ) )
+		{
+			if( !nearZero( rowptr->constant() ) )
+				return SolverStatus::UnsatisfiableConstraint;
+			else
+				subject = tag.marker;
+		}
+
+		// If an entering symbol still isn't found, then the row must
+		// be added using an artificial variable. If that fails, then
+		// the row represents an unsatisfiable constraint.
+		if( subject.type() == Symbol::Invalid )
+		{
+			if( !addWithArtificialVariable( *rowptr ) )
+				return SolverStatus::UnsatisfiableConstraint;
+		}
+		else
+		{
+			rowptr->solveFor( subject );
+			substitute( subject, *rowptr );
+			saveFrameBasis( subject );
+			m_rows[ subject ] = rowptr.release();
+		}
+
+		// Optimizing after each constraint is added performs less
+		// aggregate work due to a smaller average system size. It
+		// also ensures the solver remains in a consistent state.
+		reoptimize();
+		return SolverStatus::Ok;
 	}
 
-	/* Choose the subject for solving for the row.
+	/* Remove a constraint from the tableau.
 
-	This method will choose the best subject for using as the solve
-	target for the row. An invalid symbol will be returned if there
-	is no valid target.
+	The constraint map is not modified.
 
-	The symbols are chosen according to the following precedence:
+	*/
+	void dropConstraint( const Tag& tag )
+	{
+		// Remove the error effects from the objective function
+		// *before* pivoting, or substitutions into the objective
+		// will lead to incorrect solver results. A disabled soft
+		// constraint has already had its effects removed.
+		if( !tag.disabled )
+			removeConstraintEffects( tag );
+		dropConstraintRow( tag );
+	}
 
-	1) The first symbol representing an external variable.
-	2) A negative slack or error tag variable.
+	/* Insert a constraint dropped with `dropConstraint` again.
 
-	If a subject cannot be found, an invalid symbol will be returned.
+	The new row keeps the constant, strength and enabled state the
+	constraint has in the solver. On failure the constraint has no
+	row in the tableau.
 
 	*/
-	Symbol chooseSubject( const Row& row, const Tag& tag ) const
+	SolverStatus reinsertConstraint( const Constraint& constraint, Tag& tag )
 	{
-		for (const auto &cellPair : row.cells())
+		Tag inserted;
+		SolverStatus status = insertConstraint( constraint, inserted, tag.constant );
+		if( status != SolverStatus::Ok )
+			return status;
+		double weight = tag.disabled ? 0.0 : tag.strength;
+		if( weight != inserted.strength )
 		{
-			if( cellPair.first.type() == Symbol::External )
-				return cellPair.first;
+			shiftConstraintEffects( inserted, weight - inserted.strength );
+			reoptimize();
 		}
-		if( tag.marker.type() == Symbol::Slack || tag.marker.type() == Symbol::Error )
+		inserted.strength = tag.strength;
+		inserted.disabled = tag.disabled;
+		tag = inserted;
+		return SolverStatus::Ok;
+	}
+
+	/* Remove the row of a constraint from the tableau.
+
+	The effects of the constraint on the objective must already have
+	been removed.
+
+	*/
+	void dropConstraintRow( const Tag& tag )
+	{
+		// If the marker is basic, simply drop the row. Otherwise,
+		// pivot the marker into the basis and then drop the row.
+		auto row_it = m_rows.find( tag.marker );
+		if( row_it != m_rows.end() )
 		{
-			if( row.coefficientFor( tag.marker ) < 0.0 )
-				return tag.marker;
+			saveFrameBasis( tag.marker );
+			std::unique_ptr<Row> rowptr( row_it->second );
+			m_rows.erase( row_it );
 		}
-		if( tag.other.type() == Symbol::Slack || tag.other.type() == Symbol::Error )
+		else
 		{
-			if( row.coefficientFor( tag.other ) < 0.0 )
-				return tag.other;
+			row_it = getMarkerLeavingRow( tag.marker );
+			if( row_it == m_rows.end() )
+				throw InternalSolverError( "failed to find leaving row" );
+			Symbol leaving( row_it->first );
+			saveFrameBasis( leaving );
+			std::unique_ptr<Row> rowptr( row_it->second );
+			m_rows.erase( row_it );
+			rowptr->solveFor( leaving, tag.marker );
+			substitute( tag.marker, *rowptr );
+			// A marker found in unrestricted rows only has no cost, so
+			// anything the substitution left on the variable leaving the
+			// basis is rounding residue from toggled weights. Nothing
+			// bounds a free variable in the objective.
+			if( m_toggled && leaving.type() == Symbol::External )
+				m_objective->remove( leaving );
 		}
-		return Symbol();
 	}
 
- 	/* Add the row to the tableau using an artificial variable.
+	/* Remove the effects of a constraint on the objective function.
+
+	*/
+	void removeConstraintEffects( const Tag& tag )
+	{
+		if( tag.marker.type() == Symbol::Error )
+			removeMarkerEffects( tag.marker, tag.strength );
+		if( tag.other.type() == Symbol::Error )
+			removeMarkerEffects( tag.other, tag.strength );
+	}
+
+	/* Remove the effects of an error marker on the objective function.
+
+	*/
+	void removeMarkerEffects( const Symbol& marker, double strength )
+	{
+		auto row_it = m_rows.find( marker );
+		if( row_it != m_rows.end() )
+			m_objective->insert( *row_it->second, -strength );
+		else
+			m_objective->insert( marker, -strength );
+	}
+
+	/* Set the weight of the error markers of a constraint in the objective.
+
+	*/
+	SolverStatus updateStrength( Tag& tag, double strength )
+	{
+		strength = strength::clip( strength );
+		if( tag.strength >= strength::required || strength >= strength::required )
+			return SolverStatus::BadRequiredStrength;
+		if( strength == tag.strength )
+			return SolverStatus::Ok;
+		double delta = strength - tag.strength;
+		tag.strength = strength;
+		if( tag.disabled )
+			return SolverStatus::Ok;
+		shiftConstraintEffects( tag, delta );
+		reoptimize();
+		return SolverStatus::Ok;
+	}
+
+	/* Add a weight to the error markers of a constraint in the objective.
 
-	This will return false if the constraint cannot be satisfied.
+	A negative weight removes it.
 
- 	*/
- 	bool addWithArtificialVariable( const Row& row )
- 	{
-		// Create and add the artificial variable to the tableau
-		Symbol art( Symbol::Slack, m_id_tick++ );
-		m_rows[ art ] = new Row( row );
-		m_artificial.reset( new Row( row ) );
+	*/
+	void shiftConstraintEffects( const Tag& tag, double weight )
+	{
+		if( tag.marker.type() == Symbol::Error )
+			removeMarkerEffects( tag.marker, -weight );
+		if( tag.other.type() == Symbol::Error )
+			removeMarkerEffects( tag.other, -weight );
+	}
 
-		// Optimize the artificial objective. This is successful
-		// only if the artificial objective is optimized to zero.
-		optimize( *m_artificial );
-		bool success = nearZero( m_artificial->constant() );
-		m_artificial.reset();
+	/* Drop the rounding residue of the error markers of a constraint
+	whose whole weight was just taken out of the objective.
 
-		// If the artificial variable is not basic, pivot the row so that
-		// it becomes basic. If the row is constant, exit early.
-		auto it = m_rows.find( art );
-		if( it != m_rows.end() )
+	The weight comes out through rows which were scaled by the pivots
+	made since it went in, so the cost of a nonbasic marker can be left
+	a little below zero instead of cancelling. A real negative cost has
+	a leaving row, since the other error variables bound the objective.
+	A tiny one without a leaving row is residue, and would make the next
+	primal optimization report an unbounded objective.
+
+	*/
+	void clearMarkerResidue( const Tag& tag, double weight )
+	{
+		for( const Symbol& marker : { tag.marker, tag.other } )
 		{
-			std::unique_ptr<Row> rowptr( it->second );
-			m_rows.erase( it );
-			if( rowptr->cells().empty() )
-				return success;
-			Symbol entering( anyPivotableSymbol( *rowptr ) );
-			if( entering.type() == Symbol::Invalid )
-				return false;  // unsatisfiable (will this ever happen?)
-			rowptr->solveFor( art, entering );
-			substitute( entering, *rowptr );
-			m_rows[ entering ] = rowptr.release();
+			if( marker.type() != Symbol::Error || m_rows.find( marker ) != m_rows.end() )
+				continue;
+			double coeff = m_objective->coefficientFor( marker );
+			if( coeff < 0.0 && -coeff < weight * 1.0e-6 && getLeavingRow( marker ) == m_rows.end() )
+				m_objective->remove( marker );
 		}
+	}
 
-		// Remove the artificial variable from the tableau.
-		for (auto &rowPair : m_rows)
-			rowPair.second->remove(art);
-
-		m_objective->remove( art );
-		return success;
- 	}
-
-	/* Substitute the parametric symbol with the given row.
+	/* Shift the constant of a constraint row by `delta`.
 
-	This method will substitute all instances of the parametric symbol
-	in the tableau and the objective function with the given row.
+	The marker enters the original row with a coefficient of +1 for a
+	<= slack or a required == dummy, and -1 otherwise. Substituting
+	marker - delta / coeff for the marker absorbs the change, so only
+	the constants of the rows holding the marker (or its error pair)
+	move. Rows that become infeasible are queued for dual optimization.
 
 	*/
-	void substitute( const Symbol& symbol, const Row& row )
+	void shiftConstant( const Constraint& constraint, const Tag& tag, double delta )
 	{
-		for( auto& rowPair : m_rows )
+		if( delta == 0.0 )
+			return;
+		double coeff = -1.0;
+		if( tag.marker.type() == Symbol::Dummy ||
+			( tag.marker.type() == Symbol::Slack && constraint.op() == OP_LE ) )
+			coeff = 1.0;
+		double shift = delta / coeff;
+
+		auto row_it = m_rows.find( tag.marker );
+		if( row_it != m_rows.end() )
 		{
-			rowPair.second->substitute( symbol, row );
-			if( rowPair.first.type() != Symbol::External &&
-				rowPair.second->constant() < 0.0 )
-				m_infeasible_rows.push_back( rowPair.first );
+			shiftRowConstant( row_it->first, *row_it->second, -shift );
+			return;
+		}
+
+		if( tag.other.type() != Symbol::Invalid )
+		{
+			row_it = m_rows.find( tag.other );
+			if( row_it != m_rows.end() )
+			{
+				shiftRowConstant( row_it->first, *row_it->second, shift );
+				return;
+			}
+		}
+
+		for( const auto& rowPair : m_rows )
+		{
+			double c = rowPair.second->coefficientFor( tag.marker );
+			if( c != 0.0 )
+				shiftRowConstant( rowPair.first, *rowPair.second, c * shift );
 		}
-		m_objective->substitute( symbol, row );
-		if( m_artificial.get() )
-			m_artificial->substitute( symbol, row );
 	}
 
-	/* Optimize the system for the given objective function.
+	void shiftRowConstant( const Symbol& basic, Row& row, double delta )
+	{
+		saveFrame( row );
+		if( row.add( delta ) < 0.0 &&
+			basic.type() != Symbol::External &&
+			basic.type() != Symbol::Dummy )
+			m_infeasible_rows.push_back( basic );
+	}
 
-	This method performs iterations of Phase 2 of the simplex method
-	until the objective function reaches a minimum.
+	/* Add `delta` times a variable to the row of a constraint.
 
-	Throws
-	------
-	InternalSolverError
-		The value of the objective function is unbounded.
+	The term added is `delta * (symbol - value)`, where `value` is
+	stored with the current value of the symbol, so the constants of
+	the tableau do not change. As with `shiftConstant` the marker
+	absorbs the change: if it is basic, its row is moved along the
+	term, otherwise the rows holding the marker are rescaled. The
+	objective is updated with the weight of a basic error marker.
+
+	Returns false without changing the tableau if the marker cannot
+	absorb the change. This is the case when the new row no longer
+	depends on a non-basic marker, when the marker is a dummy that is
+	basic or part of a redundant constraint, and when the term involves
+	a free external variable.
 
 	*/
-	void optimize( const Row& objective )
+	bool shiftCoefficient( const Constraint& constraint, const Tag& tag,
+		const Symbol& symbol, double delta, double& value )
 	{
-		while( true )
+		Row term;
+		auto sym_it = m_rows.find( symbol );
+		if( sym_it != m_rows.end() )
 		{
-			Symbol entering( getEnteringSymbol( objective ) );
-			if( entering.type() == Symbol::Invalid )
-				return;
-			auto it = getLeavingRow( entering );
-			if( it == m_rows.end() )
-				throw InternalSolverError( "The objective is unbounded." );
-			// pivot the entering symbol into the basis
-			Symbol leaving( it->first );
-			Row* row = it->second;
-			m_rows.erase( it );
-			row->solveFor( leaving, entering );
-			substitute( entering, *row );
-			m_rows[ entering ] = row;
+			value = sym_it->second->constant();
+			term.insert( *sym_it->second, delta );
+			term.add( -term.constant() );
+		}
+		else
+		{
+			value = 0.0;
+			term.insert( symbol, delta );
 		}
-	}
 
-	/* Optimize the system using the dual of the simplex method.
+		// Non-basic external variables are free parameters, which only
+		// appear in rows solved for other external variables.
+		for( const auto& cellPair : term.cells() )
+		{
+			if( cellPair.first.type() == Symbol::External )
+				return false;
+		}
 
-	The current state of the system should be such that the objective
-	function is optimal, but not feasible. This method will perform
-	an iteration of the dual simplex method to make the solution both
-	optimal and feasible.
+		double coeff = -1.0;
+		if( tag.marker.type() == Symbol::Dummy ||
+			( tag.marker.type() == Symbol::Slack && constraint.op() == OP_LE ) )
+			coeff = 1.0;
+		double weight = tag.disabled ? 0.0 : tag.strength;
 
-	Throws
-	------
-	InternalSolverError
-		The system cannot be dual optimized.
+		auto row_it = m_rows.find( tag.marker );
+		if( row_it != m_rows.end() )
+		{
+			if( tag.marker.type() == Symbol::Dummy )
+				return false;
+			row_it->second->insert( term, -1.0 / coeff );
+			if( tag.marker.type() == Symbol::Error )
+				m_objective->insert( term, -weight / coeff );
+			return true;
+		}
 
-	*/
-	void dualOptimize()
-	{
-		while( !m_infeasible_rows.empty() )
+		if( tag.other.type() != Symbol::Invalid )
 		{
+			row_it = m_rows.find( tag.other );
+			if( row_it != m_rows.end() )
+			{
+				row_it->second->insert( term, 1.0 / coeff );
+				m_objective->insert( term, weight / coeff );
+				return true;
+			}
+		}
 
-			Symbol leaving( m_infeasible_rows.back() );
-			m_infeasible_rows.pop_back();
-			auto it = m_rows.find( leaving );
-			if( it != m_rows.end() && !nearZero( it->second->constant() ) &&
-				it->second->constant() < 0.0 )
+		// The marker is non-basic. The old marker is expressed through
+		// the new one as `scale * marker + scale / coeff * term`, where
+		// the term excludes the marker itself.
+		double self = term.coefficientFor( tag.marker );
+		double divisor = 1.0 - self / coeff;
+		if( nearZero( divisor ) )
+			return false;
+		// A row solved for a dummy records a redundant required
+		// constraint and may only depend on other dummies.
+		if( tag.marker.type() == Symbol::Dummy )
+		{
+			for( const auto& rowPair : m_rows )
 			{
-				Symbol entering( getDualEnteringSymbol( *it->second ) );
-				if( entering.type() == Symbol::Invalid )
-					throw InternalSolverError( "Dual optimize failed." );
-				// pivot the entering symbol into the basis
-				Row* row = it->second;
-				m_rows.erase( it );
-				row->solveFor( leaving, entering );
-				substitute( entering, *row );
-				m_rows[ entering ] = row;
+				if( rowPair.first.type() == Symbol::Dummy &&
+					rowPair.second->coefficientFor( tag.marker ) != 0.0 )
+					return false;
 			}
 		}
+		double scale = 1.0 / divisor;
+		term.remove( tag.marker );
+		auto rescale = [&]( Row& row ) {
+			double c = row.coefficientFor( tag.marker );
+			if( c == 0.0 )
+				return;
+			row.remove( tag.marker );
+			row.insert( tag.marker, c * scale );
+			row.insert( term, c * scale / coeff );
+		};
+		for( auto& rowPair : m_rows )
+			rescale( *rowPair.second );
+
+		// The objective weights the new error marker, not the old one.
+		// Only the reduced cost beyond that weight is rescaled, so the
+		// two parts cannot leave round-off on unrelated symbols.
+		double own = tag.marker.type() == Symbol::Error ? weight : 0.0;
+		double c = m_objective->coefficientFor( tag.marker ) - own;
+		if( !nearZero( c ) )
+		{
+			m_objective->remove( tag.marker );
+			m_objective->insert( tag.marker, c * scale + own );
+			m_objective->insert( term, c * scale / coeff );
+		}
+		return true;
 	}
 
-	/* Compute the entering variable for a pivot operation.
+	/* Requeue every infeasible row and dual optimize.
 
-	This method will return first symbol in the objective function which
-	is non-dummy and has a coefficient less than zero. If no symbol meets
-	the criteria, it means the objective function is at a minimum, and an
-	invalid symbol is returned.
+	Used to return to a feasible tableau after a failed update has been
+	undone.
 
 	*/
-	Symbol getEnteringSymbol( const Row& objective ) const
+	void repairFeasibility()
 	{
-		for (const auto &cellPair : objective.cells())
+		m_infeasible_rows.clear();
+		for( const auto& rowPair : m_rows )
 		{
-			if( cellPair.first.type() != Symbol::Dummy && cellPair.second < 0.0 )
-				return cellPair.first;
+			if( rowPair.first.type() != Symbol::External && rowPair.second->constant() < 0.0 )
+				m_infeasible_rows.push_back( rowPair.first );
 		}
-		return Symbol();
+		dualOptimize();
 	}
 
-	/* Compute the entering symbol for the dual optimize operation.
-
-	This method will return the symbol in the row which has a positive
-	coefficient and yields the minimum ratio for its respective symbol
-	in the objective function. The provided row *must* be infeasible.
-	If no symbol is found which meats the criteria, an invalid symbol
-	is returned.
+	/* Test whether every row solved for a dummy variable has a zero
+	constant.
 
 	*/
-	Symbol getDualEnteringSymbol( const Row& row ) const
+	bool dummyRowsSatisfied() const
 	{
-		Symbol entering;
-		double ratio = std::numeric_limits<double>::max();
-		for (const auto &cellPair : row.cells())
+		for( const auto& rowPair : m_rows )
 		{
-			if( cellPair.second > 0.0 && cellPair.first.type() != Symbol::Dummy )
-			{
-				double coeff = m_objective->coefficientFor( cellPair.first );
-				double r = coeff / cellPair.second;
-				if( r < ratio )
-				{
-					ratio = r;
-					entering = cellPair.first;
-				}
-			}
+			if( rowPair.first.type() == Symbol::Dummy &&
+				!nearZero( rowPair.second->constant() ) )
+				return false;
 		}
-		return entering;
+		return true;
 	}
 
-	/* Get the first Slack or Error symbol in the row.
+	/* Find the map entry for a variable or constraint through its slot.
 
-	If no such symbol is present, and Invalid symbol will be returned.
+	The first solver to look an object up claims its slot, any other
+	keeps its hint in `hints`. A stale hint falls back to a binary
+	search and is refreshed with the position found. The hint only
+	speeds up the lookup, inserting into or erasing from `map` is
+	still linear in its size.
 
 	*/
-	Symbol anyPivotableSymbol( const Row& row ) const
+	template<typename Map, typename Data>
+	auto findSlotted( Map& map, const Data* data, SolverSlot& slot, SlotHintMap& hints )
+		-> decltype( map.begin() )
 	{
-		for (const auto &cellPair : row.cells())
+		std::size_t hint = slotHint( slot, hints );
+		auto it = searchSlotted( map, data, hint );
+		if( it == map.end() )
+			return it;
+		std::size_t index = static_cast<std::size_t>( it - map.begin() );
+		if( index == hint )
+			return it;
+		if( slot.isOwnedBy( this ) )
+			slot.setIndex( index );
+		else if( slot.claim( this ) )
 		{
-			const Symbol& sym( cellPair.first );
-			if( sym.type() == Symbol::Slack || sym.type() == Symbol::Error )
-				return sym;
+			if( !hints.empty() )
+				hints.erase( &slot );
+			slot.setIndex( index );
 		}
-		return Symbol();
+		else
+			hints[ &slot ] = index;
+		return it;
 	}
 
-	/* Compute the row which holds the exit symbol for a pivot.
+	/* Find the map entry for a variable or constraint without claiming
+	its slot or refreshing a hint.
 
-	This method will return an iterator to the row in the row map
-	which holds the exit symbol. If no appropriate exit symbol is
-	found, the end() iterator will be returned. This indicates that
-	the objective function is unbounded.
+	*/
+	template<typename Map, typename Data>
+	auto findSlotted( const Map& map, const Data* data, const SolverSlot& slot, const SlotHintMap& hints ) const
+		-> decltype( map.begin() )
+	{
+		return searchSlotted( map, data, slotHint( slot, hints ) );
+	}
+
+	/* Get the position the solver last saw an object at, or NoSlot.
 
 	*/
-	RowMap::iterator getLeavingRow( const Symbol& entering )
+	std::size_t slotHint( const SolverSlot& slot, const SlotHintMap& hints ) const
 	{
-		double ratio = std::numeric_limits<double>::max();
-		auto end = m_rows.end();
-		auto found = m_rows.end();
-		for( auto it = m_rows.begin(); it != end; ++it )
-		{
-			if( it->first.type() != Symbol::External )
-			{
-				double temp = it->second->coefficientFor( entering );
-				if( temp < 0.0 )
-				{
-					double temp_ratio = -it->second->constant() / temp;
-					if( temp_ratio < ratio )
-					{
-						ratio = temp_ratio;
-						found = it;
-					}
-				}
-			}
-		}
-		return found;
+		if( slot.isOwnedBy( this ) )
+			return slot.index();
+		if( hints.empty() )
+			return NoSlot;
+		auto hint_it = hints.find( &slot );
+		return hint_it != hints.end() ? hint_it->second : NoSlot;
 	}
 
-	/* Compute the leaving row for a marker variable.
+	/* Find the map entry for an object, trying the hinted position first.
 
-	This method will return an iterator to the row in the row map
-	which holds the given marker variable. The row will be chosen
-	according to the following precedence:
+	*/
+	template<typename Map, typename Data>
+	static auto searchSlotted( Map& map, const Data* data, std::size_t hint )
+		-> decltype( map.begin() )
+	{
+		if( hint < map.size() && map.begin()[ hint ].first.ptr() == data )
+			return map.begin() + hint;
+		auto it = std::lower_bound( map.begin(), map.end(), data,
+			[]( const typename Map::value_type& entry, const Data* d ) {
+				return std::less<const Data*>()( entry.first.ptr(), d );
+			} );
+		if( it == map.end() || it->first.ptr() != data )
+			return map.end();
+		return it;
+	}
 
-	1) The row with a restricted basic varible and a negative coefficient
-	   for the marker with the smallest ratio of -constant / coefficient.
+	CnMap::iterator findCn( const Constraint& constraint )
+	{
+		return findSlotted( m_cns, constraint.ptr(), constraint.ptr()->m_slot, m_cn_hints );
+	}
 
-	2) The row with a restricted basic variable and the smallest ratio
-	   of constant / coefficient.
+	CnMap::const_iterator findCn( const Constraint& constraint ) const
+	{
+		return findSlotted( m_cns, constraint.ptr(), constraint.ptr()->m_slot, m_cn_hints );
+	}
 
-	3) The last unrestricted row which contains the marker.
+	VarMap::iterator findVar( const Variable& variable )
+	{
+		return findSlotted( m_vars, variable.ptr(), variable.ptr()->var_slot_, m_var_hints );
+	}
 
-	If the marker does not exist in any row, the row map end() iterator
-	will be returned. This indicates an internal solver error since
-	the marker *should* exist somewhere in the tableau.
+	VarMap::const_iterator findVar( const Variable& variable ) const
+	{
+		return findSlotted( m_vars, variable.ptr(), variable.ptr()->var_slot_, m_var_hints );
+	}
 
-	*/
-	RowMap::iterator getMarkerLeavingRow( const Symbol& marker )
+	EditMap::iterator findEdit( const Variable& variable )
 	{
-		const double dmax = std::numeric_limits<double>::max();
-		double r1 = dmax;
-		double r2 = dmax;
-		auto end = m_rows.end();
-		auto first = end;
-		auto second = end;
-		auto third = end;
-		for( auto it = m_rows.begin(); it != end; ++it )
-		{
-			double c = it->second->coefficientFor( marker );
-			if( c == 0.0 )
-				continue;
-			if( it->first.type() == Symbol::External )
-			{
-				third = it;
-			}
-			else if( c < 0.0 )
-			{
-				double r = -it->second->constant() / c;
-				if( r < r1 )
-				{
-					r1 = r;
-					first = it;
-				}
-			}
-			else
-			{
-				double r = it->second->constant() / c;
-				if( r < r2 )
-				{
-					r2 = r;
-					second = it;
-				}
-			}
-		}
-		if( first != end )
-			return first;
-		if( second != end )
-			return second;
-		return third;
+		return findSlotted( m_edits, variable.ptr(), variable.ptr()->edit_slot_, m_edit_hints );
 	}
 
-	/* Remove the effects of a constraint on the objective function.
+	EditMap::const_iterator findEdit( const Variable& variable ) const
+	{
+		return findSlotted( m_edits, variable.ptr(), variable.ptr()->edit_slot_, m_edit_hints );
+	}
+
+	/* Give up the slot of an object leaving one of the maps.
 
 	*/
-	void removeConstraintEffects( const Constraint& cn, const Tag& tag )
+	void releaseSlot( SolverSlot& slot, SlotHintMap& hints )
 	{
-		if( tag.marker.type() == Symbol::Error )
-			removeMarkerEffects( tag.marker, cn.strength() );
-		if( tag.other.type() == Symbol::Error )
-			removeMarkerEffects( tag.other, cn.strength() );
+		if( slot.isOwnedBy( this ) )
+			slot.release( this );
+		else if( !hints.empty() )
+			hints.erase( &slot );
 	}
 
-	/* Remove the effects of an error marker on the objective function.
+	/* Give up every slot held by the solver.
+
+	The objects can outlive the solver, so a slot must not be left
+	claimed by it.
 
 	*/
-	void removeMarkerEffects( const Symbol& marker, double strength )
+	void releaseSlots()
 	{
-		auto row_it = m_rows.find( marker );
-		if( row_it != m_rows.end() )
-			m_objective->insert( *row_it->second, -strength );
-		else
-			m_objective->insert( marker, -strength );
+		auto release = [this]( SolverSlot& slot ) { slot.release( this ); };
+		for( const auto& cnPair : m_cns )
+			release( cnPair.first.ptr()->m_slot );
+		for( const auto& varPair : m_vars )
+			release( varPair.first.ptr()->var_slot_ );
+		for( const auto& editPair : m_edits )
+			release( editPair.first.ptr()->edit_slot_ );
+		m_cn_hints.clear();
+		m_var_hints.clear();
+		m_edit_hints.clear();
 	}
 
 	/* Test whether a row is composed of all dummy variables.
@@ -811,13 +3426,40 @@ private:
 	}
 
 	CnMap m_cns;
+	CnTermMap m_cn_terms;
+	CnShareMap m_shared;
+	CnMemberMap m_members;
+	CnHashMap m_cn_hashes;
+	CnIndex m_cn_index;
+	AliasMap m_aliases;
+	PresolveMap m_presolved;
 	RowMap m_rows;
 	VarMap m_vars;
 	EditMap m_edits;
+	SlotHintMap m_cn_hints;
+	SlotHintMap m_var_hints;
+	SlotHintMap m_edit_hints;
 	std::vector<Symbol> m_infeasible_rows;
+	std::vector<std::vector<Symbol>> m_range_rows;
+	std::unique_ptr<ThreadPool> m_pool;
 	std::unique_ptr<Row> m_objective;
 	std::unique_ptr<Row> m_artificial;
 	Symbol::Id m_id_tick;
+	double* m_values;
+	std::size_t m_values_size;
+	ValueSnapshot* m_snapshot;
+	LazySource m_lazy;
+	MapType<Symbol, double> m_lazy_basis;
+	bool m_lazy_enabled;
+	bool m_dedup_enabled;
+	bool m_presolve_enabled;
+	std::size_t m_parallel_rows;
+	bool m_deferred_enabled;
+	bool m_pending_primal;
+	bool m_pending_dual;
+	std::size_t m_dual_degenerate;
+	// Set once a constraint is disabled, see getEnteringSymbol.
+	bool m_toggled;
 };
 
 } // namespace impl
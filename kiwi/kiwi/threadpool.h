@@ -0,0 +1,148 @@
+/*-----------------------------------------------------------------------------
+| Copyright (c) 2013-2017, Nucleic Development Team.
+|
+| Distributed under the terms of the Modified BSD License.
+|
+| The full license is in the file LICENSE, distributed with this software.
+|----------------------------------------------------------------------------*/
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kiwi
+{
+
+namespace impl
+{
+
+// A fixed set of threads which run the tasks of one parallel loop at a
+// time. The calling thread takes part in the loop, so a pool of size n
+// starts n - 1 threads. Tasks are claimed in no particular order, callers
+// which need a deterministic result write each task's result to its own
+// slot and merge them afterwards.
+class ThreadPool
+{
+
+public:
+    explicit ThreadPool(std::size_t size)
+    {
+        m_threads.reserve(size - 1);
+        try
+        {
+            for (std::size_t i = 1; i < size; ++i)
+                m_threads.emplace_back([this]() { work(); });
+        }
+        catch (...)
+        {
+            stop();
+            throw;
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool()
+    {
+        stop();
+    }
+
+    std::size_t size() const
+    {
+        return m_threads.size() + 1;
+    }
+
+    // Call fn(i) for each i in [0, count) and wait for all of them. The
+    // first exception thrown by a task is rethrown once the loop is done.
+    template <typename F>
+    void run(std::size_t count, const F &fn)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_call = [](const void *ctx, std::size_t i) { (*static_cast<const F *>(ctx))(i); };
+            m_ctx = &fn;
+            m_count = count;
+            m_next.store(0, std::memory_order_relaxed);
+            m_pending = m_threads.size();
+            m_error = nullptr;
+            ++m_generation;
+        }
+        m_wake.notify_all();
+        claim();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this]() { return m_pending == 0; });
+        if (m_error)
+            std::rethrow_exception(m_error);
+    }
+
+private:
+    void claim()
+    {
+        for (std::size_t i; (i = m_next.fetch_add(1, std::memory_order_relaxed)) < m_count;)
+        {
+            try
+            {
+                m_call(m_ctx, i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (!m_error)
+                    m_error = std::current_exception();
+            }
+        }
+    }
+
+    void work()
+    {
+        std::size_t seen = 0;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_wake.wait(lock, [&]() { return m_stop || m_generation != seen; });
+            if (m_stop)
+                return;
+            seen = m_generation;
+            lock.unlock();
+            claim();
+            lock.lock();
+            if (--m_pending == 0)
+                m_done.notify_one();
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto &thread : m_threads)
+            thread.join();
+    }
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    void (*m_call)(const void *, std::size_t) = nullptr;
+    const void *m_ctx = nullptr;
+    std::size_t m_count = 0;
+    std::atomic<std::size_t> m_next{0};
+    std::size_t m_pending = 0;
+    std::size_t m_generation = 0;
+    std::exception_ptr m_error;
+    bool m_stop = false;
+};
+
+} // namespace impl
+
+} // namespace kiwi
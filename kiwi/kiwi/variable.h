@@ -6,8 +6,15 @@
 | The full license is in the file LICENSE, distributed with this software.
 |----------------------------------------------------------------------------*/
 #pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <cstring>
+#include <mutex>
+#include <new>
 #include <string>
+#include <type_traits>
+#include "shareddata.h"
 
 namespace kiwi
 {
@@ -66,12 +73,86 @@ public:
     explicit operator bool() const { return len_ != 0; }
 };
 
+class VariableData;
+
+namespace impl
+{
+class VariableSlab;
+
+/* The source of values for variables updated on demand.
+
+A variable bound to a source holds a stale `value_` whenever its
+`lazy_gen_` differs from the source generation; `resolve` computes the
+current value in that case.
+
+*/
+struct LazyValueSource
+{
+    std::uint32_t generation;
+    double (*resolve)(const LazyValueSource *source, const VariableData *var);
+};
+
+/* A lookup hint left on a variable or constraint by a solver.
+
+The first solver to look the object up claims the slot with a compare
+and swap, and keeps the position of the object in one of its maps in
+the index. Positions move as entries are added and removed, so the
+solver checks the entry at the index before using it. Other solvers
+holding the same object keep their hints on the side.
+
+The slot is a lookup hint only. The solver maps stay sorted vectors,
+so adding or removing an entry still shifts the entries after it.
+
+Solvers on different threads may share an object, so both fields are
+atomic. Only the owner touches the index and every read of it is
+checked, so all accesses are relaxed and only the claim is a locked
+instruction.
+
+*/
+class SolverSlot
+{
+public:
+    SolverSlot() : owner_(nullptr), index_(0) {}
+
+    bool isOwnedBy(const void *solver) const
+    {
+        return owner_.load(std::memory_order_relaxed) == solver;
+    }
+
+    // Claim a free slot, returns false if another solver holds it.
+    bool claim(const void *solver)
+    {
+        const void *expected = nullptr;
+        return owner_.compare_exchange_strong(expected, solver, std::memory_order_relaxed);
+    }
+
+    void release(const void *solver)
+    {
+        if (isOwnedBy(solver))
+            owner_.store(nullptr, std::memory_order_relaxed);
+    }
+
+    std::size_t index() const { return index_.load(std::memory_order_relaxed); }
+
+    void setIndex(std::size_t index) { index_.store(index, std::memory_order_relaxed); }
+
+private:
+    std::atomic<const void *> owner_;
+    std::atomic<std::size_t> index_;
+};
+} // namespace impl
+
 class VariableData
 {
 public:
-    std::size_t ref_count_;
-    double value_;
+    impl::RefCount<std::size_t> ref_count_;
+    mutable double value_;
     SmallStr name_;
+    impl::VariableSlab *slab_;
+    const impl::LazyValueSource *lazy_;
+    mutable std::uint32_t lazy_gen_;
+    mutable impl::SolverSlot var_slot_;
+    mutable impl::SolverSlot edit_slot_;
 
     const char* name() const { return name_.c_str(); }
     void setName(const char *name)
@@ -81,16 +162,50 @@ public:
         }
     }
 
-    static VariableData* alloc(const char *name = nullptr) {
-        return new VariableData{1, 0.0, SmallStr(name)};
+    double value() const
+    {
+        if (lazy_ && lazy_gen_ != lazy_->generation) {
+            value_ = lazy_->resolve(lazy_, this);
+            lazy_gen_ = lazy_->generation;
+        }
+        return value_;
+    }
+
+    void setValue(double value)
+    {
+        value_ = value;
+        if (lazy_)
+            lazy_gen_ = lazy_->generation;
+    }
+
+    static VariableData* alloc(const char *name = nullptr);
+
+    /* Allocate n variables contiguously from a single slab.
+
+    `names` may be null, or hold n names (null entries are unnamed). Each
+    variable starts with a reference count of 1 and is released individually.
+
+    */
+    static VariableData* allocArray(std::size_t n, const char *const *names = nullptr);
+
+    /* Construct a variable in storage owned by the caller.
+
+    The variable has no slab. Releasing the last reference only frees its
+    name, the storage stays valid with a zero reference count until the
+    owner reclaims it.
+
+    */
+    static VariableData* emplace(void *mem, const char *name = nullptr)
+    {
+        return new (mem) VariableData{1, 0.0, SmallStr(name), nullptr, nullptr, 0, {}, {}};
     }
 
-    void free() { delete this; }
+    void free();
 
     VariableData* retain() { ref_count_++; return this; }
     void release() {
         if (--ref_count_ == 0)
-            delete this;
+            free();
     }
 
     ~VariableData() = default;
@@ -101,12 +216,311 @@ public:
 };
 
 static_assert(std::is_standard_layout<VariableData>::value == true, "VariableData must be standard layout");
+static_assert(sizeof(impl::RefCount<std::size_t>) == sizeof(std::size_t), "ref_count_ must keep the size_t layout");
+
+namespace impl
+{
+
+/* A block of VariableData slots.
+
+Slots are handed out by bumping `used_` and recycled through an intrusive
+free list. Slabs with available slots are linked into the pool's available
+list; a slab is returned to the heap once its last variable is released,
+except for a single spare slab kept by the pool.
+
+*/
+class VariableSlab
+{
+public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 64;
+
+    // A free slot, which remembers its slab while it sits in a thread cache.
+    struct FreeSlot
+    {
+        void *next;
+        VariableSlab *slab;
+    };
+
+    union Slot
+    {
+        FreeSlot free;
+        std::aligned_storage<sizeof(VariableData), alignof(VariableData)>::type storage;
+    };
+
+    static VariableSlab *create(std::size_t capacity)
+    {
+        void *mem = ::operator new(sizeof(VariableSlab) + capacity * sizeof(Slot));
+        return new (mem) VariableSlab(capacity);
+    }
+
+    static void destroy(VariableSlab *slab)
+    {
+        slab->~VariableSlab();
+        ::operator delete(slab);
+    }
+
+    bool full() const { return !free_ && used_ == capacity_; }
+
+    Slot *take()
+    {
+        live_++;
+        if (free_) {
+            Slot *slot = free_;
+            free_ = static_cast<Slot *>(slot->free.next);
+            return slot;
+        }
+        return &slots()[used_++];
+    }
+
+    void *takeContiguous(std::size_t n)
+    {
+        live_ += n;
+        Slot *first = &slots()[used_];
+        used_ += n;
+        return first;
+    }
+
+    // Returns true when the slab has no live variables left.
+    bool give(Slot *slot)
+    {
+        slot->free.next = free_;
+        free_ = slot;
+        return --live_ == 0;
+    }
+
+    VariableSlab *prev_;
+    VariableSlab *next_;
+
+private:
+    explicit VariableSlab(std::size_t capacity) : prev_(nullptr), next_(nullptr),
+                                                  capacity_(capacity), used_(0), live_(0), free_(nullptr) {}
+
+    Slot *slots() { return reinterpret_cast<Slot *>(this + 1); }
+
+    std::size_t capacity_;
+    std::size_t used_;
+    std::size_t live_;
+    Slot *free_;
+};
+
+static_assert(sizeof(VariableSlab) % alignof(VariableData) == 0, "slab slots must be aligned");
+
+/* Process wide VariableData pool.
+
+The pool is intentionally never destroyed so variables released during
+static destruction remain valid. Each thread keeps a small cache of free
+slots, so alloc and free only take the pool mutex to move a batch of
+slots between the cache and the slabs. Slots in a cache still count as
+live in their slab. A thread returns its cache when it exits, and frees
+after that go straight to the slabs under the mutex.
+
+*/
+class VariablePool
+{
+public:
+    static constexpr std::size_t CACHE_BATCH = 32;
+
+    static VariablePool &instance()
+    {
+        static VariablePool *pool = new VariablePool();
+        return *pool;
+    }
+
+    VariableData *alloc(const char *name)
+    {
+        SmallStr str(name);
+        Slot *slot;
+        ThreadCache *cache = threadCache();
+        if (cache) {
+            if (!cache->head)
+                refill(*cache);
+            slot = cache->pop();
+        } else {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            slot = takeLocked();
+        }
+        VariableSlab *slab = slot->free.slab;
+        return new (slot) VariableData{1, 0.0, std::move(str), slab, nullptr, 0, {}, {}};
+    }
+
+    VariableData *allocArray(std::size_t n, const char *const *names)
+    {
+        if (n == 0)
+            return nullptr;
+        VariableSlab *slab = VariableSlab::create(n < VariableSlab::DEFAULT_CAPACITY ? VariableSlab::DEFAULT_CAPACITY : n);
+        auto *vars = static_cast<VariableData *>(slab->takeContiguous(n));
+        for (std::size_t i = 0; i < n; ++i)
+            new (&vars[i]) VariableData{1, 0.0, SmallStr(names ? names[i] : nullptr), slab, nullptr, 0, {}, {}};
+        if (!slab->full()) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            link(slab);
+        }
+        return vars;
+    }
+
+    void free(VariableData *var)
+    {
+        VariableSlab *slab = var->slab_;
+        var->~VariableData();
+        Slot *slot = reinterpret_cast<Slot *>(var);
+        slot->free.slab = slab;
+        ThreadCache *cache = threadCache();
+        if (cache) {
+            cache->push(slot);
+            if (cache->count > 2 * CACHE_BATCH)
+                drain(*cache, CACHE_BATCH);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        giveLocked(slot);
+    }
+
+private:
+    using Slot = VariableSlab::Slot;
+
+    struct ThreadCache
+    {
+        Slot *head = nullptr;
+        std::size_t count = 0;
+
+        void push(Slot *slot)
+        {
+            slot->free.next = head;
+            head = slot;
+            ++count;
+        }
+
+        Slot *pop()
+        {
+            Slot *slot = head;
+            head = static_cast<Slot *>(slot->free.next);
+            --count;
+            return slot;
+        }
+
+        ~ThreadCache()
+        {
+            cacheReleased() = true;
+            VariablePool::instance().drain(*this, count);
+        }
+    };
+
+    // Set once the cache of the thread is destroyed, it has no destructor
+    // of its own so it can still be read afterwards.
+    static bool &cacheReleased()
+    {
+        static thread_local bool released = false;
+        return released;
+    }
+
+    static ThreadCache *threadCache()
+    {
+        if (cacheReleased())
+            return nullptr;
+        static thread_local ThreadCache cache;
+        return &cache;
+    }
+
+    VariablePool() : m_available(nullptr) {}
+
+    // Move up to a batch of slots into the cache. A new slab is only
+    // created when no slab has a slot left, so a failed allocation
+    // leaves the cache empty.
+    void refill(ThreadCache &cache)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (cache.count < CACHE_BATCH && (m_available || !cache.head))
+            cache.push(takeLocked());
+    }
+
+    void drain(ThreadCache &cache, std::size_t n)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (; n > 0 && cache.head; --n)
+            giveLocked(cache.pop());
+    }
+
+    Slot *takeLocked()
+    {
+        VariableSlab *slab = m_available;
+        if (!slab) {
+            slab = VariableSlab::create(VariableSlab::DEFAULT_CAPACITY);
+            link(slab);
+        }
+        Slot *slot = slab->take();
+        slot->free.slab = slab;
+        if (slab->full())
+            unlink(slab);
+        return slot;
+    }
+
+    void giveLocked(Slot *slot)
+    {
+        VariableSlab *slab = slot->free.slab;
+        const bool was_full = slab->full();
+        if (slab->give(slot)) {
+            // Keep the last empty slab around to avoid churn on alloc/free cycles.
+            if (m_available == slab && !slab->next_)
+                return;
+            if (!was_full)
+                unlink(slab);
+            VariableSlab::destroy(slab);
+        } else if (was_full) {
+            link(slab);
+        }
+    }
+
+    void link(VariableSlab *slab)
+    {
+        slab->prev_ = nullptr;
+        slab->next_ = m_available;
+        if (m_available)
+            m_available->prev_ = slab;
+        m_available = slab;
+    }
+
+    void unlink(VariableSlab *slab)
+    {
+        if (slab->prev_)
+            slab->prev_->next_ = slab->next_;
+        else
+            m_available = slab->next_;
+        if (slab->next_)
+            slab->next_->prev_ = slab->prev_;
+        slab->prev_ = slab->next_ = nullptr;
+    }
+
+    std::mutex m_mutex;
+    VariableSlab *m_available;
+};
+
+} // namespace impl
+
+inline VariableData *VariableData::alloc(const char *name)
+{
+    return impl::VariablePool::instance().alloc(name);
+}
+
+inline VariableData *VariableData::allocArray(std::size_t n, const char *const *names)
+{
+    return impl::VariablePool::instance().allocArray(n, names);
+}
+
+inline void VariableData::free()
+{
+    if (!slab_) {
+        name_ = SmallStr();
+        return;
+    }
+    impl::VariablePool::instance().free(this);
+}
 
 class Variable
 {
 public:
     explicit Variable(VariableData *p) : m_data(p->retain()) {}
     VariableData *ptr() { return m_data; }
+    const VariableData *ptr() const { return m_data; }
 
     Variable() : m_data(VariableData::alloc()) {}
 
@@ -128,8 +542,8 @@ public:
     void setName(const char *name) { m_data->setName(name); }
     void setName(const std::string &name) { m_data->setName(name.c_str()); }
 
-    double value() const { return m_data->value_; }
-    void setValue(double value) { m_data->value_ = value; }
+    double value() const { return m_data->value(); }
+    void setValue(double value) { m_data->setValue(value); }
 
     // operator== is used for symbolics
     bool equals(const Variable &other) const
@@ -110,6 +110,12 @@ struct KiwiExpression {
    ~KiwiExpression() = delete;
 };
 
+// Growable expression backing kiwi.LinearSum, the terms are heap allocated.
+struct KiwiLinearSum {
+   KiwiExpression* expr;
+   int capacity;
+};
+
 // This mechanism was initially designed for LuaJIT FFI.
 struct KiwiErr {
    enum KiwiErrKind kind;
@@ -120,6 +126,8 @@ struct KiwiErr {
 struct KiwiSolver {
    unsigned error_mask;
    Solver solver;
+   // Reused by update_vars_changed so updates do not allocate.
+   std::vector<VariableData*> changed;
 };
 
 inline const KiwiErr* new_error(const KiwiErr* base, const std::exception& ex) {
@@ -137,6 +145,56 @@ inline const KiwiErr* new_error(const KiwiErr* base, const std::exception& ex) {
    return new (mem) KiwiErr {base->kind, msg, true};
 }
 
+inline const KiwiErr* status_err(SolverStatus status) {
+   switch (status) {
+      case SolverStatus::Ok:
+         return nullptr;
+      case SolverStatus::UnsatisfiableConstraint: {
+         static const constexpr KiwiErr err {
+             KiwiErrUnsatisfiableConstraint,
+             "The constraint cannot be satisfied."
+         };
+         return &err;
+      }
+      case SolverStatus::UnknownConstraint: {
+         static const constexpr KiwiErr err {
+             KiwiErrUnknownConstraint,
+             "The constraint has not been added to the solver."
+         };
+         return &err;
+      }
+      case SolverStatus::DuplicateConstraint: {
+         static const constexpr KiwiErr err {
+             KiwiErrDuplicateConstraint,
+             "The constraint has already been added to the solver."
+         };
+         return &err;
+      }
+      case SolverStatus::UnknownEditVariable: {
+         static const constexpr KiwiErr err {
+             KiwiErrUnknownEditVar,
+             "The edit variable has not been added to the solver."
+         };
+         return &err;
+      }
+      case SolverStatus::DuplicateEditVariable: {
+         static const constexpr KiwiErr err {
+             KiwiErrDuplicateEditVar,
+             "The edit variable has already been added to the solver."
+         };
+         return &err;
+      }
+      case SolverStatus::BadRequiredStrength: {
+         static const constexpr KiwiErr err {
+             KiwiErrBadRequiredStrength,
+             "A required strength cannot be used in this context."
+         };
+         return &err;
+      }
+   }
+   return nullptr;
+}
+
 template<typename F>
 inline const KiwiErr* wrap_err(F&& f) {
    static const constexpr KiwiErr kKiwiErrUnhandledCxxException {
@@ -147,46 +205,17 @@ inline const KiwiErr* wrap_err(F&& f) {
    try {
       f();
    } catch (const UnsatisfiableConstraint&) {
-      static const constexpr KiwiErr err {
-          KiwiErrUnsatisfiableConstraint,
-          "The constraint cannot be satisfied."
-      };
-      return &err;
+      return status_err(SolverStatus::UnsatisfiableConstraint);
    } catch (const UnknownConstraint&) {
-      static const constexpr KiwiErr err {
-          KiwiErrUnknownConstraint,
-          "The constraint has not been added to the solver."
-      };
-      return &err;
-
+      return status_err(SolverStatus::UnknownConstraint);
    } catch (const DuplicateConstraint&) {
-      static const constexpr KiwiErr err {
-          KiwiErrDuplicateConstraint,
-          "The constraint has already been added to the solver."
-      };
-      return &err;
-
+      return status_err(SolverStatus::DuplicateConstraint);
    } catch (const UnknownEditVariable&) {
-      static const constexpr KiwiErr err {
-          KiwiErrUnknownEditVar,
-          "The edit variable has not been added to the solver."
-      };
-      return &err;
-
+      return status_err(SolverStatus::UnknownEditVariable);
    } catch (const DuplicateEditVariable&) {
-      static const constexpr KiwiErr err {
-          KiwiErrDuplicateEditVar,
-          "The edit variable has already been added to the solver."
-      };
-      return &err;
-
+      return status_err(SolverStatus::DuplicateEditVariable);
    } catch (const BadRequiredStrength&) {
-      static const constexpr KiwiErr err {
-          KiwiErrBadRequiredStrength,
-          "A required strength cannot be used in this context."
-      };
-      return &err;
-
+      return status_err(SolverStatus::BadRequiredStrength);
    } catch (const InternalSolverError& ex) {
       static const constexpr KiwiErr base {
           KiwiErrInternalSolverError,
@@ -214,6 +243,15 @@ inline const KiwiErr* wrap_err(P&& s, R&& ref, F&& f) {
    return wrap_err([&]() { f(s, ref); });
 }
 
+// Like wrap_err, but for the non-throwing solver methods returning a
+// SolverStatus. Only unexpected failures go through the exception path.
+template<typename P, typename R, typename F>
+inline const KiwiErr* wrap_status(P&& s, R&& ref, F&& f) {
+   auto status = SolverStatus::Ok;
+   const KiwiErr* err = wrap_err([&]() { status = f(s, ref); });
+   return err ? err : status_err(status);
+}
+
 template<typename T, typename... Args>
 inline T* make_unmanaged(Args... args) {
    auto* p = new (std::nothrow) T(std::forward<Args>(args)...);
@@ -250,30 +288,17 @@ inline ConstraintData* kiwi_constraint_new(
    }
 
    try {
-      std::vector<Term> terms;
-
-      terms.reserve(static_cast<decltype(terms)::size_type>(
-          (lhs && lhs->term_count > 0 ? lhs->term_count : 0)
-          + (rhs && rhs->term_count > 0 ? rhs->term_count : 0)
-      ));
-
-      if (lhs) {
-         for (int i = 0; i < lhs->term_count; ++i) {
-            const auto& t = lhs->terms[i];
-            terms.emplace_back(Variable(t.var), t.coefficient);
-         }
-      }
-      if (rhs) {
-         for (int i = 0; i < rhs->term_count; ++i) {
-            const auto& t = rhs->terms[i];
-            terms.emplace_back(Variable(t.var), -t.coefficient);
-         }
-      }
-      return make_unmanaged<ConstraintData>(
-          Expression(std::move(terms), (lhs ? lhs->constant : 0.0) - (rhs ? rhs->constant : 0.0)),
-          static_cast<RelationalOperator>(op),
+      auto* c = ConstraintData::alloc(
+          lhs ? lhs->terms : nullptr,
+          lhs ? lhs->term_count : 0,
+          rhs ? rhs->terms : nullptr,
+          rhs ? rhs->term_count : 0,
+          (lhs ? lhs->constant : 0.0) - (rhs ? rhs->constant : 0.0),
+          op,
           strength
       );
+      c->m_refcount = 1;
+      return c;
 
    } catch (...) {
       return nullptr;
@@ -281,32 +306,71 @@ inline ConstraintData* kiwi_constraint_new(
 }
 
 inline const KiwiErr* kiwi_solver_add_constraint(Solver& s, ConstraintData* constraint) {
-   return wrap_err(s, constraint, [](auto&& solver, auto&& c) {
-      solver.addConstraint(Constraint(c));
+   return wrap_status(s, constraint, [](auto&& solver, auto&& c) {
+      return solver.tryAddConstraint(Constraint(c));
    });
 }
 
 inline const KiwiErr* kiwi_solver_remove_constraint(Solver& s, ConstraintData* constraint) {
-   return wrap_err(s, constraint, [](auto&& solver, auto&& c) {
-      solver.removeConstraint(Constraint(c));
+   return wrap_status(s, constraint, [](auto&& solver, auto&& c) {
+      return solver.tryRemoveConstraint(Constraint(c));
+   });
+}
+
+inline const KiwiErr*
+kiwi_solver_set_constraint_enabled(Solver& s, ConstraintData* constraint, bool enabled) {
+   return wrap_status(s, constraint, [enabled](auto&& solver, auto&& c) {
+      return solver.trySetConstraintEnabled(Constraint(c), enabled);
+   });
+}
+
+inline const KiwiErr*
+kiwi_solver_set_strength(Solver& s, ConstraintData* constraint, double strength) {
+   return wrap_status(s, constraint, [strength](auto&& solver, auto&& c) {
+      return solver.trySetStrength(Constraint(c), strength);
+   });
+}
+
+inline const KiwiErr*
+kiwi_solver_set_constant(Solver& s, ConstraintData* constraint, double constant) {
+   return wrap_status(s, constraint, [constant](auto&& solver, auto&& c) {
+      return solver.trySetConstant(Constraint(c), constant);
+   });
+}
+
+inline const KiwiErr* kiwi_solver_set_coefficient(
+    Solver& s,
+    ConstraintData* constraint,
+    VariableData* var,
+    double coefficient
+) {
+   return wrap_status(s, constraint, [var, coefficient](auto&& solver, auto&& c) {
+      return solver.trySetCoefficient(Constraint(c), Variable(var), coefficient);
    });
 }
 
 inline const KiwiErr* kiwi_solver_add_edit_var(Solver& s, VariableData* var, double strength) {
-   return wrap_err(s, var, [strength](auto&& solver, auto&& v) {
-      solver.addEditVariable(Variable(v), strength);
+   return wrap_status(s, var, [strength](auto&& solver, auto&& v) {
+      return solver.tryAddEditVariable(Variable(v), strength);
    });
 }
 
 inline const KiwiErr* kiwi_solver_remove_edit_var(Solver& s, VariableData* var) {
-   return wrap_err(s, var, [](auto&& solver, auto&& v) {
-      solver.removeEditVariable(Variable(v));
+   return wrap_status(s, var, [](auto&& solver, auto&& v) {
+      return solver.tryRemoveEditVariable(Variable(v));
+   });
+}
+
+inline const KiwiErr*
+kiwi_solver_set_edit_strength(Solver& s, VariableData* var, double strength) {
+   return wrap_status(s, var, [strength](auto&& solver, auto&& v) {
+      return solver.trySetEditStrength(Variable(v), strength);
    });
 }
 
 inline const KiwiErr* kiwi_solver_suggest_value(Solver& s, VariableData* var, double value) {
-   return wrap_err(s, var, [value](auto&& solver, auto&& v) {
-      solver.suggestValue(Variable(v), value);
+   return wrap_status(s, var, [value](auto&& solver, auto&& v) {
+      return solver.trySuggestValue(Variable(v), value);
    });
 }
 
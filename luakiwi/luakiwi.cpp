@@ -1,4 +1,5 @@
 #include <math.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -9,9 +10,16 @@ namespace {
 // Note some of the internal functions do not bother cleaning up the stack, they
 // are marked with accordingly.
 
-enum TypeId { NOTYPE, VAR = 1, TERM, EXPR, CONSTRAINT, SOLVER, ERROR, NUMBER };
+enum TypeId { NOTYPE, VAR = 1, TERM, EXPR, CONSTRAINT, SOLVER, ERROR, LINSUM, NUMBER };
 
-enum { ERR_KIND_TAB = NUMBER + 1, VAR_SUB_FN, MEM_ERR_MSG, CONTEXT_TAB_MAX };
+enum {
+   ERR_KIND_TAB = NUMBER + 1,
+   VAR_SUB_FN,
+   MEM_ERR_MSG,
+   ZOMBIE_TAB,
+   ZOMBIE_STATE,
+   CONTEXT_TAB_MAX
+};
 
 constexpr const char* const lkiwi_error_kinds[] = {
     "KiwiErrNone",
@@ -154,6 +162,19 @@ inline KiwiExpression* try_expr(lua_State* L, int idx) {
    return static_cast<KiwiExpression*>(try_type(L, idx, EXPR));
 }
 
+// an expression, or the expression of a linear sum
+// stack disposition: dirty
+inline KiwiExpression* try_expr_or_sum(lua_State* L, int idx) {
+   void* p = lua_touserdata(L, idx);
+   if (!p || !lua_getmetatable(L, idx))
+      return 0;
+   push_type(L, EXPR);
+   if (lua_rawequal(L, -1, -2))
+      return static_cast<KiwiExpression*>(p);
+   push_type(L, LINSUM);
+   return lua_rawequal(L, -1, -3) ? static_cast<KiwiLinearSum*>(p)->expr : 0;
+}
+
 // method to test types for expression functions
 // stack disposition: dirty
 inline void* try_arg(lua_State* L, int idx, TypeId* type_id, double* num) {
@@ -183,6 +204,11 @@ inline void* try_arg(lua_State* L, int idx, TypeId* type_id, double* num) {
       *type_id = TERM;
       return p;
    }
+   push_type(L, LINSUM);
+   if (lua_rawequal(L, -1, -5)) {
+      *type_id = EXPR;
+      return static_cast<KiwiLinearSum*>(p)->expr;
+   }
    *type_id = NOTYPE;
    return 0;
 }
@@ -214,6 +240,10 @@ inline KiwiSolver* get_solver(lua_State* L, int idx) {
    return static_cast<KiwiSolver*>(check_arg(L, idx, SOLVER));
 }
 
+inline KiwiLinearSum* get_linear_sum(lua_State* L, int idx) {
+   return static_cast<KiwiLinearSum*>(check_arg(L, idx, LINSUM));
+}
+
 VariableData** var_new(lua_State* L) {
    auto** varp = static_cast<VariableData**>(lua_newuserdata(L, sizeof(VariableData*)));
    push_type(L, VAR);
@@ -229,6 +259,69 @@ VariableData* var_register(lua_State* L, VariableData* var) {
    return var;
 }
 
+// Variables created by kiwi.Var live inside their userdata, after the pointer
+// shared with the handles that reference other variables.
+struct InlineVar {
+   VariableData* var;
+   std::aligned_storage<sizeof(VariableData), alignof(VariableData)>::type data;
+};
+
+inline bool var_is_inline(void* ud, const VariableData* var) {
+   return var == reinterpret_cast<VariableData*>(static_cast<char*>(ud) + offsetof(InlineVar, data));
+}
+
+VariableData* var_new_inline(lua_State* L, const char* name) {
+   auto* iv = static_cast<InlineVar*>(lua_newuserdata(L, sizeof(InlineVar)));
+   iv->var = nullptr;
+   try {
+      iv->var = VariableData::emplace(&iv->data, name);
+   } catch (...) {
+   }
+   var_register(L, iv->var);
+   push_type(L, VAR);
+   lua_setmetatable(L, -2);
+   return iv->var;
+}
+
+// Inline variables still referenced from C++ (solvers, constraints, terms) when
+// their userdata is collected are resurrected into the zombie table. The table
+// is swept for variables whose last reference was dropped once it doubles in size.
+struct ZombieState {
+   int count;
+   int sweep_at;
+};
+
+constexpr const int ZOMBIE_MIN_SWEEP = 64;
+
+// stack disposition: dirty
+void zombie_sweep(lua_State* L, int tab_absi, ZombieState* zs) {
+   lua_pushnil(L);
+   while (lua_next(L, tab_absi)) {
+      lua_pop(L, 1);
+      auto* iv = static_cast<InlineVar*>(lua_touserdata(L, -1));
+      if (iv->var->ref_count_ == 0) {
+         lua_pushvalue(L, -1);
+         lua_pushnil(L);
+         lua_rawset(L, tab_absi);
+         --zs->count;
+      }
+   }
+   zs->sweep_at = zs->count > ZOMBIE_MIN_SWEEP / 2 ? zs->count * 2 : ZOMBIE_MIN_SWEEP;
+}
+
+// stack disposition: dirty
+void zombie_add(lua_State* L, int idx) {
+   lua_rawgeti(L, lua_upvalueindex(1), ZOMBIE_STATE);
+   auto* zs = static_cast<ZombieState*>(lua_touserdata(L, -1));
+   lua_rawgeti(L, lua_upvalueindex(1), ZOMBIE_TAB);
+   const int tab_absi = lua_gettop(L);
+   lua_pushvalue(L, idx);
+   lua_pushboolean(L, 1);
+   lua_rawset(L, tab_absi);
+   if (++zs->count >= zs->sweep_at)
+      zombie_sweep(L, tab_absi, zs);
+}
+
 KiwiTerm* term_new(lua_State* L) {
    auto* term = static_cast<KiwiTerm*>(lua_newuserdata(L, sizeof(KiwiTerm)));
    push_type(L, TERM);
@@ -281,17 +374,21 @@ KiwiExpression* toexpr(lua_State* L, int idx, KiwiExpression* temp) {
    if (lua_rawequal(L, -1, -2)) {
       return static_cast<KiwiExpression*>(ud);
    }
+   push_type(L, LINSUM);
+   if (lua_rawequal(L, -1, -3)) {
+      return static_cast<KiwiLinearSum*>(ud)->expr;
+   }
 
    temp->constant = 0;
    temp->term_count = 1;
    push_type(L, VAR);
-   if (lua_rawequal(L, -1, -3)) {
+   if (lua_rawequal(L, -1, -4)) {
       temp->terms[0].var = *static_cast<VariableData**>(ud);
       temp->terms[0].coefficient = 1.0;
       return temp;
    }
    push_type(L, TERM);
-   if (lua_rawequal(L, -1, -4)) {
+   if (lua_rawequal(L, -1, -5)) {
       temp->terms[0] = *static_cast<KiwiTerm*>(ud);
       return temp;
    }
@@ -470,12 +567,17 @@ int lkiwi_var_m_eq(lua_State* L) {
 
 int lkiwi_var_m_tostring(lua_State* L) {
    auto* var = get_var(L, 1);
-   lua_pushfstring(L, "%s(%f)", var->name(), var->value_);
+   lua_pushfstring(L, "%s(%f)", var->name(), var->value());
    return 1;
 }
 
 int lkiwi_var_m_gc(lua_State* L) {
-   get_var(L, 1)->release();
+   auto* ud = check_arg(L, 1, VAR);
+   auto* var = *static_cast<VariableData**>(ud);
+   const bool keep = var->ref_count_ > 1 && var_is_inline(ud, var);
+   var->release();
+   if (keep)
+      zombie_add(L, 1);
    return 0;
 }
 
@@ -494,12 +596,12 @@ int lkiwi_var_name(lua_State* L) {
 int lkiwi_var_set(lua_State* L) {
    auto* var = get_var(L, 1);
    const double value = luaL_checknumber(L, 2);
-   var->value_ = value;
+   var->setValue(value);
    return 0;
 }
 
 int lkiwi_var_value(lua_State* L) {
-   lua_pushnumber(L, get_var(L, 1)->value_);
+   lua_pushnumber(L, get_var(L, 1)->value());
    return 1;
 }
 
@@ -543,9 +645,56 @@ constexpr const struct luaL_Reg kiwi_var_m[] = {
 int lkiwi_var_new(lua_State* L) {
    const char* name = luaL_optstring(L, 1, "");
 
-   auto* varp = var_new(L);
-   var_register(L, *varp = VariableData::alloc(name));
+   var_new_inline(L, name);
+   return 1;
+}
 
+int lkiwi_new_vars(lua_State* L) {
+   const lua_Integer n = luaL_checkinteger(L, 1);
+   luaL_argcheck(L, n >= 0 && n <= INT_MAX, 1, "count out of range");
+   const int count = static_cast<int>(n);
+   const bool has_names = !lua_isnoneornil(L, 2);
+   if (has_names)
+      luaL_checktype(L, 2, LUA_TTABLE);
+
+   lua_createtable(L, count, 0);
+   if (count == 0)
+      return 1;
+   const int tab = lua_gettop(L);
+
+   // The handles are created before the variables, without a metatable, so
+   // an allocation error while creating them cannot leak any variable.
+   for (int i = 0; i < count; ++i) {
+      *static_cast<VariableData**>(lua_newuserdata(L, sizeof(VariableData*))) = nullptr;
+      lua_rawseti(L, tab, i + 1);
+   }
+
+   // names stay anchored by the argument table for the duration of the call
+   const char** names = nullptr;
+   if (has_names) {
+      names = static_cast<const char**>(lua_newuserdata(L, sizeof(const char*) * static_cast<std::size_t>(count)));
+      for (int i = 0; i < count; ++i) {
+         lua_rawgeti(L, 2, i + 1);
+         names[i] = lua_type(L, -1) == LUA_TSTRING ? lua_tostring(L, -1) : nullptr;
+         lua_pop(L, 1);
+      }
+   }
+
+   VariableData* vars = nullptr;
+   try {
+      vars = VariableData::allocArray(static_cast<std::size_t>(count), names);
+   } catch (...) {
+   }
+   var_register(L, vars);
+   lua_settop(L, tab);
+
+   for (int i = 0; i < count; ++i) {
+      lua_rawgeti(L, tab, i + 1);
+      *static_cast<VariableData**>(lua_touserdata(L, -1)) = &vars[i];
+      push_type(L, VAR);
+      lua_setmetatable(L, -2);
+      lua_pop(L, 1);
+   }
    return 1;
 }
 
@@ -637,7 +786,7 @@ int lkiwi_term_toexpr(lua_State* L) {
 
 int lkiwi_term_value(lua_State* L) {
    const auto* term = get_term(L, 1);
-   lua_pushnumber(L, term->var->value_ * term->coefficient);
+   lua_pushnumber(L, term->var->value() * term->coefficient);
    return 1;
 }
 
@@ -753,7 +902,7 @@ int lkiwi_expr_m_add(lua_State* L) {
       }
    }
 
-   const auto* expr_a = try_expr(L, 1);
+   const auto* expr_a = try_expr_or_sum(L, 1);
    if (expr_a) {
       switch (type_id_b) {
          case EXPR:
@@ -790,7 +939,7 @@ int lkiwi_expr_m_mul(lua_State* L) {
    }
 
    if (isnum) {
-      const auto* expr = try_expr(L, expridx);
+      const auto* expr = try_expr_or_sum(L, expridx);
       if (expr)
          return push_mul_expr_coeff(L, expr, num);
    }
@@ -798,7 +947,7 @@ int lkiwi_expr_m_mul(lua_State* L) {
 }
 
 int lkiwi_expr_m_div(lua_State* L) {
-   const auto* expr = try_expr(L, 1);
+   const auto* expr = try_expr_or_sum(L, 1);
    int isnum;
    double num = lua_tonumberx(L, 2, &isnum);
    if (!expr || !isnum) {
@@ -812,14 +961,17 @@ int lkiwi_expr_m_unm(lua_State* L) {
    return push_mul_expr_coeff(L, expr, -1.0);
 }
 
-int lkiwi_expr_value(lua_State* L) {
-   const auto* expr = get_expr(L, 1);
+double expr_value(const KiwiExpression* expr) {
    double sum = expr->constant;
    for (int i = 0; i < expr->term_count; i++) {
       const auto* t = &expr->terms[i];
-      sum += t->var->value_ * t->coefficient;
+      sum += t->var->value() * t->coefficient;
    }
-   lua_pushnumber(L, sum);
+   return sum;
+}
+
+int lkiwi_expr_value(lua_State* L) {
+   lua_pushnumber(L, expr_value(get_expr(L, 1)));
    return 1;
 }
 
@@ -841,8 +993,7 @@ int lkiwi_expr_copy(lua_State* L) {
    return push_expr_constant(L, expr, expr->constant);
 }
 
-int lkiwi_expr_m_tostring(lua_State* L) {
-   const auto* expr = get_expr(L, 1);
+int push_expr_tostring(lua_State* L, const KiwiExpression* expr) {
    luaL_Buffer buf;
    luaL_buffinit(L, &buf);
 
@@ -860,6 +1011,10 @@ int lkiwi_expr_m_tostring(lua_State* L) {
    return 1;
 }
 
+int lkiwi_expr_m_tostring(lua_State* L) {
+   return push_expr_tostring(L, get_expr(L, 1));
+}
+
 int lkiwi_expr_m_gc(lua_State* L) {
    const auto* expr = get_expr(L, 1);
    if (expr->owner) {
@@ -922,6 +1077,181 @@ int lkiwi_expr_new(lua_State* L) {
    return 1;
 }
 
+constexpr const int LINEAR_SUM_MIN_CAPACITY = 8;
+
+// Grow the sum so it can hold `need` terms, raising a memory error on failure.
+void linear_sum_reserve(lua_State* L, KiwiLinearSum* sum, int need) {
+   if (need <= sum->capacity)
+      return;
+
+   int cap = sum->capacity > 0 ? sum->capacity : LINEAR_SUM_MIN_CAPACITY;
+   while (cap < need)
+      cap = cap > INT_MAX / 2 ? need : cap * 2;
+
+   auto* expr = static_cast<KiwiExpression*>(realloc(static_cast<void*>(sum->expr), KiwiExpression::sz(cap)));
+   if (lk_unlikely(!expr)) {
+      lua_rawgeti(L, lua_upvalueindex(1), MEM_ERR_MSG);
+      lua_error(L);
+   }
+   if (!sum->expr) {
+      expr->constant = 0.0;
+      expr->term_count = 0;
+      expr->owner = nullptr;
+   }
+   sum->expr = expr;
+   sum->capacity = cap;
+}
+
+inline void linear_sum_push(KiwiLinearSum* sum, VariableData* var, double coefficient) {
+   auto* t = &sum->expr->terms[sum->expr->term_count++];
+   t->var = var->retain();
+   t->coefficient = coefficient;
+}
+
+int lkiwi_linear_sum_add(lua_State* L) {
+   auto* sum = get_linear_sum(L, 1);
+   double coeff = luaL_optnumber(L, 3, 1.0);
+   TypeId type_id;
+   double num;
+   void* arg = try_arg(L, 2, &type_id, &num);
+
+   VariableData* var;
+   if (type_id == VAR) {
+      var = *static_cast<VariableData**>(arg);
+   } else if (type_id == TERM) {
+      const auto* term = static_cast<const KiwiTerm*>(arg);
+      var = term->var;
+      coeff *= term->coefficient;
+   } else {
+      return op_error(L, "add", 1, 2);
+   }
+
+   if (lk_unlikely(sum->expr->term_count == INT_MAX)) {
+      lua_rawgeti(L, lua_upvalueindex(1), MEM_ERR_MSG);
+      lua_error(L);
+   }
+   linear_sum_reserve(L, sum, sum->expr->term_count + 1);
+   linear_sum_push(sum, var, coeff);
+   lua_settop(L, 1);
+   return 1;
+}
+
+int lkiwi_linear_sum_add_expr(lua_State* L) {
+   alignas(KiwiExpression) unsigned char tmp[KiwiExpression::sz(1)];
+   auto* sum = get_linear_sum(L, 1);
+   double scale = luaL_optnumber(L, 3, 1.0);
+   const auto* expr = toexpr(L, 2, reinterpret_cast<KiwiExpression*>(tmp));
+   if (!expr)
+      return op_error(L, "add_expr", 1, 2);
+
+   const int n = expr->term_count;
+   if (lk_unlikely(n > INT_MAX - sum->expr->term_count)) {
+      lua_rawgeti(L, lua_upvalueindex(1), MEM_ERR_MSG);
+      lua_error(L);
+   }
+   // Adding a sum to itself: the terms move if the storage is reallocated.
+   const bool self_add = expr == sum->expr;
+   linear_sum_reserve(L, sum, sum->expr->term_count + n);
+   if (self_add)
+      expr = sum->expr;
+
+   for (int i = 0; i < n; ++i)
+      linear_sum_push(sum, expr->terms[i].var, expr->terms[i].coefficient * scale);
+   sum->expr->constant += expr->constant * scale;
+   lua_settop(L, 1);
+   return 1;
+}
+
+int lkiwi_linear_sum_add_constant(lua_State* L) {
+   auto* sum = get_linear_sum(L, 1);
+   sum->expr->constant += luaL_checknumber(L, 2);
+   lua_settop(L, 1);
+   return 1;
+}
+
+int lkiwi_linear_sum_clear(lua_State* L) {
+   auto* expr = get_linear_sum(L, 1)->expr;
+   for (auto* t = expr->terms; t != expr->terms + expr->term_count; ++t) {
+      t->var->release();
+   }
+   expr->term_count = 0;
+   expr->constant = 0.0;
+   lua_settop(L, 1);
+   return 1;
+}
+
+int lkiwi_linear_sum_term_count(lua_State* L) {
+   lua_pushinteger(L, get_linear_sum(L, 1)->expr->term_count);
+   return 1;
+}
+
+int lkiwi_linear_sum_value(lua_State* L) {
+   lua_pushnumber(L, expr_value(get_linear_sum(L, 1)->expr));
+   return 1;
+}
+
+int lkiwi_linear_sum_expression(lua_State* L) {
+   const auto* expr = get_linear_sum(L, 1)->expr;
+   return push_expr_constant(L, expr, expr->constant);
+}
+
+int lkiwi_linear_sum_m_tostring(lua_State* L) {
+   return push_expr_tostring(L, get_linear_sum(L, 1)->expr);
+}
+
+int lkiwi_linear_sum_m_gc(lua_State* L) {
+   auto* sum = get_linear_sum(L, 1);
+   if (sum->expr) {
+      for (auto* t = sum->expr->terms; t != sum->expr->terms + sum->expr->term_count; ++t) {
+         t->var->release();
+      }
+      free(sum->expr);
+      sum->expr = nullptr;
+   }
+   return 0;
+}
+
+int lkiwi_linear_sum_m_unm(lua_State* L) {
+   return push_mul_expr_coeff(L, get_linear_sum(L, 1)->expr, -1.0);
+}
+
+constexpr const struct luaL_Reg kiwi_linear_sum_m[] = {
+    {"__add", lkiwi_expr_m_add},
+    {"__sub", lkiwi_expr_m_sub},
+    {"__mul", lkiwi_expr_m_mul},
+    {"__div", lkiwi_expr_m_div},
+    {"__unm", lkiwi_linear_sum_m_unm},
+    {"__tostring", lkiwi_linear_sum_m_tostring},
+    {"__gc", lkiwi_linear_sum_m_gc},
+    {"add", lkiwi_linear_sum_add},
+    {"add_expr", lkiwi_linear_sum_add_expr},
+    {"add_constant", lkiwi_linear_sum_add_constant},
+    {"clear", lkiwi_linear_sum_clear},
+    {"term_count", lkiwi_linear_sum_term_count},
+    {"value", lkiwi_linear_sum_value},
+    {"expression", lkiwi_linear_sum_expression},
+    {"eq", lkiwi_eq},
+    {"le", lkiwi_le},
+    {"ge", lkiwi_ge},
+    {0, 0}
+};
+
+int lkiwi_linear_sum_new(lua_State* L) {
+   lua_Integer capacity = luaL_optinteger(L, 1, 0);
+
+   auto* sum = static_cast<KiwiLinearSum*>(lua_newuserdata(L, sizeof(KiwiLinearSum)));
+   sum->expr = nullptr;
+   sum->capacity = 0;
+   push_type(L, LINSUM);
+   lua_setmetatable(L, -2);
+
+   int need = capacity < LINEAR_SUM_MIN_CAPACITY ? LINEAR_SUM_MIN_CAPACITY
+       : capacity > INT_MAX                      ? INT_MAX
+                                                 : static_cast<int>(capacity);
+   linear_sum_reserve(L, sum, need);
+   return 1;
+}
+
 int lkiwi_constraint_strength(lua_State* L) {
    lua_pushnumber(L, get_constraint(L, 1)->strength());
    return 1;
@@ -952,13 +1282,12 @@ int lkiwi_constraint_violated(lua_State* L) {
 
 int lkiwi_constraint_expression(lua_State* L) {
    auto* c = get_constraint(L, 1);
-   const auto& expr = c->expression();
-   const auto& terms = expr.terms();
+   const auto terms = c->terms();
    const auto term_count = static_cast<int>(terms.size() > INT_MAX ? INT_MAX : terms.size());
 
    auto* ne = expr_new(L, term_count);
    ne->owner = retain_unmanaged(c);
-   ne->constant = expr.constant();
+   ne->constant = c->constant();
    ne->term_count = term_count;
 
    for (int i = 0; i < term_count; ++i) {
@@ -987,15 +1316,13 @@ int lkiwi_constraint_m_tostring(lua_State* L) {
          break;
    }
 
-   const auto& expr = c.expression();
-
-   for (const auto& t : expr.terms()) {
+   for (const auto& t : c.terms()) {
       lua_pushfstring(L, "%f %s", t.coefficient(), t.variable().name());
       luaL_addvalue(&buf);
       luaL_addstring(&buf, " + ");
    }
 
-   lua_pushfstring(L, "%f", expr.constant());
+   lua_pushfstring(L, "%f", c.constant());
    luaL_addvalue(&buf);
 
    luaL_addlstring(&buf, oppart, 8);
@@ -1272,11 +1599,225 @@ int lkiwi_solver_suggest_value(lua_State* L) {
    return lkiwi_solver_handle_err(L, err, self);
 }
 
+/* Result of the try_* solver methods: true, or false and the error kind.
+ * Nothing is allocated on failure and the error mask is not consulted. */
+int lkiwi_solver_push_status(lua_State* L, const KiwiErr* err) {
+   if (!err) {
+      lua_pushboolean(L, 1);
+      return 1;
+   }
+   lua_pushboolean(L, 0);
+   lua_pushinteger(L, err->kind < KiwiErrUnknown ? err->kind : KiwiErrUnknown);
+   if (err->must_delete) {
+      delete const_cast<KiwiErr*>(err);
+   }
+   return 2;
+}
+
+int lkiwi_solver_try_add_constraint(lua_State* L) {
+   auto* self = get_solver(L, 1);
+   auto* c = get_constraint(L, 2);
+   return lkiwi_solver_push_status(L, kiwi_solver_add_constraint(self->solver, c));
+}
+
+int lkiwi_solver_try_remove_constraint(lua_State* L) {
+   auto* self = get_solver(L, 1);
+   auto* c = get_constraint(L, 2);
+   return lkiwi_solver_push_status(L, kiwi_solver_remove_constraint(self->solver, c));
+}
+
+int lkiwi_solver_try_add_edit_var(lua_State* L) {
+   auto* self = get_solver(L, 1);
+   auto* var = get_var(L, 2);
+   double strength = luaL_checknumber(L, 3);
+   return lkiwi_solver_push_status(L, kiwi_solver_add_edit_var(self->solver, var, strength));
+}
+
+int lkiwi_solver_try_remove_edit_var(lua_State* L) {
+   auto* self = get_solver(L, 1);
+   auto* var = get_var(L, 2);
+   return lkiwi_solver_push_status(L, kiwi_solver_remove_edit_var(self->solver, var));
+}
+
+int lkiwi_solver_try_suggest_value(lua_State* L) {
+   auto* self = get_solver(L, 1);
+   auto* var = get_var(L, 2);
+   double value = luaL_checknumber(L, 3);
+   return lkiwi_solver_push_status(L, kiwi_solver_suggest_value(self->solver, var, value));
+}
+
 int lkiwi_solver_update_vars(lua_State* L) {
    get_solver(L, 1)->solver.updateVariables();
    return 0;
 }
 
+int lkiwi_solver_update_vars_changed(lua_State* L) {
+   auto* self = get_solver(L, 1);
+   const double tolerance = luaL_optnumber(L, 2, 0.0);
+   const bool has_vars = !lua_isnoneornil(L, 3);
+   if (has_vars)
+      luaL_checktype(L, 3, LUA_TTABLE);
+
+   auto& changed = self->changed;
+   bool failed = false;
+   try {
+      changed.resize(self->solver.variableCount());
+   } catch (...) {
+      failed = true;
+   }
+   if (lk_unlikely(failed)) {
+      lua_rawgeti(L, lua_upvalueindex(1), MEM_ERR_MSG);
+      lua_error(L);
+   }
+
+   std::size_t n = 0;
+   self->solver.updateVariables(tolerance, [&changed, &n](const Variable& var) {
+      if (n < changed.size())
+         changed[n++] = const_cast<Variable&>(var).ptr();
+   });
+
+   if (!has_vars) {
+      const int count = n < INT_MAX ? static_cast<int>(n) : INT_MAX;
+      lua_createtable(L, count, 0);
+      for (int i = 0; i < count; ++i) {
+         *var_new(L) = changed[i]->retain();
+         lua_rawseti(L, -2, i + 1);
+      }
+      return 1;
+   }
+
+   // Report the caller's own objects, in the order of `vars`.
+   const auto first = changed.begin(), last = changed.begin() + n;
+   std::sort(first, last);
+   lua_settop(L, 3);
+   lua_newtable(L);
+   int count = 0;
+   for (int i = 1; n > 0 && lua_geti(L, 3, i) != LUA_TNIL; ++i) {
+      if (std::binary_search(first, last, get_var(L, -1)))
+         lua_rawseti(L, 4, ++count);
+      else
+         lua_pop(L, 1);
+   }
+   lua_settop(L, 4);
+   return 1;
+}
+
+int lkiwi_solver_get_values(lua_State* L) {
+   auto* self = get_solver(L, 1);
+   luaL_checktype(L, 2, LUA_TTABLE);
+   if (lua_isnoneornil(L, 3)) {
+      lua_settop(L, 2);
+      lua_newtable(L);
+   } else {
+      luaL_checktype(L, 3, LUA_TTABLE);
+      lua_settop(L, 3);
+   }
+
+   int n = 0;
+   while (lua_geti(L, 2, n + 1) != LUA_TNIL) {
+      ++n;
+      lua_pop(L, 1);
+   }
+   lua_pop(L, 1);
+   if (n == 0)
+      return 1;
+
+   const auto count = static_cast<std::size_t>(n);
+   auto* vars =
+       static_cast<const VariableData**>(lua_newuserdata(L, count * (sizeof(VariableData*) + sizeof(double))));
+   auto* values = reinterpret_cast<double*>(vars + count);
+   for (int i = 0; i < n; ++i) {
+      lua_geti(L, 2, i + 1);
+      vars[i] = get_var(L, -1);
+      lua_pop(L, 1);
+   }
+
+   bool failed = false;
+   try {
+      self->solver.getValues(count, [vars](std::size_t i) { return vars[i]; }, values);
+   } catch (...) {
+      failed = true;
+   }
+   if (lk_unlikely(failed)) {
+      lua_rawgeti(L, lua_upvalueindex(1), MEM_ERR_MSG);
+      lua_error(L);
+   }
+
+   for (int i = 0; i < n; ++i) {
+      lua_pushnumber(L, values[i]);
+      lua_rawseti(L, 3, i + 1);
+   }
+   lua_settop(L, 3);
+   return 1;
+}
+
+int lkiwi_solver_set_lazy(lua_State* L) {
+   get_solver(L, 1)->solver.setLazyUpdates(lua_toboolean(L, 2) != 0);
+   return 0;
+}
+
+int lkiwi_solver_set_dedup(lua_State* L) {
+   get_solver(L, 1)->solver.setDeduplication(lua_toboolean(L, 2) != 0);
+   return 0;
+}
+
+int lkiwi_solver_set_presolve(lua_State* L) {
+   get_solver(L, 1)->solver.setPresolve(lua_toboolean(L, 2) != 0);
+   return 0;
+}
+
+int lkiwi_solver_set_parallel(lua_State* L) {
+   auto* self = get_solver(L, 1);
+   const auto threads = luaL_checkinteger(L, 2);
+   const auto min_rows = luaL_optinteger(L, 3, -1);
+
+   bool failed = false;
+   try {
+      self->solver.setParallel(
+          threads > 0 ? static_cast<std::size_t>(threads) : 0,
+          min_rows >= 0 ? static_cast<std::size_t>(min_rows) : impl::SolverImpl::DefaultParallelRows
+      );
+   } catch (...) {
+      failed = true;
+   }
+   if (lk_unlikely(failed)) {
+      lua_rawgeti(L, lua_upvalueindex(1), MEM_ERR_MSG);
+      lua_error(L);
+   }
+   return 0;
+}
+
+int lkiwi_solver_set_deferred(lua_State* L) {
+   get_solver(L, 1)->solver.setDeferredOptimize(lua_toboolean(L, 2) != 0);
+   return 0;
+}
+
+int lkiwi_solver_optimized(lua_State* L) {
+   lua_pushboolean(L, get_solver(L, 1)->solver.optimized());
+   return 1;
+}
+
+int lkiwi_solver_step(lua_State* L) {
+   using Clock = std::chrono::steady_clock;
+   auto* self = get_solver(L, 1);
+   const double seconds = luaL_optnumber(L, 2, -1.0);
+   const auto max_pivots = luaL_optinteger(L, 3, -1);
+
+   const auto pivots = max_pivots >= 0 ? static_cast<std::size_t>(max_pivots)
+                                       : std::numeric_limits<std::size_t>::max();
+   const auto deadline = seconds >= 0.0 && seconds < 1.0e9
+       ? Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds))
+       : Clock::time_point::max();
+   bool done = false;
+   const KiwiErr* err = wrap_err([&]() { done = self->solver.optimizeFor(deadline, pivots); });
+   if (lk_unlikely(err)) {
+      error_new(L, err, 1, 0);
+      lua_error(L);
+   }
+   lua_pushboolean(L, done);
+   return 1;
+}
+
 int lkiwi_solver_reset(lua_State* L) {
    get_solver(L, 1)->solver.reset();
    return 0;
@@ -1289,6 +1830,123 @@ int lkiwi_solver_has_constraint(lua_State* L) {
    return 1;
 }
 
+int lkiwi_solver_set_constraint_enabled(lua_State* L) {
+   auto* self = get_solver(L, 1);
+   auto* c = get_constraint(L, 2);
+   bool enabled = lua_isnone(L, 3) || lua_toboolean(L, 3);
+   auto* err = kiwi_solver_set_constraint_enabled(self->solver, c, enabled);
+   return lkiwi_solver_handle_err(L, err, self);
+}
+
+int lkiwi_solver_constraint_enabled(lua_State* L) {
+   auto* s = get_solver(L, 1);
+   auto* c = get_constraint(L, 2);
+   lua_pushboolean(L, s->solver.constraintEnabled(Constraint(c)));
+   return 1;
+}
+
+int lkiwi_solver_set_strength(lua_State* L) {
+   auto* self = get_solver(L, 1);
+   auto* c = get_constraint(L, 2);
+   double strength = luaL_checknumber(L, 3);
+   auto* err = kiwi_solver_set_strength(self->solver, c, strength);
+   return lkiwi_solver_handle_err(L, err, self);
+}
+
+int lkiwi_solver_constraint_strength(lua_State* L) {
+   auto* s = get_solver(L, 1);
+   auto* c = get_constraint(L, 2);
+   double strength = s->solver.constraintStrength(Constraint(c));
+   if (strength < 0.0)
+      lua_pushnil(L);
+   else
+      lua_pushnumber(L, strength);
+   return 1;
+}
+
+int lkiwi_solver_set_constant(lua_State* L) {
+   auto* self = get_solver(L, 1);
+   auto* c = get_constraint(L, 2);
+   double constant = luaL_checknumber(L, 3);
+   auto* err = kiwi_solver_set_constant(self->solver, c, constant);
+   return lkiwi_solver_handle_err(L, err, self);
+}
+
+int lkiwi_solver_set_constants(lua_State* L) {
+   auto* self = get_solver(L, 1);
+   luaL_checktype(L, 2, LUA_TTABLE);
+   luaL_checktype(L, 3, LUA_TTABLE);
+   lua_settop(L, 3);
+
+   int n = 0;
+   while (lua_geti(L, 2, n + 1) != LUA_TNIL) {
+      ++n;
+      lua_pop(L, 1);
+   }
+   lua_pop(L, 1);
+   if (n == 0) {
+      lua_settop(L, 2);
+      return 1;
+   }
+
+   const auto count = static_cast<std::size_t>(n);
+   auto* cns =
+       static_cast<ConstraintData**>(lua_newuserdata(L, count * (sizeof(ConstraintData*) + sizeof(double))));
+   auto* constants = reinterpret_cast<double*>(cns + count);
+   for (int i = 0; i < n; ++i) {
+      lua_geti(L, 2, i + 1);
+      cns[i] = get_constraint(L, -1);
+      lua_geti(L, 3, i + 1);
+      int isnum;
+      constants[i] = lua_tonumberx(L, -1, &isnum);
+      if (!isnum)
+         luaL_argerror(L, 3, "expected a number for each constraint");
+      lua_pop(L, 2);
+   }
+
+   auto status = SolverStatus::Ok;
+   const KiwiErr* err = wrap_err([&]() {
+      status = self->solver.trySetConstants(
+          count,
+          [cns](std::size_t i) { return Constraint(cns[i]); },
+          constants
+      );
+   });
+   return lkiwi_solver_handle_err(L, err ? err : status_err(status), self);
+}
+
+int lkiwi_solver_constraint_constant(lua_State* L) {
+   auto* s = get_solver(L, 1);
+   auto* c = get_constraint(L, 2);
+   lua_pushnumber(L, s->solver.constraintConstant(Constraint(c)));
+   return 1;
+}
+
+int lkiwi_solver_set_coefficient(lua_State* L) {
+   auto* self = get_solver(L, 1);
+   auto* c = get_constraint(L, 2);
+   auto* var = get_var(L, 3);
+   double coefficient = luaL_checknumber(L, 4);
+   auto* err = kiwi_solver_set_coefficient(self->solver, c, var, coefficient);
+   return lkiwi_solver_handle_err(L, err, self);
+}
+
+int lkiwi_solver_constraint_coefficient(lua_State* L) {
+   auto* s = get_solver(L, 1);
+   auto* c = get_constraint(L, 2);
+   auto* var = get_var(L, 3);
+   lua_pushnumber(L, s->solver.constraintCoefficient(Constraint(c), Variable(var)));
+   return 1;
+}
+
+int lkiwi_solver_set_edit_strength(lua_State* L) {
+   auto* self = get_solver(L, 1);
+   auto* var = get_var(L, 2);
+   double strength = luaL_checknumber(L, 3);
+   auto* err = kiwi_solver_set_edit_strength(self->solver, var, strength);
+   return lkiwi_solver_handle_err(L, err, self);
+}
+
 int lkiwi_solver_has_edit_var(lua_State* L) {
    auto* s = get_solver(L, 1);
    auto* var = get_var(L, 2);
@@ -1336,9 +1994,54 @@ int lkiwi_add_remove_tab(lua_State* L, F&& fn) {
 }
 
 int lkiwi_solver_add_constraints(lua_State* L) {
-   return lkiwi_add_remove_tab(L, [](lua_State* L, KiwiSolver* s) {
-      return kiwi_solver_add_constraint(s->solver, get_constraint(L, -1));
+   auto* self = get_solver(L, 1);
+   lua_settop(L, 2);
+
+   // block this particularly obnoxious case which is always a bug
+   if (lua_type(L, 2) == LUA_TSTRING) {
+      luaL_typeerror(L, 2, "indexable");
+   }
+   int n = 0;
+   while (lua_geti(L, 2, n + 1) != LUA_TNIL) {
+      ++n;
+      lua_pop(L, 1);
+   }
+   lua_pop(L, 1);
+   if (n == 0)
+      return 1;
+
+   const auto count = static_cast<std::size_t>(n);
+   auto* cns = static_cast<ConstraintData**>(lua_newuserdata(L, count * sizeof(ConstraintData*)));
+   for (int i = 0; i < n; ++i) {
+      lua_geti(L, 2, i + 1);
+      cns[i] = get_constraint(L, -1);
+      lua_pop(L, 1);
+   }
+
+   auto status = SolverStatus::Ok;
+   std::size_t added = 0;
+   const KiwiErr* err = wrap_err([&]() {
+      status = self->solver.tryAddConstraints(
+          count,
+          [cns](std::size_t i) { return Constraint(cns[i]); },
+          added
+      );
    });
+   if (!err)
+      err = status_err(status);
+   if (err) {
+      lua_geti(L, 2, static_cast<lua_Integer>(added) + 1);
+      error_new(L, err, 1, 4 /* item_absi */);
+      if (self->error_mask & (1 << err->kind)) {
+         lua_replace(L, 3);
+         lua_settop(L, 3);
+         return 2;
+      } else {
+         lua_error(L);
+      }
+   }
+   lua_settop(L, 2);
+   return 1;
 }
 
 int lkiwi_solver_remove_constraints(lua_State* L) {
@@ -1434,9 +2137,33 @@ constexpr const struct luaL_Reg kiwi_solver_m[] = {
     {"remove_edit_vars", lkiwi_solver_remove_edit_vars},
     {"suggest_value", lkiwi_solver_suggest_value},
     {"suggest_values", lkiwi_solver_suggest_values},
+    {"try_add_constraint", lkiwi_solver_try_add_constraint},
+    {"try_remove_constraint", lkiwi_solver_try_remove_constraint},
+    {"try_add_edit_var", lkiwi_solver_try_add_edit_var},
+    {"try_remove_edit_var", lkiwi_solver_try_remove_edit_var},
+    {"try_suggest_value", lkiwi_solver_try_suggest_value},
     {"update_vars", lkiwi_solver_update_vars},
+    {"update_vars_changed", lkiwi_solver_update_vars_changed},
+    {"get_values", lkiwi_solver_get_values},
+    {"set_lazy", lkiwi_solver_set_lazy},
+    {"set_dedup", lkiwi_solver_set_dedup},
+    {"set_presolve", lkiwi_solver_set_presolve},
+    {"set_parallel", lkiwi_solver_set_parallel},
+    {"set_deferred", lkiwi_solver_set_deferred},
+    {"optimized", lkiwi_solver_optimized},
+    {"step", lkiwi_solver_step},
     {"reset", lkiwi_solver_reset},
     {"has_constraint", lkiwi_solver_has_constraint},
+    {"set_constraint_enabled", lkiwi_solver_set_constraint_enabled},
+    {"constraint_enabled", lkiwi_solver_constraint_enabled},
+    {"set_strength", lkiwi_solver_set_strength},
+    {"constraint_strength", lkiwi_solver_constraint_strength},
+    {"set_constant", lkiwi_solver_set_constant},
+    {"set_constants", lkiwi_solver_set_constants},
+    {"constraint_constant", lkiwi_solver_constraint_constant},
+    {"set_coefficient", lkiwi_solver_set_coefficient},
+    {"constraint_coefficient", lkiwi_solver_constraint_coefficient},
+    {"set_edit_strength", lkiwi_solver_set_edit_strength},
     {"has_edit_var", lkiwi_solver_has_edit_var},
     {"dump", lkiwi_solver_dump},
     {"dumps", lkiwi_solver_dumps},
@@ -1506,6 +2233,10 @@ int lkiwi_is_expression(lua_State* L) {
    return is_udata_obj(L, EXPR);
 }
 
+int lkiwi_is_linear_sum(lua_State* L) {
+   return is_udata_obj(L, LINSUM);
+}
+
 int lkiwi_is_constraint(lua_State* L) {
    return is_udata_obj(L, CONSTRAINT);
 }
@@ -1525,13 +2256,28 @@ int lkiwi_is_error(lua_State* L) {
    return 1;
 }
 
+// Temporaries are collected individually in this binding, scopes only call the function.
+int lkiwi_scope(lua_State* L) {
+   luaL_checktype(L, 1, LUA_TFUNCTION);
+   lua_call(L, lua_gettop(L) - 1, LUA_MULTRET);
+   return lua_gettop(L);
+}
+
+int lkiwi_promote(lua_State* L) {
+   lua_settop(L, 1);
+   return 1;
+}
+
 constexpr const struct luaL_Reg lkiwi[] = {
     {"Var", lkiwi_var_new},
+    {"new_vars", lkiwi_new_vars},
     {"is_var", lkiwi_is_var},
     {"Term", lkiwi_term_new},
     {"is_term", lkiwi_is_term},
     {"Expression", lkiwi_expr_new},
     {"is_expression", lkiwi_is_expression},
+    {"LinearSum", lkiwi_linear_sum_new},
+    {"is_linear_sum", lkiwi_is_linear_sum},
     {"Constraint", lkiwi_constraint_new},
     {"is_constraint", lkiwi_is_constraint},
     {"Solver", lkiwi_solver_new},
@@ -1541,6 +2287,8 @@ constexpr const struct luaL_Reg lkiwi[] = {
     {"eq", lkiwi_eq},
     {"le", lkiwi_le},
     {"ge", lkiwi_ge},
+    {"scope", lkiwi_scope},
+    {"promote", lkiwi_promote},
     {0, 0}
 };
 
@@ -1623,10 +2371,16 @@ extern "C" LJKIWI_EXPORT int luaopen_ljkiwi(lua_State* L) {
    lua_pushliteral(L, "kiwi library memory allocation error");
    lua_rawseti(L, ctx_i, MEM_ERR_MSG);
 
+   lua_newtable(L);
+   lua_rawseti(L, ctx_i, ZOMBIE_TAB);
+   *static_cast<ZombieState*>(lua_newuserdata(L, sizeof(ZombieState))) = ZombieState {0, ZOMBIE_MIN_SWEEP};
+   lua_rawseti(L, ctx_i, ZOMBIE_STATE);
+
    no_member_mt_new(L);
    register_type(L, "kiwi.Var", ctx_i, VAR, kiwi_var_m);
    register_type(L, "kiwi.Term", ctx_i, TERM, kiwi_term_m);
    register_type(L, "kiwi.Expression", ctx_i, EXPR, kiwi_expr_m);
+   register_type(L, "kiwi.LinearSum", ctx_i, LINSUM, kiwi_linear_sum_m);
    register_type(L, "kiwi.Constraint", ctx_i, CONSTRAINT, kiwi_constraint_m);
    register_type(L, "kiwi.Solver", ctx_i, SOLVER, kiwi_solver_m);
    register_type(L, "kiwi.Error", ctx_i, ERROR, lkiwi_error_m);
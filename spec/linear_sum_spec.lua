@@ -0,0 +1,138 @@
+expose("module", function()
+   require("kiwi")
+end)
+
+describe("LinearSum", function()
+   local kiwi = require("kiwi")
+
+   it("accumulates terms in place", function()
+      local x, y = kiwi.Var("x"), kiwi.Var("y")
+      local sum = kiwi.LinearSum()
+      assert.True(kiwi.is_linear_sum(sum))
+      assert.False(kiwi.is_linear_sum(x))
+
+      assert.equal(sum, sum:add(x))
+      sum:add(y, 2):add(x * 3, 2):add_constant(5)
+      assert.equal(3, sum:term_count())
+
+      local e = sum:expression()
+      assert.True(kiwi.is_expression(e))
+      assert.equal(5, e.constant)
+      local terms = e:terms()
+      assert.equal(3, #terms)
+      assert.equal(x, terms[1].var)
+      assert.equal(1.0, terms[1].coefficient)
+      assert.equal(y, terms[2].var)
+      assert.equal(2.0, terms[2].coefficient)
+      assert.equal(x, terms[3].var)
+      assert.equal(6.0, terms[3].coefficient)
+
+      x:set(1)
+      y:set(2)
+      assert.equal(16.0, sum:value())
+
+      assert.equal(sum, sum:clear())
+      assert.equal(0, sum:term_count())
+      assert.equal(0.0, sum:value())
+   end)
+
+   it("grows past its initial capacity", function()
+      local vars = kiwi.new_vars(100)
+      local sum = kiwi.LinearSum(2)
+      for i = 1, #vars do
+         vars[i]:set(i)
+         sum:add(vars[i], 2)
+      end
+      assert.equal(100, sum:term_count())
+      assert.equal(100 * 101, sum:value())
+
+      sum:add_expr(sum, -1)
+      assert.equal(200, sum:term_count())
+      assert.equal(0.0, sum:value())
+   end)
+
+   it("adds scaled expressions", function()
+      local x, y = kiwi.Var("x"), kiwi.Var("y")
+      local sum = kiwi.LinearSum()
+      sum:add_expr(x + 2 * y + 3, 2)
+      sum:add_expr(y)
+      sum:add_expr(4)
+      local e = sum:expression()
+      assert.equal(10, e.constant)
+      assert.equal(3, #e:terms())
+
+      assert.error(function()
+         sum:add_expr("x") ---@diagnostic disable-line: param-type-mismatch
+      end)
+      assert.error(function()
+         sum:add(1) ---@diagnostic disable-line: param-type-mismatch
+      end)
+   end)
+
+   it("works as an arithmetic operand", function()
+      local x, y = kiwi.Var("x"), kiwi.Var("y")
+      x:set(1)
+      y:set(2)
+      local sum = kiwi.LinearSum():add(x):add(y, 2):add_constant(1)
+
+      for _, e in ipairs({
+         x + sum,
+         sum + x,
+         2 * x + sum,
+         sum - 2 * x + 2 * x,
+         (x + 0) + sum,
+         sum + sum - sum,
+         1 + sum,
+         sum - 1 + 1,
+         -(-sum),
+         sum * 3 / 3,
+         2 * sum - sum,
+      }) do
+         assert.True(kiwi.is_expression(e))
+      end
+      assert.equal(7.0, (x + sum):value())
+      assert.equal(7.0, (sum + x):value())
+      assert.equal(8.0, (2 * x + sum):value())
+      assert.equal(0.0, (y * 3 - sum):value())
+      assert.equal(7.0, ((x + 0) + sum):value())
+      assert.equal(12.0, (sum + sum):value())
+      assert.equal(7.0, (1 + sum):value())
+      assert.equal(5.0, (sum - 1):value())
+      assert.equal(-6.0, (-sum):value())
+      assert.equal(18.0, (sum * 3):value())
+      assert.equal(3.0, (sum / 2):value())
+
+      -- the sum itself is not changed
+      assert.equal(2, sum:term_count())
+      assert.equal(6.0, sum:value())
+
+      assert.error(function()
+         local _ = sum * x
+      end)
+      assert.error(function()
+         local _ = sum + "x"
+      end)
+   end)
+
+   it("builds constraints directly", function()
+      local x, y = kiwi.Var("x"), kiwi.Var("y")
+      local sum = kiwi.LinearSum():add(x):add(y)
+
+      local c = sum:eq(10)
+      assert.True(kiwi.is_constraint(c))
+      assert.equal("EQ", c:op())
+      local c2 = kiwi.le(y, sum, kiwi.strength.WEAK)
+      assert.equal("LE", c2:op())
+      assert.equal(kiwi.strength.WEAK, c2:strength())
+
+      -- constraints keep their own copy of the terms
+      sum:clear():add(x)
+
+      local solver = kiwi.Solver()
+      solver:add_constraint(c)
+      solver:add_constraint(sum:eq(4))
+      solver:update_vars()
+      assert.equal(4.0, x:value())
+      assert.equal(6.0, y:value())
+   end)
+end)
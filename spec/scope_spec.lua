@@ -0,0 +1,136 @@
+expose("module", function()
+   require("kiwi")
+end)
+
+describe("scope", function()
+   local kiwi = require("kiwi")
+
+   it("builds constraints from scoped temporaries", function()
+      local x, y = kiwi.Var("x"), kiwi.Var("y")
+      local solver = kiwi.Solver()
+
+      local n = kiwi.scope(function(a, b)
+         for i = 1, 50 do
+            solver:add_constraint(kiwi.ge(x * 2 + y - i, 0, kiwi.strength.WEAK))
+         end
+         solver:add_constraint((x + y):eq(a))
+         solver:add_constraint(y:eq(b))
+         return 52
+      end, 10, 4)
+      assert.equal(52, n)
+
+      collectgarbage()
+      solver:update_vars()
+      assert.equal(6.0, x:value())
+      assert.equal(4.0, y:value())
+   end)
+
+   it("promotes returned values", function()
+      local x, y = kiwi.Var("x"), kiwi.Var("y")
+      local e, t, c, kept = kiwi.scope(function()
+         local inner = kiwi.scope(function()
+            return x + 2 * y + 1
+         end)
+         local keep = kiwi.promote(3 * y)
+         return inner * 2, x * 5, y:le(x + 1), keep
+      end)
+
+      collectgarbage()
+      assert.True(kiwi.is_expression(e))
+      assert.equal(2, e.constant)
+      local terms = e:terms()
+      assert.equal(2, #terms)
+      assert.equal(x, terms[1].var)
+      assert.equal(4.0, terms[2].coefficient)
+
+      assert.True(kiwi.is_term(t))
+      assert.equal(x, t.var)
+      assert.equal(5.0, t.coefficient)
+      assert.equal(3.0, kept.coefficient)
+
+      assert.True(kiwi.is_constraint(c))
+      assert.equal("LE", c:op())
+      local solver = kiwi.Solver()
+      solver:add_constraint(c)
+      assert.True(solver:has_constraint(c))
+   end)
+
+   it("propagates errors and releases the scope", function()
+      local x = kiwi.Var("x")
+      local ok, err = pcall(kiwi.scope, function()
+         local _ = x + 1
+         error("boom", 0)
+      end)
+      assert.False(ok)
+      assert.equal("boom", err)
+
+      assert.equal(3, kiwi.scope(function()
+         return (x + 3).constant
+      end))
+   end)
+
+   -- Fill the memory a released scope would hand out again.
+   local function churn(x, y)
+      for _ = 1, 20 do
+         kiwi.scope(function()
+            for j = 1, 200 do
+               local _ = x * j + y - j
+            end
+         end)
+      end
+      collectgarbage()
+   end
+
+   it("keeps an error item valid after the scope", function()
+      local x, y = kiwi.Var("x"), kiwi.Var("y")
+      local solver = kiwi.Solver()
+      local ok, err = pcall(kiwi.scope, function()
+         solver:add_constraint(x:eq(1))
+         solver:add_constraint((x + 2 * y):eq(7))
+         solver:add_constraint((x + 2 * y):eq(8))
+      end)
+      assert.False(ok)
+      assert.equal("KiwiErrUnsatisfiableConstraint", err.kind)
+
+      -- The solver keeps no reference to the rejected constraint.
+      churn(x, y)
+      local c = err.item
+      assert.True(kiwi.is_constraint(c))
+      assert.equal("EQ", c:op())
+      assert.False(solver:has_constraint(c))
+      local e = c:expression()
+      assert.equal(-8, e.constant)
+      assert.equal(2, #e:terms())
+   end)
+
+   it("keeps objects stored outside the scope valid", function()
+      local x, y = kiwi.Var("x"), kiwi.Var("y")
+      local e
+      local kept = {}
+      kiwi.scope(function()
+         e = x * 2 + 3
+         kept.t = 4 * y
+         kept.c = y:le(x + 1)
+      end)
+
+      churn(x, y)
+      assert.equal(3, e.constant)
+      local terms = e:terms()
+      assert.equal(1, #terms)
+      assert.equal(x, terms[1].var)
+      assert.equal(2, terms[1].coefficient)
+      assert.equal(y, kept.t.var)
+      assert.equal(4, kept.t.coefficient)
+      assert.equal("LE", kept.c:op())
+
+      local solver = kiwi.Solver()
+      solver:add_constraint(kept.c)
+      solver:add_constraint(x:eq(5))
+      solver:add_constraint(kiwi.Constraint(y - 9, nil, "EQ", kiwi.strength.WEAK))
+      solver:update_vars()
+      assert.equal(6, y:value())
+
+      e, kept = nil, nil
+      churn(x, y)
+   end)
+end)
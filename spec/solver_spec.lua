@@ -16,6 +16,32 @@ describe("solver", function()
       assert.False(kiwi.is_solver(kiwi.Term(kiwi.Var("v1"))))
    end)
 
+   it("should share variables and constraints with other solvers", function()
+      local other = kiwi.Solver()
+      local x, y = kiwi.Var("x"), kiwi.Var("y")
+      local c = x:ge(y + 10)
+      solver:add_constraint(c)
+      other:add_constraint(c)
+      solver:add_edit_var(y, kiwi.strength.STRONG)
+      other:add_edit_var(y, kiwi.strength.STRONG)
+
+      solver:suggest_value(y, 5)
+      other:suggest_value(y, -5)
+      solver:update_vars()
+      assert.equal(15.0, x:value())
+      other:update_vars()
+      assert.equal(5.0, x:value())
+
+      solver:remove_constraint(c)
+      assert.False(solver:has_constraint(c))
+      assert.True(other:has_constraint(c))
+      other = nil
+      collectgarbage()
+      solver:add_constraint(c)
+      assert.True(solver:has_constraint(c))
+      assert.True(solver:has_edit_var(y))
+   end)
+
    describe("edit variables", function()
       local v1, v2, v3
       before_each(function()
@@ -332,4 +358,1156 @@ describe("solver", function()
          end)
       end)
    end)
+
+   describe("update_vars_changed", function()
+      it("returns the variables that moved", function()
+         local solver = kiwi.Solver()
+         local x, y, z = kiwi.Var("x"), kiwi.Var("y"), kiwi.Var("z")
+         solver:add_constraint(y:eq(x + 5))
+         solver:add_constraint(z:eq(20))
+         solver:add_edit_var(x, kiwi.strength.STRONG)
+
+         local changed = solver:update_vars_changed()
+         assert.equal(2, #changed)
+         assert.equal(5.0, y:value())
+         assert.equal(20.0, z:value())
+
+         solver:suggest_value(x, 10)
+         changed = solver:update_vars_changed()
+         assert.equal(2, #changed)
+         local seen = {}
+         for _, v in ipairs(changed) do
+            assert.True(kiwi.is_var(v))
+            seen[v:name()] = true
+         end
+         assert.True(seen.x and seen.y)
+         assert.equal(10.0, x:value())
+         assert.equal(15.0, y:value())
+
+         assert.equal(0, #solver:update_vars_changed())
+
+         solver:suggest_value(x, 10.25)
+         assert.equal(0, #solver:update_vars_changed(0.5))
+         assert.equal(10.0, x:value())
+         solver:suggest_value(x, 11)
+         changed = solver:update_vars_changed(0.5)
+         assert.equal(2, #changed)
+         assert.equal(11.0, x:value())
+      end)
+
+      it("returns the caller's variables", function()
+         local solver = kiwi.Solver()
+         local x, y, z = kiwi.Var("x"), kiwi.Var("y"), kiwi.Var("z")
+         local vars = { z, y, x }
+         solver:add_constraint(y:eq(x + 5))
+         solver:add_constraint(z:eq(20))
+         solver:add_edit_var(x, kiwi.strength.STRONG)
+
+         local changed = solver:update_vars_changed(0, vars)
+         assert.equal(2, #changed)
+         assert.equal(rawequal(changed[1], z) and rawequal(changed[2], y), true)
+
+         solver:suggest_value(x, 10)
+         changed = solver:update_vars_changed(0, { x, z })
+         assert.equal(1, #changed)
+         assert.equal(rawequal(changed[1], x), true)
+         assert.equal(15.0, y:value())
+         assert.same({}, solver:update_vars_changed(0, vars))
+
+         solver:suggest_value(x, 11)
+         assert.error(function()
+            solver:update_vars_changed(0, { x, "y" })
+         end)
+         solver:suggest_value(x, 12)
+         changed = solver:update_vars_changed(0, vars)
+         assert.equal(2, #changed)
+         assert.equal(rawequal(changed[1], y) and rawequal(changed[2], x), true)
+      end)
+   end)
+
+   describe("try methods", function()
+      local function kind(name)
+         if type(kiwi.ErrKind) == "table" then
+            return kiwi.ErrKind[name]
+         end
+         return tonumber(kiwi.ErrKind(name))
+      end
+
+      it("return ok and the error kind", function()
+         local solver = kiwi.Solver()
+         local x = kiwi.Var("x")
+         local c = x:eq(1)
+
+         assert.same({ true }, { solver:try_add_constraint(c) })
+         assert.same({ false, kind("KiwiErrDuplicateConstraint") }, { solver:try_add_constraint(c) })
+         assert.same({ false, kind("KiwiErrUnsatisfiableConstraint") }, { solver:try_add_constraint(x:eq(2)) })
+         assert.True(solver:try_remove_constraint(c))
+         assert.same({ false, kind("KiwiErrUnknownConstraint") }, { solver:try_remove_constraint(c) })
+
+         assert.same({ false, kind("KiwiErrUnknownEditVar") }, { solver:try_suggest_value(x, 1) })
+         assert.same(
+            { false, kind("KiwiErrBadRequiredStrength") },
+            { solver:try_add_edit_var(x, kiwi.strength.REQUIRED) }
+         )
+         assert.True(solver:try_add_edit_var(x, kiwi.strength.STRONG))
+         assert.same({ false, kind("KiwiErrDuplicateEditVar") }, { solver:try_add_edit_var(x, kiwi.strength.STRONG) })
+         assert.True(solver:try_suggest_value(x, 3))
+         solver:update_vars()
+         assert.equal(3.0, x:value())
+         assert.True(solver:try_remove_edit_var(x))
+         assert.same({ false, kind("KiwiErrUnknownEditVar") }, { solver:try_remove_edit_var(x) })
+      end)
+   end)
+
+   describe("set_lazy", function()
+      it("resolves values when they are read", function()
+         local solver = kiwi.Solver()
+         local x, y = kiwi.Var("x"), kiwi.Var("y")
+         solver:set_lazy(true)
+         solver:add_constraint(y:eq(x * 2 + 1))
+         solver:add_edit_var(x, kiwi.strength.STRONG)
+
+         solver:suggest_value(x, 3)
+         assert.equal(0.0, y:value())
+         solver:update_vars()
+         assert.equal(7.0, y:value())
+         assert.equal(3.0, x:value())
+         assert.equal(14.0, (y * 2):value())
+
+         solver:suggest_value(x, 4)
+         assert.equal(7.0, y:value())
+         solver:update_vars()
+         y:set(-1)
+         assert.equal(-1.0, y:value())
+         assert.equal(4.0, x:value())
+
+         solver:suggest_value(x, 5)
+         solver:update_vars()
+         solver:set_lazy(false)
+         solver:suggest_value(x, 6)
+         assert.equal(11.0, y:value())
+         solver:update_vars()
+         assert.equal(13.0, y:value())
+      end)
+
+      it("resolves every value from the last update", function()
+         local solver = kiwi.Solver()
+         local x, y, z = kiwi.Var("x"), kiwi.Var("y"), kiwi.Var("z")
+         solver:set_lazy(true)
+         solver:add_constraint(y:eq(x * 2))
+         solver:add_constraint(z:eq(x * 3))
+         solver:add_edit_var(x, kiwi.strength.STRONG)
+
+         solver:suggest_value(x, 1)
+         solver:update_vars()
+         assert.equal(2.0, y:value())
+         solver:suggest_value(x, 4)
+         assert.equal(2.0, y:value())
+         assert.equal(3.0, z:value())
+         assert.equal(1.0, x:value())
+
+         solver:update_vars()
+         solver:remove_edit_var(x)
+         solver:add_constraint(x:eq(-1))
+         assert.equal(12.0, z:value())
+         solver:update_vars()
+         assert.equal(-2.0, y:value())
+      end)
+
+      it("resolves the last update across changes to the tableau", function()
+         local solver = kiwi.Solver()
+         local x, y, z = kiwi.Var("x"), kiwi.Var("y"), kiwi.Var("z")
+         solver:set_lazy(true)
+         local cy = y:eq(x + 5)
+         solver:add_constraint(cy)
+         solver:add_constraint(z:ge(y * 2))
+         solver:add_constraint(z:eq(0, kiwi.strength.WEAK))
+         solver:add_edit_var(x, kiwi.strength.STRONG)
+         solver:suggest_value(x, 2)
+         solver:update_vars()
+
+         solver:remove_constraint(cy)
+         solver:add_constraint(y:eq(x * -3))
+         solver:suggest_value(x, 10)
+         solver:add_constraint(x:le(z))
+         assert.equal(14.0, z:value())
+         assert.equal(7.0, y:value())
+         assert.equal(2.0, x:value())
+
+         solver:update_vars()
+         assert.equal(10.0, x:value())
+         assert.equal(-30.0, y:value())
+         assert.equal(10.0, z:value())
+      end)
+
+      it("keeps the resolved value after the solver is reset", function()
+         local solver = kiwi.Solver()
+         local x = kiwi.Var("x")
+         solver:set_lazy(true)
+         solver:add_constraint(x:eq(42))
+         solver:update_vars()
+         solver:reset()
+         assert.equal(42.0, x:value())
+      end)
+   end)
+
+   describe("set_constraint_enabled", function()
+      if not pcall(function()
+         return assert(kiwi.Solver().set_constraint_enabled)
+      end) then
+         return
+      end
+
+      it("toggles soft constraints in place", function()
+         local solver = kiwi.Solver()
+         local x = kiwi.Var("x")
+         local weak = x:eq(10, kiwi.strength.WEAK)
+         local strong = x:eq(20, kiwi.strength.STRONG)
+         solver:add_constraint(weak)
+         solver:add_constraint(strong)
+         solver:update_vars()
+         assert.equal(20.0, x:value())
+
+         solver:set_constraint_enabled(strong, false)
+         assert.True(solver:has_constraint(strong))
+         assert.False(solver:constraint_enabled(strong))
+         solver:update_vars()
+         assert.equal(10.0, x:value())
+
+         solver:set_constraint_enabled(strong, false)
+         solver:set_constraint_enabled(strong)
+         assert.True(solver:constraint_enabled(strong))
+         solver:update_vars()
+         assert.equal(20.0, x:value())
+
+         solver:set_constraint_enabled(strong, false)
+         solver:remove_constraint(strong)
+         solver:update_vars()
+         assert.equal(10.0, x:value())
+      end)
+
+      it("toggles required constraints", function()
+         local solver = kiwi.Solver({ "KiwiErrUnsatisfiableConstraint", "KiwiErrUnknownConstraint" })
+         local x = kiwi.Var("x")
+         local req = x:ge(50)
+         solver:add_constraint(x:eq(10, kiwi.strength.MEDIUM))
+         solver:add_constraint(req)
+         solver:update_vars()
+         assert.equal(50.0, x:value())
+
+         solver:set_constraint_enabled(req, false)
+         solver:update_vars()
+         assert.equal(10.0, x:value())
+
+         local conflict = x:le(20)
+         solver:add_constraint(conflict)
+         local _, err = solver:set_constraint_enabled(req, true)
+         assert.equal("KiwiErrUnsatisfiableConstraint", err.kind)
+         assert.False(solver:constraint_enabled(req))
+
+         solver:remove_constraint(conflict)
+         solver:set_constraint_enabled(req, true)
+         solver:update_vars()
+         assert.equal(50.0, x:value())
+
+         solver:set_constraint_enabled(req, false)
+         solver:remove_constraint(req)
+         assert.False(solver:has_constraint(req))
+         _, err = solver:set_constraint_enabled(req, true)
+         assert.equal("KiwiErrUnknownConstraint", err.kind)
+      end)
+   end)
+
+   describe("set_strength", function()
+      if not pcall(function()
+         return assert(kiwi.Solver().set_strength)
+      end) then
+         return
+      end
+
+      it("reweights constraints in place", function()
+         local solver = kiwi.Solver({ "KiwiErrBadRequiredStrength", "KiwiErrUnknownConstraint" })
+         local x = kiwi.Var("x")
+         local pref = x:eq(100, kiwi.strength.STRONG)
+         local squeeze = x:eq(40, kiwi.strength.MEDIUM)
+         solver:add_constraint(pref)
+         solver:add_constraint(squeeze)
+         solver:update_vars()
+         assert.equal(100.0, x:value())
+
+         solver:set_strength(pref, kiwi.strength.WEAK)
+         assert.equal(kiwi.strength.WEAK, solver:constraint_strength(pref))
+         assert.equal(kiwi.strength.STRONG, pref:strength())
+         solver:update_vars()
+         assert.equal(40.0, x:value())
+
+         solver:set_constraint_enabled(pref, false)
+         solver:set_strength(pref, kiwi.strength.STRONG)
+         solver:set_constraint_enabled(pref, true)
+         solver:update_vars()
+         assert.equal(100.0, x:value())
+
+         solver:remove_constraint(pref)
+         solver:update_vars()
+         assert.equal(40.0, x:value())
+         assert.is_nil(solver:constraint_strength(pref))
+
+         local _, err = solver:set_strength(squeeze, kiwi.strength.REQUIRED)
+         assert.equal("KiwiErrBadRequiredStrength", err.kind)
+         local req = x:ge(0)
+         solver:add_constraint(req)
+         _, err = solver:set_strength(req, kiwi.strength.WEAK)
+         assert.equal("KiwiErrBadRequiredStrength", err.kind)
+         _, err = solver:set_strength(pref, kiwi.strength.WEAK)
+         assert.equal("KiwiErrUnknownConstraint", err.kind)
+      end)
+
+      it("reweights edit variables in place", function()
+         local solver = kiwi.Solver({ "KiwiErrUnknownEditVar" })
+         local x = kiwi.Var("x")
+         solver:add_constraint(x:eq(10, kiwi.strength.MEDIUM))
+         solver:add_edit_var(x, kiwi.strength.WEAK)
+         solver:suggest_value(x, 50)
+         solver:update_vars()
+         assert.equal(10.0, x:value())
+
+         solver:set_edit_strength(x, kiwi.strength.STRONG)
+         solver:update_vars()
+         assert.equal(50.0, x:value())
+         solver:suggest_value(x, 60)
+         solver:update_vars()
+         assert.equal(60.0, x:value())
+
+         solver:remove_edit_var(x)
+         solver:update_vars()
+         assert.equal(10.0, x:value())
+         local _, err = solver:set_edit_strength(x, kiwi.strength.STRONG)
+         assert.equal("KiwiErrUnknownEditVar", err.kind)
+      end)
+   end)
+
+   describe("set_constant", function()
+      if not pcall(function()
+         return assert(kiwi.Solver().set_constant)
+      end) then
+         return
+      end
+
+      it("moves constraints in place", function()
+         local solver = kiwi.Solver({ "KiwiErrUnsatisfiableConstraint", "KiwiErrUnknownConstraint" })
+         local x, y = kiwi.Var("x"), kiwi.Var("y")
+         local pin = x:eq(100)
+         local gap = y:ge(x + 10)
+         local cap = y:le(500)
+         solver:add_constraint(pin)
+         solver:add_constraint(gap)
+         solver:add_constraint(cap)
+         solver:add_constraint(y:eq(0, kiwi.strength.WEAK))
+         solver:update_vars()
+         assert.equal(110.0, y:value())
+
+         solver:set_constant(pin, -200)
+         assert.equal(-200, solver:constraint_constant(pin))
+         assert.equal(-100, pin:expression().constant)
+         solver:update_vars()
+         assert.equal(200.0, x:value())
+         assert.equal(210.0, y:value())
+
+         local _, err = solver:set_constant(pin, -495)
+         assert.equal("KiwiErrUnsatisfiableConstraint", err.kind)
+         assert.equal(-200, solver:constraint_constant(pin))
+         solver:update_vars()
+         assert.equal(200.0, x:value())
+         assert.equal(210.0, y:value())
+
+         solver:set_constants({ pin, gap, cap }, { -50, -20, -600 })
+         solver:update_vars()
+         assert.equal(50.0, x:value())
+         assert.equal(70.0, y:value())
+
+         _, err = solver:set_constants({ pin, cap }, { -400, -380 })
+         assert.equal("KiwiErrUnsatisfiableConstraint", err.kind)
+         assert.equal(-50, solver:constraint_constant(pin))
+         assert.equal(-600, solver:constraint_constant(cap))
+
+         solver:remove_constraint(gap)
+         _, err = solver:set_constant(gap, 0)
+         assert.equal("KiwiErrUnknownConstraint", err.kind)
+         _, err = solver:set_constants({ pin, gap }, { -60, 0 })
+         assert.equal("KiwiErrUnknownConstraint", err.kind)
+         assert.equal(-50, solver:constraint_constant(pin))
+      end)
+
+      it("keeps the constant of disabled constraints", function()
+         local solver = kiwi.Solver()
+         local x = kiwi.Var("x")
+         local pin = x:eq(10)
+         local pref = x:eq(20, kiwi.strength.STRONG)
+         solver:add_constraint(pin)
+         solver:add_constraint(pref)
+
+         solver:set_constraint_enabled(pin, false)
+         solver:set_constant(pin, -30)
+         solver:update_vars()
+         assert.equal(20.0, x:value())
+
+         solver:set_constraint_enabled(pin, true)
+         solver:update_vars()
+         assert.equal(30.0, x:value())
+
+         solver:set_constraint_enabled(pin, false)
+         solver:set_constant(pref, -40)
+         solver:update_vars()
+         assert.equal(40.0, x:value())
+      end)
+   end)
+
+   describe("set_coefficient", function()
+      if not pcall(function()
+         return assert(kiwi.Solver().set_coefficient)
+      end) then
+         return
+      end
+
+      it("changes a ratio in place", function()
+         local solver = kiwi.Solver({ "KiwiErrUnsatisfiableConstraint", "KiwiErrUnknownConstraint" })
+         local total, left, gutter = kiwi.Var("total"), kiwi.Var("left"), kiwi.Var("gutter")
+         local split = kiwi.constraints.pair_ratio(left, 0.25, total)
+         solver:add_constraint(total:eq(300))
+         solver:add_constraint(gutter:eq(30))
+         solver:add_constraint(left:le(200))
+         solver:add_constraint(split)
+         solver:update_vars()
+         assert.equal(75.0, left:value())
+
+         solver:set_coefficient(split, total, -0.5)
+         assert.equal(-0.5, solver:constraint_coefficient(split, total))
+         for _, t in ipairs(split:expression():terms()) do
+            assert.equal(t.var == total and -0.25 or 1.0, t.coefficient)
+         end
+         solver:update_vars()
+         assert.equal(150.0, left:value())
+
+         local _, err = solver:set_coefficient(split, total, -0.9)
+         assert.equal("KiwiErrUnsatisfiableConstraint", err.kind)
+         assert.equal(-0.5, solver:constraint_coefficient(split, total))
+         solver:update_vars()
+         assert.equal(150.0, left:value())
+
+         solver:set_coefficient(split, gutter, 1)
+         assert.equal(1, solver:constraint_coefficient(split, gutter))
+         solver:update_vars()
+         assert.equal(120.0, left:value())
+
+         solver:set_coefficient(split, gutter, 0)
+         assert.equal(0, solver:constraint_coefficient(split, gutter))
+         solver:update_vars()
+         assert.equal(150.0, left:value())
+
+         solver:remove_constraint(split)
+         _, err = solver:set_coefficient(split, total, -1)
+         assert.equal("KiwiErrUnknownConstraint", err.kind)
+         assert.equal(0, solver:constraint_coefficient(split, total))
+      end)
+
+      it("reweights soft constraints", function()
+         local solver = kiwi.Solver()
+         local x, y = kiwi.Var("x"), kiwi.Var("y")
+         local pref = kiwi.eq(x - y, 0, kiwi.strength.STRONG)
+         solver:add_constraint(y:eq(10))
+         solver:add_constraint(x:le(100))
+         solver:add_constraint(pref)
+         solver:add_constraint(x:eq(0, kiwi.strength.WEAK))
+         solver:update_vars()
+         assert.equal(10.0, x:value())
+
+         solver:set_coefficient(pref, y, -3)
+         solver:update_vars()
+         assert.equal(30.0, x:value())
+
+         solver:set_coefficient(pref, y, -20)
+         solver:update_vars()
+         assert.equal(100.0, x:value())
+      end)
+
+      local function symbols(solver)
+         local set = {}
+         for sym in solver:dumps():gmatch("[sevd]%d+") do
+            set[sym] = true
+         end
+         return set
+      end
+
+      local function added_symbols(before, after)
+         local n = 0
+         for sym in pairs(after) do
+            if not before[sym] then
+               n = n + 1
+            end
+         end
+         return n
+      end
+
+      it("updates the row of a basic variable without new symbols", function()
+         local solver = kiwi.Solver()
+         local x = kiwi.Var("x")
+         local c = (x * 2):ge(10)
+         solver:add_constraint(c)
+         solver:add_constraint(x:eq(0, kiwi.strength.WEAK))
+         solver:update_vars()
+         assert.equal(5.0, x:value())
+
+         local before = symbols(solver)
+         solver:set_coefficient(c, x, 4)
+         solver:update_vars()
+         assert.equal(2.5, x:value())
+         assert.equal(0, added_symbols(before, symbols(solver)))
+      end)
+
+      it("reinserts the constraint when the variable is a parameter", function()
+         local solver = kiwi.Solver()
+         local x, y = kiwi.Var("x"), kiwi.Var("y")
+         local c = (x * 2 + y):ge(10)
+         solver:add_constraint(c)
+         solver:update_vars()
+
+         local before = symbols(solver)
+         solver:set_coefficient(c, x, 4)
+         solver:update_vars()
+         assert.equal(10.0, 4 * x:value() + y:value())
+         assert.is_true(added_symbols(before, symbols(solver)) > 0)
+      end)
+   end)
+
+   describe("set_dedup", function()
+      if not pcall(function()
+         return assert(kiwi.Solver().set_dedup)
+      end) then
+         return
+      end
+
+      it("keeps shared requirements until the last is removed", function()
+         local solver = kiwi.Solver()
+         local x, y = kiwi.Var("x"), kiwi.Var("y")
+         solver:set_dedup(true)
+         local tight, dup, loose = (x + y):ge(10), (x + y):ge(10), (x + y):ge(5)
+         solver:add_constraint(x:eq(0))
+         solver:add_constraint(y:eq(0, kiwi.strength.WEAK))
+         solver:add_constraint(tight)
+         solver:add_constraint(dup)
+         solver:add_constraint(loose)
+         assert.True(solver:has_constraint(dup))
+         assert.True(solver:constraint_enabled(loose))
+         assert.equal(-5, solver:constraint_constant(loose))
+         assert.False((solver:try_add_constraint(dup)))
+         solver:update_vars()
+         assert.equal(10.0, y:value())
+
+         solver:remove_constraint(tight)
+         solver:update_vars()
+         assert.equal(10.0, y:value())
+         solver:remove_constraint(dup)
+         solver:update_vars()
+         assert.equal(5.0, y:value())
+         solver:remove_constraint(loose)
+         solver:update_vars()
+         assert.equal(0.0, y:value())
+         assert.False(solver:has_constraint(loose))
+      end)
+
+      it("weights soft duplicates like separate constraints", function()
+         local x = kiwi.Var("x")
+         for _, dedup in ipairs({ false, true }) do
+            local solver = kiwi.Solver()
+            solver:set_dedup(dedup)
+            local a, b = x:eq(10, kiwi.strength.WEAK), x:eq(10, kiwi.strength.WEAK)
+            solver:add_constraint(a)
+            solver:add_constraint(b)
+            solver:add_constraint(x:eq(0, kiwi.strength.WEAK * 1.5))
+            solver:update_vars()
+            assert.equal(10.0, x:value())
+
+            solver:remove_constraint(a)
+            solver:update_vars()
+            assert.equal(0.0, x:value())
+            solver:add_constraint(a)
+            solver:set_strength(b, kiwi.strength.WEAK * 0.25)
+            solver:update_vars()
+            assert.equal(0.0, x:value())
+            solver:set_strength(b, kiwi.strength.WEAK)
+            solver:set_constant(b, -20)
+            solver:update_vars()
+            assert.equal(10.0, x:value())
+            assert.equal(-10, solver:constraint_constant(a))
+         end
+      end)
+
+      it("gives a changed constraint its own row", function()
+         local solver = kiwi.Solver()
+         local x = kiwi.Var("x")
+         solver:set_dedup(true)
+         local a, b, c = x:le(10), x:le(12), x:le(10)
+         solver:add_constraint(a)
+         solver:add_constraint(b)
+         solver:add_constraint(c)
+         solver:add_constraint(x:eq(100, kiwi.strength.WEAK))
+         solver:set_constant(a, -5)
+         solver:update_vars()
+         assert.equal(5.0, x:value())
+
+         solver:set_constraint_enabled(a, false)
+         solver:update_vars()
+         assert.equal(10.0, x:value())
+         solver:remove_constraint(c)
+         solver:update_vars()
+         assert.equal(12.0, x:value())
+         solver:set_constraint_enabled(a, true)
+         solver:update_vars()
+         assert.equal(5.0, x:value())
+      end)
+
+      it("keeps an equal requirement when the other is removed", function()
+         local x, y = kiwi.Var("x"), kiwi.Var("y")
+         for _, dedup in ipairs({ false, true }) do
+            local solver = kiwi.Solver()
+            solver:set_dedup(dedup)
+            local a = (x + y):eq(5)
+            solver:add_constraint(a)
+            solver:add_constraint((y - x):ge(5, kiwi.strength.MEDIUM))
+            solver:add_constraint((x + y):eq(5))
+            solver:add_constraint(x:eq(-5, kiwi.strength.STRONG))
+            solver:remove_constraint(a)
+            solver:update_vars()
+            assert.equal(5.0, x:value() + y:value())
+         end
+      end)
+   end)
+
+   describe("set_presolve", function()
+      if not pcall(function()
+         return assert(kiwi.Solver().set_presolve)
+      end) then
+         return
+      end
+
+      it("folds fixed and aliased variables", function()
+         local solver = kiwi.Solver()
+         local x, y, z, w = kiwi.Var("x"), kiwi.Var("y"), kiwi.Var("z"), kiwi.Var("w")
+         solver:set_presolve(true)
+         local fix, link = x:eq(10), y:eq(x + 5)
+         solver:add_constraint(fix)
+         solver:add_constraint(link)
+         solver:add_constraint(z:eq(y - 2))
+         solver:add_constraint(w:ge(z))
+         solver:add_constraint(w:eq(0, kiwi.strength.WEAK))
+         assert.True(solver:has_constraint(link))
+         assert.equal(-10, solver:constraint_constant(fix))
+         solver:update_vars()
+         assert.equal(10.0, x:value())
+         assert.equal(15.0, y:value())
+         assert.equal(13.0, z:value())
+         assert.equal(13.0, w:value())
+
+         solver:remove_constraint(link)
+         solver:add_constraint(y:eq(1, kiwi.strength.STRONG))
+         solver:update_vars()
+         assert.equal(10.0, x:value())
+         assert.equal(1.0, y:value())
+         assert.equal(-1.0, z:value())
+         assert.equal(0.0, w:value())
+
+         solver:set_constant(fix, -20)
+         solver:update_vars()
+         assert.equal(20.0, x:value())
+         assert.False(solver:has_constraint(link))
+      end)
+
+      it("follows edit variables through aliases", function()
+         local solver = kiwi.Solver()
+         local x, y = kiwi.Var("x"), kiwi.Var("y")
+         solver:set_presolve(true)
+         solver:add_edit_var(y, kiwi.strength.STRONG)
+         local link = x:eq(y + 3)
+         solver:add_constraint(link)
+         solver:suggest_value(y, 4)
+         solver:update_vars()
+         assert.equal(7.0, x:value())
+
+         solver:add_edit_var(x, kiwi.strength.MEDIUM)
+         solver:suggest_value(x, 10)
+         solver:update_vars()
+         assert.equal(7.0, x:value())
+
+         solver:remove_constraint(link)
+         solver:update_vars()
+         assert.equal(10.0, x:value())
+         assert.equal(4.0, y:value())
+      end)
+
+      it("turns single variable inequalities into bounds", function()
+         local solver = kiwi.Solver()
+         local x, y = kiwi.Var("x"), kiwi.Var("y")
+         solver:set_presolve(true)
+         local lower = x:ge(2)
+         solver:add_constraint(lower)
+         solver:add_constraint((-2 * y):ge(-20))
+         solver:add_constraint(y:eq(x + 3))
+         solver:add_edit_var(x, kiwi.strength.STRONG)
+         solver:suggest_value(x, -5)
+         solver:update_vars()
+         assert.equal(2.0, x:value())
+         assert.equal(5.0, y:value())
+
+         solver:suggest_value(x, 10)
+         solver:update_vars()
+         assert.equal(7.0, x:value())
+         assert.equal(10.0, y:value())
+
+         solver:remove_constraint(lower)
+         solver:suggest_value(x, -5)
+         solver:update_vars()
+         assert.equal(-5.0, x:value())
+         assert.equal(-2.0, y:value())
+      end)
+
+      it("gives bounds on known variables a row", function()
+         local solver = kiwi.Solver()
+         local x, y = kiwi.Var("x"), kiwi.Var("y")
+         solver:set_presolve(true)
+         local new_bound = x:ge(2)
+         solver:add_constraint(new_bound)
+         solver:add_constraint(y:eq(x + 3))
+         solver:add_edit_var(y, kiwi.strength.STRONG)
+         local known_bound = y:le(10)
+         solver:add_constraint(known_bound)
+         assert.True(solver:has_constraint(new_bound))
+         assert.True(solver:has_constraint(known_bound))
+         local dump = solver:dumps()
+         assert.is_nil(dump:find("1 * x + -2 >= 0", 1, true))
+         assert.not_nil(dump:find("1 * y + -10 <= 0", 1, true))
+
+         solver:suggest_value(y, 20)
+         solver:update_vars()
+         assert.equal(10.0, y:value())
+         assert.equal(7.0, x:value())
+         solver:suggest_value(y, 0)
+         solver:update_vars()
+         assert.equal(5.0, y:value())
+         assert.equal(2.0, x:value())
+
+         solver:remove_constraint(known_bound)
+         solver:remove_constraint(new_bound)
+         solver:suggest_value(y, 20)
+         solver:update_vars()
+         assert.equal(20.0, y:value())
+         assert.equal(17.0, x:value())
+         solver:suggest_value(y, 0)
+         solver:update_vars()
+         assert.equal(-3.0, x:value())
+      end)
+   end)
+
+   describe("set_parallel", function()
+      if not pcall(function()
+         return assert(kiwi.Solver().set_parallel)
+      end) then
+         return
+      end
+
+      local function solve(threads)
+         local solver = kiwi.Solver()
+         solver:set_parallel(threads, 1)
+         local vars = {}
+         for i = 1, 40 do
+            vars[i] = kiwi.Var("v" .. i)
+            if i > 1 then
+               solver:add_constraint(vars[i]:ge(vars[i - 1] + 1))
+               solver:add_constraint(vars[i]:eq(vars[i - 1] * 2, kiwi.strength.WEAK))
+            end
+         end
+         solver:add_constraint(vars[40]:le(100))
+         solver:add_edit_var(vars[1], kiwi.strength.STRONG)
+         local values = {}
+         for _, suggested in ipairs({ 3, 90, -7 }) do
+            solver:suggest_value(vars[1], suggested)
+            solver:update_vars()
+            for i = 1, 40 do
+               values[#values + 1] = vars[i]:value()
+            end
+         end
+         return values
+      end
+
+      it("solves as with a single thread", function()
+         assert.same(solve(1), solve(4))
+      end)
+   end)
+
+   describe("step", function()
+      local function layout(solver)
+         local vars = {}
+         for i = 1, 20 do
+            vars[i] = kiwi.Var("v" .. i)
+            if i > 1 then
+               solver:add_constraint(vars[i]:ge(vars[i - 1] + 2))
+            end
+            solver:add_constraint(vars[i]:eq(i * 3, kiwi.strength.WEAK))
+         end
+         solver:add_constraint(vars[20]:le(50))
+         return vars
+      end
+
+      local function values(vars)
+         local out = {}
+         for i, var in ipairs(vars) do
+            out[i] = var:value()
+         end
+         return out
+      end
+
+      it("spreads deferred optimization over steps", function()
+         local reference = kiwi.Solver()
+         local expected = layout(reference)
+         reference:update_vars()
+
+         local solver = kiwi.Solver()
+         solver:set_deferred(true)
+         local vars = layout(solver)
+         local steps = 0
+         while not solver:step(nil, 1) do
+            steps = steps + 1
+            solver:update_vars()
+            for i = 2, #vars do
+               assert.True(vars[i]:value() >= vars[i - 1]:value() + 2 - 1e-9)
+            end
+         end
+         assert.True(steps > 1)
+         solver:update_vars()
+         assert.same(values(expected), values(vars))
+
+         solver:add_edit_var(vars[1], kiwi.strength.STRONG)
+         solver:suggest_value(vars[1], 10)
+         assert.True(solver:step(1))
+         reference:add_edit_var(expected[1], kiwi.strength.STRONG)
+         reference:suggest_value(expected[1], 10)
+         reference:update_vars()
+         solver:update_vars()
+         assert.same(values(expected), values(vars))
+         assert.True(solver:step(0))
+      end)
+
+      it("keeps the last values while suggestions are pending", function()
+         local solver = kiwi.Solver()
+         solver:set_deferred(true)
+         local vars = layout(solver)
+         solver:add_edit_var(vars[1], kiwi.strength.STRONG)
+         assert.True(solver:step())
+         assert.True(solver:optimized())
+         solver:update_vars()
+         local before = values(vars)
+
+         solver:suggest_value(vars[1], 10)
+         assert.False(solver:step(nil, 0))
+         assert.False(solver:optimized())
+         solver:update_vars()
+         assert.same(before, values(vars))
+
+         assert.True(solver:step())
+         assert.True(solver:optimized())
+         solver:update_vars()
+         assert.equal(10, vars[1]:value())
+      end)
+   end)
+
+   describe("add_constraints", function()
+      local function chain(vars)
+         local constraints = {}
+         for i, var in ipairs(vars) do
+            constraints[#constraints + 1] = var:ge(0)
+            if i > 1 then
+               constraints[#constraints + 1] = var:eq(vars[i - 1] + 2)
+            end
+            constraints[#constraints + 1] = var:eq(i * 3, kiwi.strength.WEAK)
+         end
+         return constraints
+      end
+
+      it("solves as when added one at a time", function()
+         local reference = kiwi.Solver()
+         local expected = kiwi.new_vars(30)
+         for _, constraint in ipairs(chain(expected)) do
+            reference:add_constraint(constraint)
+         end
+         reference:update_vars()
+
+         local solver = kiwi.Solver()
+         local vars = kiwi.new_vars(30)
+         local constraints = chain(vars)
+         assert.equal(constraints, solver:add_constraints(constraints))
+         solver:update_vars()
+         for i, var in ipairs(vars) do
+            assert.near(expected[i]:value(), var:value(), 1e-9)
+         end
+      end)
+
+      it("stops at the first failure", function()
+         local solver = kiwi.Solver({ "KiwiErrUnsatisfiableConstraint" })
+         local x, y = kiwi.Var("x"), kiwi.Var("y")
+         local bad = x:eq(2)
+         local constraints = { x:eq(1), y:eq(x + 1), bad, y:ge(0) }
+         local ret, err = solver:add_constraints(constraints)
+         assert.equal(constraints, ret)
+         assert.True(kiwi.is_error(err))
+         ---@diagnostic disable: need-check-nil
+         assert.equal("KiwiErrUnsatisfiableConstraint", err.kind)
+         assert.equal(bad, err.item)
+         ---@diagnostic enable: need-check-nil
+         assert.True(solver:has_constraint(constraints[2]))
+         assert.False(solver:has_constraint(bad))
+         assert.False(solver:has_constraint(constraints[4]))
+         solver:update_vars()
+         assert.equal(2.0, y:value())
+
+         solver:set_error_mask(0)
+         assert.error(function()
+            solver:add_constraints({ constraints[1] })
+         end)
+      end)
+   end)
+
+   describe("get_values", function()
+      local solver, x, y, z
+
+      before_each(function()
+         solver = kiwi.Solver()
+         x, y, z = kiwi.Var("x"), kiwi.Var("y"), kiwi.Var("z")
+         solver:add_constraint(x:eq(10))
+         solver:add_constraint(y:eq(x + 5))
+      end)
+
+      it("reads values without updating variables", function()
+         z:set(7.0)
+         local values = solver:get_values({ y, z, x })
+         assert.equal(15.0, values[1])
+         assert.equal(7.0, values[2])
+         assert.equal(10.0, values[3])
+         assert.equal(0.0, x:value())
+         assert.equal(0.0, y:value())
+      end)
+
+      it("fills a provided table", function()
+         local out = { 1, 2, 3, "extra" }
+         assert.equal(out, solver:get_values({ x, y }, out))
+         assert.equal(10.0, out[1])
+         assert.equal(15.0, out[2])
+         assert.equal(3, out[3])
+      end)
+
+      it("handles large requests", function()
+         local vars = kiwi.new_vars(100)
+         for i = 2, #vars do
+            solver:add_constraint(vars[i]:eq(vars[i - 1] + 1))
+         end
+         solver:add_constraint(vars[1]:eq(x))
+         local values = solver:get_values(vars)
+         for i = 1, #vars do
+            assert.equal(9.0 + i, values[i])
+         end
+      end)
+   end)
+
+   describe("bind_values", function()
+      local solver = kiwi.Solver()
+      -- only the FFI binding over ckiwi exposes a value buffer
+      if not pcall(function()
+         return assert(solver.bind_values)
+      end) then
+         return
+      end
+
+      it("writes slotted variables to the buffer", function()
+         local x, y, z = kiwi.Var("x"), kiwi.Var("y"), kiwi.Var("z")
+         solver:add_constraint(x:eq(10))
+         solver:add_constraint(y:eq(x + 5))
+         solver:add_constraint(z:eq(y * 2))
+
+         local values = solver:bind_values(2)
+         solver:set_var_slot(x, 0)
+         solver:set_var_slot(z, 1)
+         solver:update_vars()
+
+         assert.equal(10.0, values[0])
+         assert.equal(30.0, values[1])
+         assert.equal(0.0, x:value())
+         assert.equal(15.0, y:value())
+         assert.equal(0.0, z:value())
+
+         solver:set_var_slot(x)
+         solver:bind_values()
+         solver:update_vars()
+         assert.equal(10.0, x:value())
+         assert.equal(30.0, z:value())
+      end)
+
+      it("get_values fills a double array", function()
+         local x, y = kiwi.Var("x"), kiwi.Var("y")
+         solver:add_constraint(y:eq(x + 5))
+         solver:add_constraint(x:eq(1))
+         local out = require("ffi").new("double[2]")
+         assert.equal(out, solver:get_values({ x, y }, out))
+         assert.equal(1.0, out[0])
+         assert.equal(6.0, out[1])
+      end)
+   end)
+
+   describe("bind_snapshot", function()
+      if not kiwi.Snapshot then
+         return
+      end
+
+      it("publishes a frame per update", function()
+         local solver = kiwi.Solver()
+         local x, y = kiwi.Var("x"), kiwi.Var("y")
+         local snapshot = solver:bind_snapshot(kiwi.Snapshot(3))
+         assert.True(kiwi.is_snapshot(snapshot))
+         assert.equal(3, snapshot:size())
+         solver:set_var_slot(x, 0)
+         solver:set_var_slot(y, 2)
+         solver:add_constraint(y:eq(x + 5))
+         solver:add_edit_var(x, kiwi.strength.STRONG)
+         solver:suggest_value(x, 2)
+
+         local version, values = snapshot:read()
+         assert.equal(0, version)
+         assert.True(values[0] ~= values[0])
+
+         solver:update_vars()
+         version, values = snapshot:read(values)
+         assert.equal(1, version)
+         assert.equal(2.0, values[0])
+         assert.True(values[1] ~= values[1])
+         assert.equal(7.0, values[2])
+         assert.equal(2.0, x:value())
+
+         solver:suggest_value(x, 4)
+         solver:update_vars()
+         assert.equal(2, snapshot:version())
+         local _, ptr_values = require("ffi").cast("KiwiSnapshot*", snapshot):read()
+         assert.equal(9.0, ptr_values[2])
+
+         solver:bind_snapshot()
+         solver:suggest_value(x, 8)
+         solver:update_vars()
+         assert.equal(2, snapshot:version())
+      end)
+   end)
+
+   describe("AsyncSolver", function()
+      if not (kiwi.AsyncSolver and pcall(kiwi.AsyncSolver, 0)) then
+         if os.getenv("KIWI_REQUIRE_ASYNC") == "1" then
+            it("is available", function()
+               error("KIWI_REQUIRE_ASYNC is set but kiwi.AsyncSolver is unavailable")
+            end)
+         else
+            pending("requires the ffi bindings built with FATOMIC_REFCOUNT")
+         end
+         return
+      end
+
+      it("publishes slotted values after each batch", function()
+         local solver = kiwi.AsyncSolver(2)
+         local x, y = kiwi.Var("x"), kiwi.Var("y")
+         solver:set_var_slot(x, 0)
+         solver:set_var_slot(y, 1)
+         solver:add_constraint(y:eq(x + 5))
+         solver:add_constraint(x:eq(1))
+         assert.True(solver:wait())
+
+         local changed, values = solver:poll()
+         assert.True(changed)
+         assert.equal(1.0, values[0])
+         assert.equal(6.0, values[1])
+         assert.equal(0.0, x:value())
+
+         changed, values = solver:poll()
+         assert.False(changed)
+         assert.equal(6.0, values[1])
+         assert.Nil(solver:take_error())
+      end)
+
+      it("applies suggestions polled from a frame loop", function()
+         local solver = kiwi.AsyncSolver(1)
+         local x, y = kiwi.Var("x"), kiwi.Var("y")
+         solver:set_var_slot(y, 0)
+         solver:add_constraint(y:eq(x * 2))
+         solver:add_edit_var(x, kiwi.strength.STRONG)
+
+         local frames = coroutine.wrap(function()
+            for i = 1, 3 do
+               solver:suggest_value(x, i)
+               while not solver:wait(0) do
+                  coroutine.yield()
+               end
+               local changed, values = solver:poll()
+               assert.True(changed)
+               assert.equal(i * 2, values[0])
+            end
+            return true
+         end)
+         while not frames() do
+         end
+      end)
+
+      it("shares variables and constraints with a solver on the calling thread", function()
+         local async = kiwi.AsyncSolver(1)
+         local solver = kiwi.Solver()
+         local xs, cs = {}, {}
+         for i = 1, 32 do
+            xs[i] = kiwi.Var("x" .. i)
+         end
+         for i = 2, 32 do
+            cs[i - 1] = xs[i]:eq(xs[i - 1] + 1)
+         end
+         async:set_var_slot(xs[32], 0)
+         async:add_edit_var(xs[1], kiwi.strength.STRONG)
+         solver:add_edit_var(xs[1], kiwi.strength.STRONG)
+         for _, c in ipairs(cs) do
+            async:add_constraint(c)
+            solver:add_constraint(c)
+         end
+         for i = 1, 20 do
+            async:suggest_value(xs[1], i)
+            solver:suggest_value(xs[1], -i)
+            for _, c in ipairs(cs) do
+               assert.True(solver:has_constraint(c))
+            end
+         end
+         solver:update_vars()
+         assert.True(async:wait())
+
+         local _, values = async:poll()
+         assert.equal(51.0, values[0])
+         assert.equal(11.0, xs[32]:value())
+         assert.Nil(async:take_error())
+      end)
+
+      it("reports failed mutations through take_error", function()
+         local solver = kiwi.AsyncSolver(1)
+         local x = kiwi.Var("x")
+         local c = x:eq(1)
+         solver:add_constraint(c)
+         solver:remove_edit_var(x)
+         solver:add_constraint(x:eq(2))
+         solver:wait()
+
+         local err = solver:take_error()
+         assert.True(kiwi.is_error(err))
+         assert.equal("KiwiErrUnknownEditVar", err.kind)
+         assert.Nil(solver:take_error())
+
+         assert.has_error(function()
+            solver:add_constraint(nil)
+         end)
+      end)
+   end)
 end)
@@ -14,6 +14,61 @@ describe("Var", function()
       end)
    end)
 
+   it("new_vars", function()
+      local vars = kiwi.new_vars(3, { "a", nil, "c" })
+      assert.equal(3, #vars)
+      for _, v in ipairs(vars) do
+         assert.True(kiwi.is_var(v))
+         assert.equal(0.0, v:value())
+      end
+      assert.equal("a", vars[1]:name())
+      assert.equal("", vars[2]:name())
+      assert.equal("c", vars[3]:name())
+
+      vars[2]:set(5.0)
+      assert.equal(5.0, vars[2]:value())
+      assert.equal(0.0, vars[3]:value())
+
+      local unnamed = kiwi.new_vars(70)
+      assert.equal(70, #unnamed)
+      assert.equal(0, #kiwi.new_vars(0))
+   end)
+
+   it("outlives its handle while referenced", function()
+      local solver = kiwi.Solver()
+      local x = kiwi.Var("x")
+      for i = 1, 200 do
+         local v = kiwi.Var("a variable with a long name " .. i)
+         solver:add_constraint(v:eq(x + i))
+      end
+      local t = kiwi.Var("term var") * 2
+      collectgarbage()
+      collectgarbage()
+
+      solver:add_constraint(x:eq(1))
+      local changed = solver:update_vars_changed()
+      assert.equal(201, #changed)
+      local seen = 0
+      for _, v in ipairs(changed) do
+         if v ~= x then
+            local i = tonumber(v:name():match("%d+$"))
+            assert.equal(i + 1, v:value())
+            seen = seen + 1
+         end
+      end
+      assert.equal(200, seen)
+      assert.equal("term var", t.var:name())
+
+      changed = nil
+      solver:reset()
+      collectgarbage()
+      collectgarbage()
+      for _ = 1, 100 do
+         solver:add_constraint(kiwi.Var():eq(2))
+      end
+      collectgarbage()
+   end)
+
    describe("method", function()
       local v
 